@@ -49,6 +49,7 @@ int main(int argc, char** argv)
 
 //			cout << "# " << name << endl;
 //			Time_AutoCorrelation(sceneset, 10);
+//			Time_AutoCorrelation_FFT(sceneset, 10);
 //			Spatial_AutoCorrelation(sceneset, 50, 5);
 
 //			int r = rand() % Scene::number_of_particles;
@@ -64,6 +65,7 @@ int main(int argc, char** argv)
 			// The variables: Mean_Squared_Distance_Growth(SceneSet* s, int frames, int number_of_points, int number_of_pair_sets, Real r_cut)
 //			Mean_Squared_Distance_Growth(sceneset, 200, 200, 40, 0.01); // Mean_Squared_Distance_Growth(SceneSet* s, int frames, int number_of_points, int number_of_pair_sets, Real r_cut)
 //			Mean_Squared_Displacement_Growth(sceneset, sceneset->scene.size(), 400);// void Mean_Squared_Displacement_Growth(SceneSet* s, int frames, int number_of_points)
+//			Mean_Squared_Displacement_FFT(sceneset, 10);
 //			Lyapunov_Exponent(sceneset, 900, 200, 40, 0.1,0.2);
 
 //			Pair_Distribution(sceneset, 6,400);
@@ -8,6 +8,8 @@
 #include"statistics.h"
 #include"field.h"
 #include"pair-set.h"
+#include"cell-list.h"
+#include"time-correlation.h"
 
 using namespace std;
 
@@ -29,6 +31,24 @@ double Local_Cohesion(SceneSet* s, double rc)
 	return(phi);
 }
 
+// Local_Cohesion with a cell list (cell-list.h), the columns of cells of each frame are divided between threads. The result is the same as Local_Cohesion, or with the nearest images of the particles across the edges of the box if periodic.
+double Local_Cohesion_Cell_List(SceneSet* s, double rc, bool periodic = false)
+{
+	long double phi = 0;
+	long int counter = 0;
+	Cell_List cells;
+	for (int i = 0; i < s->scene.size(); i++)
+	{
+		BasicParticle* particle = s->scene[i].particle;
+		cells.Build(particle, Scene::number_of_particles, s->L_min, rc, periodic);
+		#pragma omp parallel for schedule(dynamic) reduction(+:phi,counter)
+		for (int x = 0; x < cells.grid_dim; x++)
+			Cohesion_Pairs(particle, cells, x, x+1, rc, phi, counter);
+	}
+	phi /= counter;
+	return(phi);
+}
+
 void Compute_Polarization(SceneSet* s, Stat<double>* polarization)
 {
 	for (int i = 0; i < s->scene.size(); i++)
@@ -72,12 +92,22 @@ void Time_AutoCorrelation(SceneSet* s, int step)
 		cout << i << "\t" << Time_AutoCorrelationPoint(s, i) << endl;
 }
 
+// Time_AutoCorrelation by FFT over all time origins (time-correlation.h), the same output in O(N T log T) instead of O(N T^2).
+void Time_AutoCorrelation_FFT(SceneSet* s, int step)
+{
+	vector<double> vacf;
+	if (!Time_Correlations(s, &vacf, NULL))
+		return;
+	for (int i = 0; i < (s->scene.size() - 5); i+=step)
+		cout << i << "\t" << vacf[i] << endl;
+}
+
 void Spatial_AutoCorrelation(SceneSet* s, int size, double rc)
 {
-	double bin[size];
-	int num[size];
+	double bin[size+1]; // r a little less than rc is rounded to bin size.
+	int num[size+1];
 
-	for (int x = 0; x < size; x++)
+	for (int x = 0; x <= size; x++)
 	{
 		bin[x] = 0;
 		num[x] = 0;
@@ -114,6 +144,40 @@ void Spatial_AutoCorrelation(SceneSet* s, int size, double rc)
 }
 
 
+// Spatial_AutoCorrelation with a cell list, each thread has its own bins and they are added at the end of each frame.
+void Spatial_AutoCorrelation_Cell_List(SceneSet* s, int size, double rc, bool periodic = false)
+{
+	std::vector<double> bin(size+1, 0);
+	std::vector<long int> num(size+1, 0);
+	Cell_List cells;
+
+	for (int i = s->scene.size()/2; i < s->scene.size(); i+=100)
+	{
+		BasicParticle* particle = s->scene[i].particle;
+		cells.Build(particle, Scene::number_of_particles, s->L_min, rc, periodic);
+		#pragma omp parallel
+		{
+			std::vector<double> thread_bin(size+1, 0);
+			std::vector<long int> thread_num(size+1, 0);
+			#pragma omp for schedule(dynamic)
+			for (int x = 0; x < cells.grid_dim; x++)
+				Spatial_Correlation_Pairs(particle, cells, x, x+1, size, rc, thread_bin.data(), thread_num.data());
+			#pragma omp critical
+			for (int x = 0; x <= size; x++)
+			{
+				bin[x] += thread_bin[x];
+				num[x] += thread_num[x];
+			}
+		}
+	}
+
+	for (int x = 1; x < size; x++)
+	{
+		double r = (x*rc)/size;
+		cout << r << "\t" << ((num[x] != 0) ? (bin[x] / num[x]) : 0) << endl;
+	}
+}
+
 void Trajectory(SceneSet* s, int index)
 {
 	for (int i = 0; i < s->scene.size(); i++)
@@ -285,6 +349,38 @@ void Pair_Distribution(SceneSet* s, Real lx,int grid_size)
 	}
 }
 
+// Pair_Distribution with a cell list, each thread has its own bins and they are added at the end of each frame.
+void Pair_Distribution_Cell_List(SceneSet* s, Real lx, int grid_size, bool periodic = false)
+{
+	std::vector<double> bin(grid_size*grid_size, 0);
+	int counter = 0;
+	Cell_List cells;
+
+	for (int i = s->scene.size()/2; i < s->scene.size(); i+=100)
+	{
+		BasicParticle* particle = s->scene[i].particle;
+		cells.Build(particle, Scene::number_of_particles, s->L_min, Pair_Distribution_Range(particle, Scene::number_of_particles, lx), periodic);
+		#pragma omp parallel
+		{
+			std::vector<double> thread_bin(grid_size*grid_size, 0);
+			#pragma omp for schedule(dynamic)
+			for (int x = 0; x < cells.grid_dim; x++)
+				Pair_Distribution_Pairs(particle, cells, x, x+1, lx, grid_size, thread_bin.data());
+			#pragma omp critical
+			for (int n = 0; n < grid_size*grid_size; n++)
+				bin[n] += thread_bin[n];
+		}
+		counter++;
+	}
+
+	for (int x = 0; x < grid_size; x++)
+	{
+		for (int y = 0; y < grid_size; y++)
+			cout << ((2.0*x)/grid_size-1)*lx << "\t" << ((2.0*y)/grid_size-1)*lx << "\t" << bin[x*grid_size + y] / (Scene::number_of_particles*(4*lx*lx/grid_size/grid_size)) / counter << endl;
+		cout << endl;
+	}
+}
+
 // Find distance growth in time (Diffusion)
 void Mean_Squared_Distance_Growth(SceneSet* s, int frames, int number_of_points, int number_of_pair_sets, Real r_cut)
 {
@@ -330,6 +426,16 @@ void Mean_Squared_Displacement_Growth(SceneSet* s, int frames, int number_of_poi
 	delete [] md2;
 }
 
+// Mean squared displacement of the unwrapped positions averaged over all time origins by FFT (time-correlation.h), every step-th tau.
+void Mean_Squared_Displacement_FFT(SceneSet* s, int step)
+{
+	vector<double> msd;
+	if (!Time_Correlations(s, NULL, &msd))
+		return;
+	for (int i = step; i < s->scene.size(); i+=step)
+		cout << i << "\t" << msd[i] << endl;
+}
+
 
 // Find distance growth in time (Lyapanov)
 bool Lyapunov_Exponent(SceneSet* s, int frames, int number_of_points, int number_of_pair_sets, Real r_min, Real r_max)
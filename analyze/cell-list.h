@@ -0,0 +1,160 @@
+#ifndef _CELL_LIST_
+#define _CELL_LIST_
+
+#include "../shared/c2dvector.h"
+#include "../shared/particle.h"
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Most cells in each direction
+const int cell_list_max_grid = 1000;
+
+// Cells of a frame of the box [-L, L)^2 that are at least r_cut wide, like the cells of Pair_Set::Find_Particle. All pairs closer than r_cut are in the same cell or in neighbor cells, so the pairs of a frame are found in O(N) instead of O(N^2).
+// For_Pairs gives each pair of particles of the cells of the columns [x_begin, x_end) and their neighbors once, so threads can take different columns. The neighbors of the cells of the edge are on the other side of the box and dr is the nearest image only if the list is periodic, otherwise dr is r_j - r_k like the brute force functions of analyze.h and the pairs across the edge are never closer than r_cut. If the box is smaller than 3 cells there is one cell (all pairs).
+class Cell_List{
+public:
+	int grid_dim;
+	Real L;
+	bool periodic;
+	std::vector<int> cell_start; // The particles of cell x*grid_dim + y are particle_id[cell_start[c]] ... particle_id[cell_start[c+1]-1]
+	std::vector<int> particle_id;
+	std::vector<int> particle_cell;
+
+	void Build(const BasicParticle* particle, int N, Real input_L, Real r_cut, bool input_periodic);
+	C2DVector Distance(const BasicParticle* particle, int j, int k) const;
+	template<class Pair_Function> void For_Pairs(const BasicParticle* particle, int x_begin, int x_end, Pair_Function f) const;
+};
+
+void Cell_List::Build(const BasicParticle* particle, int N, Real input_L, Real r_cut, bool input_periodic)
+{
+	L = input_L;
+	periodic = input_periodic;
+	grid_dim = (r_cut > 0) ? (int) min((double) cell_list_max_grid, floor(2*L / r_cut)) : 1;
+	if (grid_dim < 3)
+		grid_dim = 1;
+
+	cell_start.assign(grid_dim*grid_dim + 1, 0);
+	particle_cell.resize(N);
+	particle_id.resize(N);
+	for (int i = 0; i < N; i++)
+	{
+		int x = (int) floor((particle[i].r.x + L)*grid_dim / (2*L));
+		int y = (int) floor((particle[i].r.y + L)*grid_dim / (2*L));
+		x = max(0, min(grid_dim - 1, x));
+		y = max(0, min(grid_dim - 1, y));
+		particle_cell[i] = x*grid_dim + y;
+		cell_start[particle_cell[i] + 1]++;
+	}
+	for (int c = 0; c < grid_dim*grid_dim; c++)
+		cell_start[c+1] += cell_start[c];
+	std::vector<int> next(cell_start.begin(), cell_start.end() - 1);
+	for (int i = 0; i < N; i++)
+		particle_id[next[particle_cell[i]]++] = i;
+}
+
+inline C2DVector Cell_List::Distance(const BasicParticle* particle, int j, int k) const
+{
+	C2DVector dr = particle[j].r - particle[k].r;
+	if (periodic)
+	{
+		dr.x -= 2*L*((int) (dr.x / L));
+		dr.y -= 2*L*((int) (dr.y / L));
+	}
+	return dr;
+}
+
+// f(j, k, dr) is called for each pair, dr = r_j - r_k. The cell of j is in the columns and k is in the same cell or the cells of the half of its neighbors that are after it.
+template<class Pair_Function>
+void Cell_List::For_Pairs(const BasicParticle* particle, int x_begin, int x_end, Pair_Function f) const
+{
+	const int neighbor[4][2] = {{1, 0}, {1, 1}, {1, -1}, {0, 1}};
+	for (int x = x_begin; x < x_end; x++)
+		for (int y = 0; y < grid_dim; y++)
+		{
+			int c = x*grid_dim + y;
+			for (int a = cell_start[c]; a < cell_start[c+1]; a++)
+				for (int b = a+1; b < cell_start[c+1]; b++)
+					f(particle_id[a], particle_id[b], Distance(particle, particle_id[a], particle_id[b]));
+			if (grid_dim == 1)
+				continue;
+			for (int n = 0; n < 4; n++)
+			{
+				int nx = x + neighbor[n][0];
+				int ny = y + neighbor[n][1];
+				if (nx >= grid_dim || ny < 0 || ny >= grid_dim)
+				{
+					if (!periodic)
+						continue;
+					nx = (nx + grid_dim) % grid_dim;
+					ny = (ny + grid_dim) % grid_dim;
+				}
+				int d = nx*grid_dim + ny;
+				for (int a = cell_start[c]; a < cell_start[c+1]; a++)
+					for (int b = cell_start[d]; b < cell_start[d+1]; b++)
+						f(particle_id[a], particle_id[b], Distance(particle, particle_id[a], particle_id[b]));
+			}
+		}
+}
+
+// Sums of the pair functions of analyze.h for the columns [x_begin, x_end) of a cell list, they add to the sums that are given.
+void Cohesion_Pairs(const BasicParticle* particle, const Cell_List& cells, int x_begin, int x_end, double rc, long double& phi, long int& counter)
+{
+	cells.For_Pairs(particle, x_begin, x_end, [&](int j, int k, const C2DVector& dr)
+	{
+		if (dr.Square() < (rc*rc))
+		{
+			phi += particle[j].v*particle[k].v;
+			counter++;
+		}
+	});
+}
+
+// bin and num have size+1 elements, r a little less than rc is rounded to bin size.
+void Spatial_Correlation_Pairs(const BasicParticle* particle, const Cell_List& cells, int x_begin, int x_end, int size, double rc, double* bin, long int* num)
+{
+	cells.For_Pairs(particle, x_begin, x_end, [&](int j, int k, const C2DVector& dr)
+	{
+		double r = sqrt(dr.Square());
+		if (r < rc)
+		{
+			int x = (int) round(size*(r / rc));
+			num[x]++;
+			bin[x] += particle[j].v * particle[k].v;
+		}
+	});
+}
+
+// Both orders of each pair: k in the frame of the velocity of j and j in the frame of k. bin has grid_size^2 elements.
+void Pair_Distribution_Pairs(const BasicParticle* particle, const Cell_List& cells, int x_begin, int x_end, double lx, int grid_size, double* bin)
+{
+	cells.For_Pairs(particle, x_begin, x_end, [&](int j, int k, const C2DVector& r_jk)
+	{
+		for (int order = 0; order < 2; order++)
+		{
+			int p = (order == 0) ? j : k;
+			C2DVector dr = (order == 0) ? (r_jk*(-1)) : r_jk; // The other particle minus p
+			C2DVector tdr;
+			tdr.y = particle[p].v * dr;
+			tdr.x = (particle[p].v.y * dr.x) - (particle[p].v.x * dr.y);
+			if (fabs(tdr.x) < lx && fabs(tdr.y) < lx)
+			{
+				int x = (int) (grid_size*((tdr.x / lx) + 1)/2);
+				int y = (int) (grid_size*((tdr.y / lx) + 1)/2);
+				bin[x*grid_size + y]++;
+			}
+		}
+	});
+}
+
+// The pairs of Pair_Distribution are closer than sqrt(2) lx / |v| of the particle of the frame, so the cells are that wide for the slowest particle. 0 (one cell) if a particle does not move.
+double Pair_Distribution_Range(const BasicParticle* particle, int N, double lx)
+{
+	double v2_min = 1e300;
+	for (int i = 0; i < N; i++)
+		v2_min = min(v2_min, particle[i].v.Square());
+	return ((v2_min > 1e-12) ? 1.000001*sqrt(2.0)*lx / sqrt(v2_min) : 0);
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include <boost/algorithm/string.hpp>
+
+#include<iostream>
+#include<cstdlib>
+#include<vector>
+#include<cstdio>
+#include<chrono>
+
+#include"scene-cache.h"
+
+using namespace std;
+
+inline double Seconds(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Decode all blocks of a compressed file, the blocks are divided between threads (OpenMP). It returns the largest difference of the positions from the frames of original (in units of L).
+double Decode_Test(const Mapped_Trajectory& compressed, const Mapped_Trajectory& original, double& seconds)
+{
+	int blocks = compressed.Blocks();
+	double error = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	#pragma omp parallel for schedule(dynamic) reduction(max:error)
+	for (int b = 0; b < blocks; b++)
+	{
+		int t0 = compressed.block_start[b];
+		int N = compressed.N(t0);
+		int frames = ((b + 1 < blocks) ? compressed.block_start[b+1] : compressed.Frames()) - t0;
+		vector<float> data(4L*N*frames);
+		compressed.Decode_Block(b, data.data());
+		for (int f = 0; f < frames; f++)
+		{
+			const float* frame = original.View(t0 + f); // The original is not compressed, View only reads the mapped file.
+			for (int i = 0; i < N; i++)
+			{
+				double dx = abs(data[4L*N*f + 4*i] - frame[4*i]);
+				double dy = abs(data[4L*N*f + 4*i+1] - frame[4*i+1]);
+				error = max(error, max(min(dx, 2*compressed.header.Lx - dx) / compressed.header.Lx, min(dy, 2*compressed.header.Ly - dy) / compressed.header.Ly));
+			}
+		}
+	}
+	seconds = Seconds(start);
+	return error;
+}
+
+// Convert a trajectory file of any version and codec to version 2 with the given codec. The file is written to name.tmp and then renamed to name, the frames are read from the mapped file so they are never in memory all together. The density and noise of a version 1 file are taken from the name of the file and the box size from the farthest particle, like SceneSet::Read.
+bool Convert(string name, int codec)
+{
+	Mapped_Trajectory input;
+	if (!input.Open(name))
+	{
+		cout << "Can not read the file: " << name << endl;
+		return false;
+	}
+	Trajectory_Header header = input.header;
+	if (header.version == trajectory_version && header.codec == codec)
+	{
+		cout << name << " is already version " << header.version << " with codec " << codec << endl;
+		return true;
+	}
+
+	if (header.version == 1)
+	{
+		float L = 0;
+		for (int t = 0; t < input.Frames(); t++)
+		{
+			const float* frame = input.View(t);
+			for (int i = 0; i < input.N(t); i++)
+				L = max(L, max(abs(frame[4*i]), abs(frame[4*i+1])));
+		}
+		string info = name;
+		boost::replace_all(info, "-r-v.bin", "");
+		string values = info;
+		boost::replace_all(values, "rho=", "");
+		boost::replace_all(values, "-noise=", "\t");
+		stringstream ss(values);
+		Real density = 0, noise = 0;
+		ss >> density;
+		ss >> noise;
+		Convert_Trajectory_Header(header, round(L+0.1), density, noise, info);
+	}
+	header.codec = codec;
+	if (codec == 1 && header.position_bits == 0)
+	{
+		header.position_bits = trajectory_position_bits;
+		header.angle_bits = trajectory_angle_bits;
+	}
+
+	long int raw_size = sizeof(header);
+	for (int t = 0; t < input.Frames(); t++)
+		raw_size += Frame_Size(input.N(t)) + sizeof(long int);
+	raw_size += sizeof(Trajectory_Footer);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	string temp_name = name + ".tmp";
+	ofstream output_file(temp_name.c_str(), ios::binary);
+	output_file.write((char*) &header, sizeof(header));
+	Frame_Writer frame_writer;
+	frame_writer.Init(header);
+	for (int t = 0; t < input.Frames(); t++)
+		frame_writer.Write(output_file, input.View(t), input.N(t));
+	frame_writer.Close(output_file);
+	long int size = output_file.tellp();
+	output_file.close();
+	double encode_time = Seconds(start);
+	if (!output_file.good())
+	{
+		cout << "Can not write the file: " << temp_name << endl;
+		return false;
+	}
+	cout << name << ": " << input.Frames() << " frames of " << header.N << " particles, L = " << header.Lx << endl;
+
+	if (codec == 1 && input.header.codec == 0)
+	{
+		Mapped_Trajectory output;
+		output.Open(temp_name);
+		double decode_time;
+		double error = Decode_Test(output, input, decode_time);
+		cout << " compression ratio " << (double) raw_size / size << " (" << raw_size << " to " << size << " bytes)" << endl;
+		cout << " encode " << raw_size / (1e6*encode_time) << " MB/s, decode " << raw_size / (1e6*decode_time) << " MB/s (" << output.Blocks() << " blocks)" << endl;
+		cout << " largest position error " << error << " of L" << endl;
+	}
+	input.Close();
+	rename(temp_name.c_str(), name.c_str());
+	return true;
+}
+
+// ./convert.out [-c] files: without -c the files are written in version 2 with frames of floats, with -c they are compressed (shared/trajectory-codec.h).
+int main(int argc, char** argv)
+{
+	int codec = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (string(argv[i]) == "-c")
+			codec = 1;
+		else
+			Convert(argv[i], codec);
+	}
+
+	return 0;
+}
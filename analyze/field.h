@@ -17,19 +17,17 @@ public:
 	Real omega;
 	Real curl;
 	Real theta_ave;
-	static Real dim_x;
+	Real dim_x; // Size of the cell
 
 	Field_Cell();
 	~Field_Cell();
-	void Init(Real,Real);
+	void Init(Real,Real,Real);
 	void Reset();
 	void Add(BasicParticle* p);
 	void Compute_Fields(Real L);
 	void Delta_Theta_Stat();
 };
 
-Real Field_Cell::dim_x = 0;
-
 Field_Cell::Field_Cell()
 {
 }
@@ -39,8 +37,9 @@ Field_Cell::~Field_Cell()
 	Reset();
 }
 
-void Field_Cell::Init(Real x, Real y)
+void Field_Cell::Init(Real x, Real y, Real input_dim_x)
 {
+	dim_x = input_dim_x;
 	r.x = x;
 	r.y = y;
 	Reset();
@@ -120,7 +119,6 @@ public:
 
 Field::Field(int input_grid_dim_x, Real input_L): L(input_L), grid_dim_x(input_grid_dim_x)
 {
-	Field_Cell::dim_x = 2*L / grid_dim_x;
 	cell = new Field_Cell*[grid_dim_x];
 	for (int i = 0; i < grid_dim_x; i++)
 	{
@@ -142,7 +140,7 @@ void Field::Init()
 		for (int y = 0; y < grid_dim_x; y++)
 		{
 			cell[x][y].Reset();
-			cell[x][y].Init(2*(x+0.5)*(L / grid_dim_x) - L, 2*(y+0.5)*(L / grid_dim_x) - L);
+			cell[x][y].Init(2*(x+0.5)*(L / grid_dim_x) - L, 2*(y+0.5)*(L / grid_dim_x) - L, 2*L / grid_dim_x);
 		}
 	Reset();
 }
@@ -326,7 +324,7 @@ void Field::Draw_Section(string info, int y)
 	gp << "set xtics offset 0,0.4 \n";
 	gp << "set ytics offset 0.5,0 \n";
 	gp << "set ylabel \"{/Symbol r}, {/Symbol f}\" offset 3,0 \n";
-	gp << "set output \"figures/" << info << "-density-section-y=" << std::fixed << std::setprecision(0) << round((y+0.5)*Field_Cell::dim_x - L)  << ".eps\"\n";
+	gp << "set output \"figures/" << info << "-density-section-y=" << std::fixed << std::setprecision(0) << round((y+0.5)*cell[0][0].dim_x - L)  << ".eps\"\n";
 	gp << "set xrange [-L:L]\n";
 	gp << "plot \"data.dat\" using 1:4 w lp ls 1 ti \"{/Symbol r}\", \"data.dat\" using 1:5 w lp ls 2 ti \"{/Symbol f}\"\n";
 
@@ -345,20 +343,20 @@ void Field::Draw_Section(string info, int y)
 
 	gp << "unset log \n";
 	gp << "set ylabel \"v\" offset 3,0 \n";
-	gp << "set output \"figures/"<< info << "-velocity-section-y=" << std::fixed << round((y+0.5)*Field_Cell::dim_x - L)  << ".eps\"\n";
+	gp << "set output \"figures/"<< info << "-velocity-section-y=" << std::fixed << round((y+0.5)*cell[0][0].dim_x - L)  << ".eps\"\n";
 	gp << "set xrange [-L:L]\n";
 	gp << "plot \"data.dat\" using 1:3 w lp ls 1 ti \"v_y\", \"data.dat\" using 1:2 w lp ls 2 ti \"v_x\" \n";
 //	gp.send1d(pts);
 
 	gp << "set ylabel \"W\" offset 3,0 \n";
-	gp << "set output \"figures/"<< info << "-W-section-y=" << std::fixed << std::setprecision(0) << round((y+0.5)*Field_Cell::dim_x - L)  << ".eps\"\n";
+	gp << "set output \"figures/"<< info << "-W-section-y=" << std::fixed << std::setprecision(0) << round((y+0.5)*cell[0][0].dim_x - L)  << ".eps\"\n";
 	gp << "set xrange [-L:L]\n";
 	gp << "plot \"data.dat\" using 1:9 w lp ls 1 ti \"W_y\", \"data.dat\" using 1:8 w lp ls 2 ti \"W_x\" \n";
 //	gp.send1d(pts);
 
 	gp << "set nokey\n";
 	gp << "set ylabel \"{/Symbol w}\" offset 3,0 \n";
-	gp << "set output \"figures/"<< info << "-omega-section-y=" << std::fixed << std::setprecision(0) << round((y+0.5)*Field_Cell::dim_x - L)  << ".eps\"\n";
+	gp << "set output \"figures/"<< info << "-omega-section-y=" << std::fixed << std::setprecision(0) << round((y+0.5)*cell[0][0].dim_x - L)  << ".eps\"\n";
 	gp << "set xrange [-L:L]\n";
 	gp << "plot \"data.dat\" using 1:(-$3/$1) w lp ls 1\n";
 //	gp.send1d(pts);
@@ -414,7 +412,7 @@ void Field::Add(Field* f)
 				cell[x][y].curl += f->cell[x][y].curl;
 			}
 		}
-		sample++;
+		sample += (f->sample > 0) ? f->sample : 1; // f is a sum of fields that are not averaged yet, or one field.
 	}
 	else
 		cout << "Error! Size of two fields are different. The program can't add two fields with different sizes";
@@ -0,0 +1,123 @@
+#include<iostream>
+#include<cstdlib>
+#include<vector>
+#include<chrono>
+
+#include"analyze.h"
+
+using namespace std;
+
+// Run an analysis with cout going to a string, so the results of the brute force and cell list functions can be compared. It returns the seconds.
+template<class Function> double Capture(Function f, string& output)
+{
+	stringstream ss;
+	streambuf* cout_buffer = cout.rdbuf(ss.rdbuf());
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	f();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout.rdbuf(cout_buffer);
+	output = ss.str();
+	return seconds;
+}
+
+// Largest difference of the numbers of two outputs relative to the largest number, -1 if they do not have the same number of results.
+double Difference(const string& a, const string& b)
+{
+	stringstream sa(a), sb(b);
+	double x, y, difference = 0, largest = 0;
+	while (true)
+	{
+		bool read_a = (bool) (sa >> x);
+		bool read_b = (bool) (sb >> y);
+		if (read_a != read_b)
+			return -1; // Different number of results
+		if (!read_a)
+			break;
+		difference = max(difference, fabs(x - y));
+		largest = max(largest, fabs(x));
+	}
+	return ((largest > 0) ? difference / largest : difference);
+}
+
+// Trajectory of random particles (uniform positions and directions) of the given density, 2 frames so that Spatial_AutoCorrelation and Pair_Distribution use one of them.
+void Write_Random_Trajectory(string name, int N, Real density)
+{
+	Real L = sqrt(N / density) / 2;
+	Trajectory_Header header;
+	header.N = N;
+	Convert_Trajectory_Header(header, L, density, 0, "random");
+	ofstream output_file(name.c_str(), ios::binary);
+	output_file.write((char*) &header, sizeof(header));
+	Frame_Writer frame_writer;
+	frame_writer.Init(header);
+	vector<float> frame(4*N);
+	for (int t = 0; t < 2; t++)
+	{
+		for (int i = 0; i < N; i++)
+		{
+			C2DVector r;
+			r.Rand(L);
+			double theta = gsl_ran_flat(C2DVector::gsl_r, -M_PI, M_PI);
+			frame[4*i] = r.x;
+			frame[4*i+1] = r.y;
+			frame[4*i+2] = cos(theta);
+			frame[4*i+3] = sin(theta);
+		}
+		frame_writer.Write(output_file, frame.data(), N);
+	}
+	frame_writer.Close(output_file);
+	output_file.close();
+}
+
+// ./pair-benchmark.out [N_max [brute_N_max]]: time of Local_Cohesion, Spatial_AutoCorrelation and Pair_Distribution and of their cell list versions for random particles of density 1, N from 1000 to N_max (64000) doubling. The brute force functions are only run up to brute_N_max (32000) particles.
+int main(int argc, char** argv)
+{
+	C2DVector::Init_Rand(321);
+	int N_max = (argc > 1) ? atoi(argv[1]) : 64000;
+	int brute_N_max = (argc > 2) ? atoi(argv[2]) : 32000;
+	string name = "pair-benchmark.bin";
+	double rc = 1, spatial_rc = 5, lx = 2;
+	int size = 50, grid_size = 40;
+
+	cout << "N\tfunction\tbrute(s)\tcell list(s)\tspeedup\tdifference" << endl;
+	for (int N = 1000; N <= N_max; N *= 2)
+	{
+		Write_Random_Trajectory(name, N, 1);
+		SceneSet sceneset(name);
+		sceneset.Read();
+		for (int f = 0; f < 3; f++)
+		{
+			string brute, cell;
+			double brute_time = 0;
+			double cell_time;
+			if (f == 0)
+			{
+				if (N <= brute_N_max)
+					brute_time = Capture([&]() {cout << Local_Cohesion(&sceneset, rc) << endl;}, brute);
+				cell_time = Capture([&]() {cout << Local_Cohesion_Cell_List(&sceneset, rc) << endl;}, cell);
+				cout << N << "\tLocal_Cohesion";
+			}
+			else if (f == 1)
+			{
+				if (N <= brute_N_max)
+					brute_time = Capture([&]() {Spatial_AutoCorrelation(&sceneset, size, spatial_rc);}, brute);
+				cell_time = Capture([&]() {Spatial_AutoCorrelation_Cell_List(&sceneset, size, spatial_rc);}, cell);
+				cout << N << "\tSpatial_AutoCorrelation";
+			}
+			else
+			{
+				if (N <= brute_N_max)
+					brute_time = Capture([&]() {Pair_Distribution(&sceneset, lx, grid_size);}, brute);
+				cell_time = Capture([&]() {Pair_Distribution_Cell_List(&sceneset, lx, grid_size);}, cell);
+				cout << N << "\tPair_Distribution";
+			}
+			if (N <= brute_N_max)
+				cout << "\t" << brute_time << "\t" << cell_time << "\t" << brute_time / cell_time << "\t" << Difference(brute, cell) << endl;
+			else
+				cout << "\t-\t" << cell_time << "\t-\t-" << endl;
+		}
+	}
+	remove(name.c_str());
+
+	return 0;
+}
@@ -0,0 +1,661 @@
+#ifndef _PIPELINE_
+#define _PIPELINE_
+
+#include "read.h"
+#include "statistics.h"
+#include "field.h"
+#include "cell-list.h"
+#include <boost/algorithm/string.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Most frames of a chunk, and the memory of a chunk (bytes of the floats and the decoded particles of its frames). A chunk of a compressed file has whole blocks, so it can be more than pipeline_chunk_frames by one block.
+const int pipeline_chunk_frames = 256;
+const long int pipeline_chunk_memory = 500000000;
+
+inline int Pipeline_Threads()
+{
+	#ifdef _OPENMP
+		return omp_get_max_threads();
+	#else
+		return 1;
+	#endif
+}
+
+inline int Pipeline_Thread_Id()
+{
+	#ifdef _OPENMP
+		return omp_get_thread_num();
+	#else
+		return 0;
+	#endif
+}
+
+// A decoded frame of the file that is given to the accumulators.
+struct Stream_Frame{
+	int t; // Number of the frame in the file
+	int N;
+	std::vector<BasicParticle> particle;
+	void Decode(int input_t, int input_N, const float* data);
+};
+
+void Stream_Frame::Decode(int input_t, int input_N, const float* data)
+{
+	t = input_t;
+	N = input_N;
+	particle.resize(N);
+	for (int i = 0; i < N; i++)
+	{
+		particle[i].r.x = data[4*i];
+		particle[i].r.y = data[4*i+1];
+		particle[i].v.x = data[4*i+2];
+		particle[i].v.y = data[4*i+3];
+	}
+}
+
+// An observable of the streaming analysis. The frames are given to Add_Frame once, in any order and by several threads: each thread has its own copy (Clone) of the accumulator and the copies are added together by Merge at the end, so an accumulator only keeps sums and its memory does not depend on the number of frames.
+// A new observable is a class with Init (read parameter and make the sums, it is also called for each file), Add_Frame, Merge and Print, and a Register_Accumulator with its name, default parameters and their names.
+class Accumulator{
+public:
+	std::string name;
+	std::vector<double> parameter;
+	Trajectory_Header header;
+	Real L; // Half of the box, with the margin of analyze.cpp so the grids have all particles.
+	int frames; // Number of frames of the file
+	int first, step; // Frames that are used: first, first + step, ...
+
+	virtual ~Accumulator() {}
+	virtual void Init() = 0;
+	virtual void Add_Frame(const Stream_Frame& frame) = 0;
+	virtual void Merge(const Accumulator* a) = 0;
+	virtual void Print(std::string info) = 0;
+	bool Use(int t) const {return (t >= first && (t - first) % step == 0);}
+	void Set_File(const Trajectory_Header& input_header, Real input_L, int input_frames);
+	Accumulator* Clone() const; // An empty accumulator with the same parameters and file
+};
+
+struct Accumulator_Plugin{
+	Accumulator* (*make)();
+	std::vector<double> default_parameter;
+	std::string usage;
+};
+
+std::map<std::string, Accumulator_Plugin>& Accumulator_Registry()
+{
+	static std::map<std::string, Accumulator_Plugin> registry;
+	return registry;
+}
+
+template<class T> Accumulator* Make_Accumulator()
+{
+	return new T;
+}
+
+// A global Register_Accumulator adds an observable to the registry when the program starts.
+struct Register_Accumulator{
+	Register_Accumulator(std::string name, Accumulator* (*make)(), std::vector<double> default_parameter, std::string usage)
+	{
+		Accumulator_Plugin plugin = {make, default_parameter, usage};
+		Accumulator_Registry()[name] = plugin;
+	}
+};
+
+void Accumulator::Set_File(const Trajectory_Header& input_header, Real input_L, int input_frames)
+{
+	header = input_header;
+	L = input_L;
+	frames = input_frames;
+	first = 0;
+	step = 1;
+}
+
+Accumulator* Accumulator::Clone() const
+{
+	Accumulator* a = Accumulator_Registry()[name].make();
+	a->name = name;
+	a->parameter = parameter;
+	a->Set_File(header, L, frames);
+	a->Init();
+	return a;
+}
+
+// Polarization of all frames: density, noise, mean and error like Compute_Polarization.
+class Polarization_Accumulator: public Accumulator{
+public:
+	Running_Stat polarization;
+	void Init() {polarization.Reset();}
+	void Add_Frame(const Stream_Frame& frame);
+	void Merge(const Accumulator* a) {polarization.Merge(((const Polarization_Accumulator*) a)->polarization);}
+	void Print(std::string info);
+};
+
+void Polarization_Accumulator::Add_Frame(const Stream_Frame& frame)
+{
+	C2DVector p;
+	p.Null();
+	for (int j = 0; j < frame.N; j++)
+		p += frame.particle[j].v;
+	p = p / frame.N;
+	polarization.Add_Data(sqrt(p.Square()));
+}
+
+void Polarization_Accumulator::Print(std::string info)
+{
+	polarization.Compute();
+	cout << header.density << "\t" << header.noise << "\t" << polarization.mean << "\t" << polarization.error << endl;
+}
+
+Register_Accumulator register_polarization("polarization", Make_Accumulator<Polarization_Accumulator>, {}, "");
+
+// Angular momentum of the second half of the frames like Compute_Angular_Momentum.
+class Angular_Momentum_Accumulator: public Accumulator{
+public:
+	Running_Stat angular_momentum;
+	void Init();
+	void Add_Frame(const Stream_Frame& frame);
+	void Merge(const Accumulator* a) {angular_momentum.Merge(((const Angular_Momentum_Accumulator*) a)->angular_momentum);}
+	void Print(std::string info);
+};
+
+void Angular_Momentum_Accumulator::Init()
+{
+	angular_momentum.Reset();
+	first = frames/2;
+}
+
+void Angular_Momentum_Accumulator::Add_Frame(const Stream_Frame& frame)
+{
+	double momentum = 0;
+	for (int j = 0; j < frame.N; j++)
+		momentum += (frame.particle[j].r.x * frame.particle[j].v.y - frame.particle[j].r.y * frame.particle[j].v.x);
+	angular_momentum.Add_Data(momentum / frame.N);
+}
+
+void Angular_Momentum_Accumulator::Print(std::string info)
+{
+	angular_momentum.Compute();
+	cout << header.density << "\t" << header.noise << "\t" << angular_momentum.mean << "\t" << angular_momentum.error << endl;
+}
+
+Register_Accumulator register_angular_momentum("angular-momentum", Make_Accumulator<Angular_Momentum_Accumulator>, {}, "");
+
+// Mean v_j.v_k of the pairs closer than rc in all frames like Local_Cohesion. The pairs are found by a cell list (cell-list.h), periodic = 1 takes the nearest images across the edges of the box.
+class Cohesion_Accumulator: public Accumulator{
+public:
+	Real rc;
+	long double phi;
+	long int counter;
+	Cell_List cells;
+	void Init();
+	void Add_Frame(const Stream_Frame& frame);
+	void Merge(const Accumulator* a);
+	void Print(std::string info);
+};
+
+void Cohesion_Accumulator::Init()
+{
+	rc = parameter[0];
+	phi = 0;
+	counter = 0;
+}
+
+void Cohesion_Accumulator::Add_Frame(const Stream_Frame& frame)
+{
+	cells.Build(frame.particle.data(), frame.N, header.Lx, rc, parameter[1] != 0);
+	Cohesion_Pairs(frame.particle.data(), cells, 0, cells.grid_dim, rc, phi, counter);
+}
+
+void Cohesion_Accumulator::Merge(const Accumulator* a)
+{
+	phi += ((const Cohesion_Accumulator*) a)->phi;
+	counter += ((const Cohesion_Accumulator*) a)->counter;
+}
+
+void Cohesion_Accumulator::Print(std::string info)
+{
+	cout << header.density << "\t" << header.noise << "\t" << (double) (phi / counter) << endl;
+}
+
+Register_Accumulator register_cohesion("cohesion", Make_Accumulator<Cohesion_Accumulator>, {10, 0}, "rc:periodic");
+
+// v_j.v_k of the pairs against their distance (size bins up to rc) in every step-th frame of the second half like Spatial_AutoCorrelation, by a cell list.
+class Spatial_Correlation_Accumulator: public Accumulator{
+public:
+	int size;
+	Real rc;
+	std::vector<double> bin;
+	std::vector<long int> num;
+	Cell_List cells;
+	void Init();
+	void Add_Frame(const Stream_Frame& frame);
+	void Merge(const Accumulator* a);
+	void Print(std::string info);
+};
+
+void Spatial_Correlation_Accumulator::Init()
+{
+	size = (int) parameter[0];
+	rc = parameter[1];
+	first = frames/2;
+	step = max(1, (int) parameter[2]);
+	bin.assign(size+1, 0);
+	num.assign(size+1, 0);
+}
+
+void Spatial_Correlation_Accumulator::Add_Frame(const Stream_Frame& frame)
+{
+	cells.Build(frame.particle.data(), frame.N, header.Lx, rc, parameter[3] != 0);
+	Spatial_Correlation_Pairs(frame.particle.data(), cells, 0, cells.grid_dim, size, rc, bin.data(), num.data());
+}
+
+void Spatial_Correlation_Accumulator::Merge(const Accumulator* a)
+{
+	const Spatial_Correlation_Accumulator* s = (const Spatial_Correlation_Accumulator*) a;
+	for (int x = 0; x <= size; x++)
+	{
+		bin[x] += s->bin[x];
+		num[x] += s->num[x];
+	}
+}
+
+void Spatial_Correlation_Accumulator::Print(std::string info)
+{
+	for (int x = 1; x < size; x++)
+	{
+		double r = (x*rc)/size;
+		cout << r << "\t" << ((num[x] != 0) ? (bin[x] / num[x]) : 0) << endl;
+	}
+}
+
+Register_Accumulator register_spatial_correlation("spatial-correlation", Make_Accumulator<Spatial_Correlation_Accumulator>, {50, 5, 100, 0}, "bins:rc:step:periodic");
+
+// Density against the distance from the center in logarithmic bins, all frames, like Radial_Density.
+class Radial_Density_Accumulator: public Accumulator{
+public:
+	int number_of_points;
+	double factor;
+	std::vector<double> radius, rho;
+	long int counter;
+	void Init();
+	void Add_Frame(const Stream_Frame& frame);
+	void Merge(const Accumulator* a);
+	void Print(std::string info);
+};
+
+void Radial_Density_Accumulator::Init()
+{
+	number_of_points = (int) parameter[0];
+	rho.assign(number_of_points, 0);
+	radius.resize(number_of_points);
+	radius[0] = 1;
+	factor = pow(((L+1)/radius[0]-0),1.0/number_of_points);
+	for (int i = 1; i < number_of_points; i++)
+		radius[i] = factor*radius[i-1];
+	counter = 0;
+}
+
+void Radial_Density_Accumulator::Add_Frame(const Stream_Frame& frame)
+{
+	counter++;
+	for (int j = 0; j < frame.N; j++)
+	{
+		Real r = sqrt(frame.particle[j].r.Square());
+		int index = (int) (log(r/radius[0]) / log(factor));
+		if (index >= 0 && index < number_of_points) // The corners of the box are farther than the last bin.
+			rho[index]++;
+	}
+}
+
+void Radial_Density_Accumulator::Merge(const Accumulator* a)
+{
+	const Radial_Density_Accumulator* s = (const Radial_Density_Accumulator*) a;
+	for (int i = 0; i < number_of_points; i++)
+		rho[i] += s->rho[i];
+	counter += s->counter;
+}
+
+void Radial_Density_Accumulator::Print(std::string info)
+{
+	for (int i = 1; i < number_of_points; i++)
+		cout << sqrt(radius[i-1]*radius[i]) << "\t" << rho[i] / (M_PI*(radius[i]*radius[i] - radius[i-1]*radius[i-1])) / counter << endl;
+}
+
+Register_Accumulator register_radial_density("radial-density", Make_Accumulator<Radial_Density_Accumulator>, {200}, "bins");
+
+// Density of the other particles in the frame of the velocity of a particle (grid of grid_size^2 in [-lx, lx]^2), every step-th frame of the second half, like Pair_Distribution, by a cell list.
+class Pair_Distribution_Accumulator: public Accumulator{
+public:
+	Real lx;
+	int grid_size;
+	std::vector<double> bin;
+	long int counter;
+	Cell_List cells;
+	void Init();
+	void Add_Frame(const Stream_Frame& frame);
+	void Merge(const Accumulator* a);
+	void Print(std::string info);
+};
+
+void Pair_Distribution_Accumulator::Init()
+{
+	lx = parameter[0];
+	grid_size = (int) parameter[1];
+	first = frames/2;
+	step = max(1, (int) parameter[2]);
+	bin.assign(grid_size*grid_size, 0);
+	counter = 0;
+}
+
+void Pair_Distribution_Accumulator::Add_Frame(const Stream_Frame& frame)
+{
+	cells.Build(frame.particle.data(), frame.N, header.Lx, Pair_Distribution_Range(frame.particle.data(), frame.N, lx), parameter[3] != 0);
+	Pair_Distribution_Pairs(frame.particle.data(), cells, 0, cells.grid_dim, lx, grid_size, bin.data());
+	counter++;
+}
+
+void Pair_Distribution_Accumulator::Merge(const Accumulator* a)
+{
+	const Pair_Distribution_Accumulator* s = (const Pair_Distribution_Accumulator*) a;
+	for (int i = 0; i < grid_size*grid_size; i++)
+		bin[i] += s->bin[i];
+	counter += s->counter;
+}
+
+void Pair_Distribution_Accumulator::Print(std::string info)
+{
+	for (int x = 0; x < grid_size; x++)
+	{
+		for (int y = 0; y < grid_size; y++)
+			cout << ((2.0*x)/grid_size-1)*lx << "\t" << ((2.0*y)/grid_size-1)*lx << "\t" << bin[x*grid_size + y] / (header.N*(4*lx*lx/grid_size/grid_size)) / counter << endl;
+		cout << endl;
+	}
+}
+
+Register_Accumulator register_pair_distribution("pair-distribution", Make_Accumulator<Pair_Distribution_Accumulator>, {6, 400, 100, 0}, "lx:grid:step:periodic");
+
+// Mean and variance of the number of particles in windows, for the window numbers of Compute_Fluctuation (5, 6, 7, 9, ... less than L) together, second half of the frames.
+class Fluctuation_Accumulator: public Accumulator{
+public:
+	std::vector<int> number_of_windows;
+	std::vector<std::vector<Running_Stat> > window; // number_of_windows^2 windows of each number
+	std::vector<int> Np;
+	void Init();
+	void Add_Frame(const Stream_Frame& frame);
+	void Merge(const Accumulator* a);
+	void Print(std::string info);
+};
+
+void Fluctuation_Accumulator::Init()
+{
+	first = frames/2;
+	number_of_windows.clear();
+	for (int i = 5; i < L; i = (int) (i*1.3))
+		number_of_windows.push_back(i);
+	window.resize(number_of_windows.size());
+	for (int n = 0; n < number_of_windows.size(); n++)
+		window[n].assign(number_of_windows[n]*number_of_windows[n], Running_Stat());
+}
+
+void Fluctuation_Accumulator::Add_Frame(const Stream_Frame& frame)
+{
+	for (int n = 0; n < number_of_windows.size(); n++)
+	{
+		int w = number_of_windows[n];
+		Np.assign(w*w, 0);
+		for (int j = 0; j < frame.N; j++)
+		{
+			int x = (int) floor(w*(frame.particle[j].r.x / L + 1)/2);
+			int y = (int) floor(w*(frame.particle[j].r.y / L + 1)/2);
+			Np[x*w + y]++;
+		}
+		for (int i = 0; i < w*w; i++)
+			window[n][i].Add_Data(Np[i]);
+	}
+}
+
+void Fluctuation_Accumulator::Merge(const Accumulator* a)
+{
+	const Fluctuation_Accumulator* s = (const Fluctuation_Accumulator*) a;
+	for (int n = 0; n < number_of_windows.size(); n++)
+		for (int i = 0; i < window[n].size(); i++)
+			window[n][i].Merge(s->window[n][i]);
+}
+
+void Fluctuation_Accumulator::Print(std::string info)
+{
+	for (int n = 0; n < number_of_windows.size(); n++)
+	{
+		double mean = 0, variance = 0;
+		for (int i = 0; i < window[n].size(); i++)
+		{
+			window[n][i].Compute();
+			mean += window[n][i].mean;
+			variance += window[n][i].variance;
+		}
+		cout << mean / window[n].size() << "\t" << variance / window[n].size() << endl;
+	}
+}
+
+Register_Accumulator register_fluctuation("fluctuation", Make_Accumulator<Fluctuation_Accumulator>, {}, "");
+
+// Fields on a grid averaged over all frames, drawn to figures/ like SceneSet::Plot_Averaged_Fields. The deviations of theta (Save_Theta_Deviation) are not kept.
+class Fields_Accumulator: public Accumulator{
+public:
+	Field* sum;
+	Field* f; // Field of one frame
+	Fields_Accumulator() {sum = f = NULL;}
+	~Fields_Accumulator();
+	void Init();
+	void Add_Frame(const Stream_Frame& frame);
+	void Merge(const Accumulator* a);
+	void Print(std::string info);
+};
+
+Fields_Accumulator::~Fields_Accumulator()
+{
+	delete sum;
+	delete f;
+}
+
+void Fields_Accumulator::Init()
+{
+	delete sum;
+	delete f;
+	sum = new Field((int) parameter[0], L);
+	f = new Field((int) parameter[0], L);
+}
+
+void Fields_Accumulator::Add_Frame(const Stream_Frame& frame)
+{
+	f->Compute((BasicParticle*) frame.particle.data(), frame.N);
+	for (int x = 0; x < f->grid_dim_x; x++)
+		for (int y = 0; y < f->grid_dim_x; y++)
+			f->cell[x][y].dtheta.clear();
+	sum->Add(f);
+	f->Reset();
+}
+
+void Fields_Accumulator::Merge(const Accumulator* a)
+{
+	Field* s = ((const Fields_Accumulator*) a)->sum;
+	if (s->sample > 0) // A copy that got no frames
+		sum->Add(s);
+}
+
+void Fields_Accumulator::Print(std::string info)
+{
+	sum->Average();
+	sum->Draw(info);
+}
+
+Register_Accumulator register_fields("fields", Make_Accumulator<Fields_Accumulator>, {25}, "grid");
+
+// Reads a trajectory once in order and gives each frame to all accumulators. The frames are decoded in chunks: the blocks of a chunk (compressed files) and its frames are decoded by threads, then the (frame, accumulator) pairs of the chunk are divided between the threads, each thread adds to its own copy of the accumulators. The memory is one chunk and the copies of the accumulators, whatever the length of the file.
+class Pipeline{
+public:
+	std::vector<Accumulator*> accumulator;
+	long int chunk_memory;
+
+	Pipeline();
+	~Pipeline();
+	bool Add(std::string observable); // name:parameter:parameter..., the parameters that are not given are the defaults.
+	bool Run(std::string name); // Analyze a file and print the accumulators.
+	static void Print_Usage();
+};
+
+Pipeline::Pipeline()
+{
+	chunk_memory = pipeline_chunk_memory;
+}
+
+Pipeline::~Pipeline()
+{
+	for (int a = 0; a < accumulator.size(); a++)
+		delete accumulator[a];
+}
+
+bool Pipeline::Add(std::string observable)
+{
+	std::vector<std::string> field;
+	boost::split(field, observable, boost::is_any_of(":"));
+	if (Accumulator_Registry().count(field[0]) == 0)
+		return false;
+	Accumulator_Plugin& plugin = Accumulator_Registry()[field[0]];
+	if (field.size() - 1 > plugin.default_parameter.size())
+	{
+		cout << "Too many parameters: " << observable << " (" << field[0] << ":" << plugin.usage << ")" << endl;
+		exit(0);
+	}
+	Accumulator* a = plugin.make();
+	a->name = field[0];
+	a->parameter = plugin.default_parameter;
+	for (int i = 1; i < field.size(); i++)
+		a->parameter[i-1] = atof(field[i].c_str());
+	accumulator.push_back(a);
+	return true;
+}
+
+void Pipeline::Print_Usage()
+{
+	cout << "Observables (name:parameters, the defaults are in brackets):" << endl;
+	for (std::map<std::string, Accumulator_Plugin>::iterator it = Accumulator_Registry().begin(); it != Accumulator_Registry().end(); it++)
+	{
+		cout << "\t" << it->first;
+		if (it->second.usage != "")
+			cout << ":" << it->second.usage << " [";
+		for (int i = 0; i < it->second.default_parameter.size(); i++)
+			cout << ((i > 0) ? ":" : "") << it->second.default_parameter[i];
+		if (it->second.usage != "")
+			cout << "]";
+		cout << endl;
+	}
+}
+
+// The box and the header come from SceneSet::Read (a version 1 file is read once more to find L), the frames from its mapped trajectory.
+bool Pipeline::Run(std::string name)
+{
+	SceneSet sceneset(name);
+	if (!sceneset.Read())
+		return false;
+	const Mapped_Trajectory& trajectory = sceneset.trajectory;
+	int frames = trajectory.Frames();
+	int threads = Pipeline_Threads();
+	for (int a = 0; a < accumulator.size(); a++)
+	{
+		accumulator[a]->Set_File(sceneset.header, sceneset.L - 0.5 + 0.1, frames);
+		accumulator[a]->Init();
+	}
+	std::vector<std::vector<Accumulator*> > partial(threads, std::vector<Accumulator*>(accumulator.size()));
+	for (int i = 0; i < threads; i++)
+		for (int a = 0; a < accumulator.size(); a++)
+			partial[i][a] = accumulator[a]->Clone();
+
+	int chunk_frames = max(1L, min((long int) pipeline_chunk_frames, chunk_memory / (long int) ((sizeof(BasicParticle) + 4*sizeof(float))*max(1, sceneset.header.N))));
+	std::vector<Stream_Frame> frame;
+	std::vector<const float*> data;
+	std::vector<std::vector<float> > block_buffer;
+	std::vector<std::pair<int, int> > task; // (frame of the chunk, accumulator)
+	for (int t0 = 0; t0 < frames;)
+	{
+		int t1 = min(frames, t0 + chunk_frames);
+		if (trajectory.header.codec == 1)
+		{
+			int b = trajectory.frame_block[t1-1] + 1;
+			t1 = (b < trajectory.Blocks()) ? trajectory.block_start[b] : frames;
+		}
+		std::vector<bool> used(t1 - t0, false);
+		task.clear();
+		for (int t = t0; t < t1; t++)
+			for (int a = 0; a < accumulator.size(); a++)
+				if (accumulator[a]->Use(t))
+				{
+					used[t - t0] = true;
+					task.push_back(std::make_pair(t - t0, a));
+				}
+		if (task.size() == 0)
+		{
+			t0 = t1;
+			continue;
+		}
+
+		data.resize(t1 - t0);
+		if (trajectory.header.codec == 1)
+		{
+			int b0 = trajectory.frame_block[t0];
+			int blocks = trajectory.frame_block[t1-1] - b0 + 1;
+			if (block_buffer.size() < blocks)
+				block_buffer.resize(blocks);
+			#pragma omp parallel for schedule(dynamic)
+			for (int b = 0; b < blocks; b++)
+			{
+				int start = trajectory.block_start[b0 + b];
+				int end = (b0 + b + 1 < trajectory.Blocks()) ? trajectory.block_start[b0 + b + 1] : frames;
+				bool is_used = false;
+				for (int t = start; t < end; t++)
+					is_used = is_used || used[t - t0];
+				if (!is_used)
+					continue;
+				block_buffer[b].resize(4L*trajectory.N(start)*(end - start));
+				trajectory.Decode_Block(b0 + b, block_buffer[b].data());
+				for (int t = start; t < end; t++)
+					data[t - t0] = block_buffer[b].data() + 4L*trajectory.N(t)*(t - start);
+			}
+		}
+		else
+			for (int t = t0; t < t1; t++)
+				data[t - t0] = trajectory.View(t);
+
+		if (frame.size() < t1 - t0)
+			frame.resize(t1 - t0);
+		#pragma omp parallel for schedule(dynamic)
+		for (int t = t0; t < t1; t++)
+			if (used[t - t0])
+				frame[t - t0].Decode(t, trajectory.N(t), data[t - t0]);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int k = 0; k < task.size(); k++)
+			partial[Pipeline_Thread_Id()][task[k].second]->Add_Frame(frame[task[k].first]);
+		t0 = t1;
+	}
+
+	for (int a = 0; a < accumulator.size(); a++)
+	{
+		for (int i = 0; i < threads; i++)
+		{
+			accumulator[a]->Merge(partial[i][a]);
+			delete partial[i][a];
+		}
+		cout << "# " << accumulator[a]->name;
+		for (int i = 0; i < accumulator[a]->parameter.size(); i++)
+			cout << ((i > 0) ? ":" : " ") << accumulator[a]->parameter[i];
+		cout << endl;
+		accumulator[a]->Print(sceneset.info);
+	}
+	return true;
+}
+
+#endif
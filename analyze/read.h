@@ -3,6 +3,7 @@
 
 #include "../shared/c2dvector.h"
 #include "field.h"
+#include "scene-cache.h"
 #include <boost/algorithm/string.hpp>
 
 class Scene{
@@ -18,6 +19,7 @@ public:
 	void Reset();
 	void Auto_Correlation();
 	void Skip_File(std::istream& is, int n);
+	void Decode(int N, const float* data); // Decode a frame of the file (x, y, vx, vy of each particle) to the particles.
 	friend std::istream& operator>>(std::istream& is, Scene& scene);
 	friend std::ostream& operator<<(std::ostream& os, Scene& scene);
 };
@@ -49,6 +51,7 @@ void Scene::Init(int num)
 void Scene::Reset()
 {
 	delete [] particle;
+	particle = NULL;
 }
 
 void Scene::Skip_File(std::istream& in, int n)
@@ -65,6 +68,21 @@ void Scene::Skip_File(std::istream& in, int n)
 	}
 }
 
+// The particles are made if they are not.
+void Scene::Decode(int N, const float* data)
+{
+	number_of_particles = N;
+	if (particle == NULL)
+		particle = new BasicParticle[number_of_particles];
+	for (int i = 0; i < number_of_particles; i++)
+	{
+		particle[i].r.x = data[4*i];
+		particle[i].r.y = data[4*i+1];
+		particle[i].v.x = data[4*i+2];
+		particle[i].v.y = data[4*i+3];
+	}
+}
+
 std::istream& operator>>(std::istream& is, Scene& scene)
 {
 	is.read((char*) &(scene.number_of_particles), sizeof(int) / sizeof(char));
@@ -86,21 +104,26 @@ std::ostream& operator<<(std::ostream& os, Scene& scene)
 	}
 }
 
+// The file is mapped to memory and scene[t] is decoded when it is used (scene-cache.h), so the file can be larger than the memory. A reference to scene[t] is valid until scene_cache_min_frames other frames are used.
 class SceneSet{
 public:
-	vector<Scene> scene;
+	Scene_Cache<Scene> scene;
+	Mapped_Trajectory trajectory;
 	Real L;
 	Real L_min;
 	stringstream address;
 	string info;
-	ifstream input_file;
 	ofstream output_file;
 	Field* field;
+	Trajectory_Header header; // Header of the file, for a version 1 file only version and N are known until it is read.
 
 	SceneSet(string input_address);
 	~SceneSet();
+	bool Open(); // Map the file and read its header and the index of the frames.
+	int Frames() const {return trajectory.Frames();}
+	void Set_Cache_Budget(long int bytes); // Memory of the decoded frames
 	bool Read(int skip = 0);
-	void Write(int, int); // write from a time to the end
+	void Write(int, int); // write from a time to the end, in version 2
 	void Save_Theta_Deviation(int, int, int, string);
 	void Plot_Fields(int, int, string);
 	void Plot_Averaged_Fields(int grid_dim, string name);
@@ -127,60 +150,81 @@ SceneSet::SceneSet(string input_address) : L(0)
 
 SceneSet::~SceneSet()
 {
-	for (int i = 0; i < scene.size(); i++)
-		scene[i].Reset();
-	scene.clear();
+	scene.Clear();
+	trajectory.Close();
+}
+
+// The density and noise of a version 2 file are in its header, they replace the ones from the name of the file.
+bool SceneSet::Open()
+{
+	scene.Clear();
+	if (!trajectory.Open(address.str()))
+		return (false);
+	header = trajectory.header;
+	if (header.version == trajectory_version)
+	{
+		Scene::density = header.density;
+		Scene::noise = header.noise;
+	}
+	return (true);
+}
+
+void SceneSet::Set_Cache_Budget(long int bytes)
+{
+	scene.Set_Budget(bytes);
 }
 
+// Only the index is read, the frames are decoded when they are used. The box size of a version 1 file is not saved, it is found from the farthest particle of the mapped frames.
 bool SceneSet::Read(int skip)
 {
-	int counter = 0;
-	static Scene temp_scene;
 	L = 0;
 
-	input_file.open(address.str().c_str());
-	if (input_file.is_open())
-	{
-		if (skip > 0)
-			temp_scene.Skip_File(input_file, skip);
+	if (!Open())
+		return (false);
+	scene.Init(&trajectory, skip, scene.budget);
+	if (scene.size() == 0)
+		return (false);
+	Scene::number_of_particles = trajectory.N(skip);
 
-		while (!input_file.eof())
+	if (header.version == 1)
+	{
+		for (int t = skip; t < trajectory.Frames(); t++)
 		{
-			counter++;
-			input_file >> temp_scene;
-			scene.push_back(temp_scene);
-			for (int i = 0; i < Scene::number_of_particles; i++)
+			const float* data = trajectory.View(t);
+			for (int i = 0; i < trajectory.N(t); i++)
 			{
-				if (abs(temp_scene.particle[i].r.x) > L)
-					L = abs(temp_scene.particle[i].r.x);
-				if (abs(temp_scene.particle[i].r.y) > L)
-					L = abs(temp_scene.particle[i].r.y);
+				if (abs(data[4*i]) > L)
+					L = abs(data[4*i]);
+				if (abs(data[4*i+1]) > L)
+					L = abs(data[4*i+1]);
 			}
-			if (counter*sizeof(temp_scene) > (3000000000))
-				return(false);
 		}
+		L = round(L+0.1);
+		Convert_Trajectory_Header(header, L, Scene::density, Scene::noise, info);
 	}
 	else
-		return (false);
-	input_file.close();
-
-	scene.pop_back();
-
-	L = round(L+0.1);
+		L = header.Lx;
 	L_min = L;
 	L += 0.5;
 
 	return (true);
 }
 
+// The frames are written from the mapped file to name.tmp with the same codec, name.tmp is renamed to the name of the file at the end, so the mapped file is not changed while it is read.
 void SceneSet::Write(int start, int limit)
 {
 	if ((scene.size() - start) > limit)
 	{
-		output_file.open(address.str().c_str());
-		for (int i = start; i < scene.size(); i++)
-			output_file << scene[i];
+		string temp_name = address.str() + ".tmp";
+		output_file.open(temp_name.c_str(), ios::binary);
+		output_file.write((char*) &header, sizeof(header));
+		Frame_Writer frame_writer;
+		frame_writer.Init(header);
+		for (int i = scene.first + start; i < trajectory.Frames(); i++)
+			frame_writer.Write(output_file, trajectory.View(i), trajectory.N(i));
+		frame_writer.Close(output_file);
 		output_file.close();
+		rename(temp_name.c_str(), address.str().c_str());
 	}
 	else
 		cout << "I will not cut the file because it is short enough!" << endl;
@@ -0,0 +1,217 @@
+#ifndef _SCENE_CACHE_
+#define _SCENE_CACHE_
+
+#include "../shared/trajectory-format.h"
+#include <list>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Default memory of the decoded frames of a SceneSet (bytes), it can be changed by SceneSet::Set_Cache_Budget.
+const long int scene_cache_budget = 2000000000;
+// The last scene_cache_min_frames frames that are used are never removed from the cache, even if they are more than the budget, so an expression can use several frames together (s->scene[t].particle[i].r - s->scene[t+tau].particle[i].r).
+const int scene_cache_min_frames = 8;
+
+// Trajectory file mapped to memory (mmap) with the index of its frames (shared/trajectory-format.h). The frames are read by the operating system when they are used, so the file can be larger than the memory. View gives the floats of a frame in the file without copying them. The frames of a compressed file (codec 1) are not in the file, View decodes the block of the frame and keeps the last decoded block (Decode_Block can be called by threads to decode other blocks at the same time).
+class Mapped_Trajectory{
+public:
+	Trajectory_Header header;
+	std::vector<long int> frame_offset;
+	const char* data;
+	long int file_size;
+	std::vector<int> block_start; // First frame of each block of a compressed file
+	std::vector<int> frame_block; // Block of each frame of a compressed file
+	mutable std::vector<float> block_buffer; // The last decoded block
+	mutable int buffered_block;
+
+	Mapped_Trajectory();
+	~Mapped_Trajectory();
+
+	bool Open(const std::string name);
+	void Close();
+	int Frames() const {return frame_offset.size();}
+	int Blocks() const {return block_start.size();}
+	int N(int t) const {return ((header.codec == 0) ? *((const int*) (data + frame_offset[t])) : ((const Codec_Block_Header*) (data + frame_offset[t]))->N);}
+	const float* View(int t) const; // x, y, vx, vy of each particle of frame t
+	const char* Raw(int t) const {return (data + frame_offset[t]);} // Frame t (or its block) as it is in the file
+	void Decode_Block(int b, float* frames) const; // Decode block b of a compressed file, N*4 floats of each of its frames
+};
+
+Mapped_Trajectory::Mapped_Trajectory()
+{
+	data = NULL;
+	file_size = 0;
+	buffered_block = -1;
+}
+
+Mapped_Trajectory::~Mapped_Trajectory()
+{
+	Close();
+}
+
+bool Mapped_Trajectory::Open(const std::string name)
+{
+	Close();
+	std::ifstream index_file(name.c_str(), std::ios::binary);
+	if (!index_file.is_open() || !Read_Trajectory_Index(index_file, header, frame_offset))
+		return false;
+	index_file.close();
+
+	int fd = open(name.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat file_stat;
+	fstat(fd, &file_stat);
+	file_size = file_stat.st_size;
+	void* map = (file_size > 0) ? mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd); // The mapping stays after the file is closed.
+	if (map == MAP_FAILED)
+	{
+		frame_offset.clear();
+		return false;
+	}
+	data = (const char*) map;
+	if (header.codec == 1)
+		for (int t = 0; t < frame_offset.size(); t++)
+		{
+			if (t == 0 || frame_offset[t] != frame_offset[t-1])
+				block_start.push_back(t);
+			frame_block.push_back(block_start.size() - 1);
+		}
+	return true;
+}
+
+const float* Mapped_Trajectory::View(int t) const
+{
+	if (header.codec == 0)
+		return ((const float*) (data + frame_offset[t] + sizeof(int)));
+	int b = frame_block[t];
+	if (b != buffered_block)
+	{
+		const Codec_Block_Header* block = (const Codec_Block_Header*) Raw(t);
+		block_buffer.resize(4L*block->N*block->frames);
+		Decode_Block(b, block_buffer.data());
+		buffered_block = b;
+	}
+	return (block_buffer.data() + 4L*N(t)*(t - block_start[b]));
+}
+
+void Mapped_Trajectory::Decode_Block(int b, float* frames) const
+{
+	::Decode_Block(Raw(block_start[b]), header.Lx, header.Ly, header.position_bits, header.angle_bits, frames);
+}
+
+void Mapped_Trajectory::Close()
+{
+	if (data != NULL)
+		munmap((void*) data, file_size);
+	data = NULL;
+	file_size = 0;
+	frame_offset.clear();
+	block_start.clear();
+	frame_block.clear();
+	block_buffer.clear();
+	buffered_block = -1;
+}
+
+// Decoded (double) scenes of the frames of a mapped trajectory. A frame is decoded when it is used for the first time and it is kept until the decoded frames are more than the budget, then the least recently used ones are removed. SceneType needs particle (NULL when it is not decoded), Decode(N, floats) and Reset(). It is not thread safe, all frames that threads use must be decoded before.
+template<class SceneType>
+class Scene_Cache{
+public:
+	const Mapped_Trajectory* trajectory;
+	int first; // The first frame of the file that is used (the frames before it are skipped)
+	long int budget; // Bytes
+	long int used;
+	std::vector<SceneType> frame;
+	std::vector<long int> frame_bytes;
+	std::list<int> lru; // Decoded frames, the most recently used first
+	std::vector<std::list<int>::iterator> lru_position;
+
+	Scene_Cache();
+	~Scene_Cache();
+
+	void Init(const Mapped_Trajectory* input_trajectory, int input_first, long int input_budget = scene_cache_budget);
+	void Clear();
+	void Set_Budget(long int input_budget);
+	int size() const {return frame.size();}
+	SceneType& operator[](int t);
+};
+
+template<class SceneType>
+Scene_Cache<SceneType>::Scene_Cache()
+{
+	trajectory = NULL;
+	first = 0;
+	budget = scene_cache_budget;
+	used = 0;
+}
+
+template<class SceneType>
+Scene_Cache<SceneType>::~Scene_Cache()
+{
+	Clear();
+}
+
+template<class SceneType>
+void Scene_Cache<SceneType>::Init(const Mapped_Trajectory* input_trajectory, int input_first, long int input_budget)
+{
+	Clear();
+	trajectory = input_trajectory;
+	first = min(input_first, trajectory->Frames());
+	budget = input_budget;
+	frame.resize(trajectory->Frames() - first);
+	frame_bytes.assign(frame.size(), 0);
+	lru_position.resize(frame.size());
+}
+
+template<class SceneType>
+void Scene_Cache<SceneType>::Clear()
+{
+	for (std::list<int>::iterator it = lru.begin(); it != lru.end(); it++)
+		frame[*it].Reset();
+	lru.clear();
+	frame.clear();
+	frame_bytes.clear();
+	lru_position.clear();
+	used = 0;
+}
+
+template<class SceneType>
+void Scene_Cache<SceneType>::Set_Budget(long int input_budget)
+{
+	budget = input_budget;
+}
+
+template<class SceneType>
+SceneType& Scene_Cache<SceneType>::operator[](int t)
+{
+	SceneType& scene = frame[t];
+	if (scene.particle != NULL)
+	{
+		lru.splice(lru.begin(), lru, lru_position[t]);
+		return scene;
+	}
+
+	int N = trajectory->N(first + t);
+	long int bytes = N*sizeof(*scene.particle);
+	while (used + bytes > budget && lru.size() >= scene_cache_min_frames)
+	{
+		int old = lru.back();
+		lru.pop_back();
+		frame[old].Reset();
+		used -= frame_bytes[old];
+	}
+	scene.Decode(N, trajectory->View(first + t));
+	frame_bytes[t] = bytes;
+	used += bytes;
+	lru.push_front(t);
+	lru_position[t] = lru.begin();
+	return scene;
+}
+
+#endif
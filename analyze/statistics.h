@@ -1,3 +1,6 @@
+#ifndef _STATISTICS_
+#define _STATISTICS_
+
 #include <iostream>
 #include <numeric>
 #include <vector>
@@ -36,3 +39,51 @@ template <class T> void Stat<T>::Add_Data(T input)
 	data.push_back(input);
 }
 
+// Mean and variance of the data from its sums, the data is not kept so the memory does not grow with it. Merge adds the data of another one, like they were added to one Running_Stat. mean, std, error and variance are the same as Stat.
+class Running_Stat{
+public:
+	long int n;
+	double sum, sum2;
+	double mean, std, error, variance;
+	Running_Stat();
+	void Compute();
+	void Reset();
+	void Add_Data(double input);
+	void Merge(const Running_Stat& s);
+};
+
+Running_Stat::Running_Stat()
+{
+	Reset();
+}
+
+void Running_Stat::Compute()
+{
+	mean = sum / n;
+	variance = sum2 / n - mean*mean;
+	std = sqrt(variance);
+	error = sqrt(variance / n);
+}
+
+void Running_Stat::Reset()
+{
+	n = 0;
+	sum = sum2 = 0;
+	mean = std = error = variance = 0;
+}
+
+void Running_Stat::Add_Data(double input)
+{
+	n++;
+	sum += input;
+	sum2 += input*input;
+}
+
+void Running_Stat::Merge(const Running_Stat& s)
+{
+	n += s.n;
+	sum += s.sum;
+	sum2 += s.sum2;
+}
+
+#endif
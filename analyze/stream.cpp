@@ -0,0 +1,41 @@
+#include<iostream>
+#include<cstdlib>
+#include<vector>
+
+#include"pipeline.h"
+
+using namespace std;
+
+// ./stream.out observables files: each file is read once and all observables are computed together (pipeline.h), e.g.
+// ./stream.out polarization spatial-correlation:50:5 fields:25 rho=...-r-v.bin
+// -m bytes sets the memory of the frames that are decoded together.
+int main(int argc, char** argv)
+{
+	C2DVector::Init_Rand(321);
+
+	Pipeline pipeline;
+	vector<string> files;
+	for (int i = 1; i < argc; i++)
+	{
+		string argument = argv[i];
+		if (argument == "-m" && i + 1 < argc)
+			pipeline.chunk_memory = atol(argv[++i]);
+		else if (!pipeline.Add(argument))
+			files.push_back(argument);
+	}
+	if (pipeline.accumulator.size() == 0 || files.size() == 0)
+	{
+		cout << "./stream.out [-m bytes] observables files" << endl;
+		Pipeline::Print_Usage();
+		return 0;
+	}
+
+	for (int i = 0; i < files.size(); i++)
+	{
+		cout << "# " << files[i] << endl;
+		if (!pipeline.Run(files[i]))
+			cout << "Was not able to open file: " << files[i] << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+#ifndef _TIME_CORRELATION_
+#define _TIME_CORRELATION_
+
+#include "read.h"
+#include <gsl/gsl_fft_complex.h>
+#include <vector>
+
+// Memory of the time series of the particles (bytes). If the series of all particles are more than this, the particles are taken in groups and the frames are read once for each group.
+const long int time_correlation_memory = 2000000000;
+
+// c[tau] += sum_t x_t.x_{t+tau} for tau < T, where z = x (2D vector) + i y is a complex series of T numbers (2T doubles, it is changed and has room for 2n). It is padded with zeros to n >= 2T (a power of 2), so the correlation of the FFT (Wiener-Khinchin) is not periodic: Re IFFT(|FFT(z)|^2)[tau] = sum_t (x_t x_{t+tau} + y_t y_{t+tau}).
+void Add_Autocorrelation(double* z, int T, int n, double* c)
+{
+	for (int k = 2*T; k < 2*n; k++)
+		z[k] = 0;
+	gsl_fft_complex_radix2_forward(z, 1, n);
+	for (int k = 0; k < n; k++)
+	{
+		z[2*k] = z[2*k]*z[2*k] + z[2*k+1]*z[2*k+1];
+		z[2*k+1] = 0;
+	}
+	gsl_fft_complex_radix2_inverse(z, 1, n);
+	for (int tau = 0; tau < T; tau++)
+		c[tau] += z[2*tau];
+}
+
+// Velocity autocorrelation <v_i(t).v_i(t+tau)> and mean squared displacement <|r_i(t+tau) - r_i(t)|^2> of the frames of s, averaged over the particles and all time origins t, for tau = 0 ... T-1 (NULL for the one that is not needed). They take O(N T log T) instead of O(N T^2).
+// The frames are read in order and the positions are unwrapped on the fly: the change of a position between two frames is taken with the nearest image, so a particle that crosses the edge of the box goes on, a particle must move less than half of the box between two frames. The FFTs of the particles are divided between threads (-fopenmp), each with its own sums.
+// MSD(tau) = (sum_{t < T-tau} (|r_t|^2 + |r_{t+tau}|^2) - 2 sum_t r_t.r_{t+tau}) / (T-tau), the first sum is found for all tau by removing two terms from the one before.
+bool Time_Correlations(SceneSet* s, std::vector<double>* vacf, std::vector<double>* msd)
+{
+	const Mapped_Trajectory& trajectory = s->trajectory;
+	int first = s->scene.first;
+	int T = s->scene.size();
+	int N = trajectory.N(first);
+	for (int t = 0; t < T; t++)
+		if (trajectory.N(first + t) != N)
+		{
+			cout << "Error: the number of particles of frame " << first + t << " is not " << N << ", time correlations need the same particles in all frames" << endl;
+			return (false);
+		}
+	double Lx = s->header.Lx;
+	double Ly = s->header.Ly;
+	int n = 1;
+	while (n < 2*T)
+		n *= 2;
+	if (vacf != NULL)
+		vacf->assign(T, 0);
+	if (msd != NULL)
+		msd->assign(T, 0);
+	int series = (vacf != NULL) + (msd != NULL);
+	int group = (int) max(1L, min((long int) N, time_correlation_memory / (long int) (2*sizeof(double)*T*max(series, 1))));
+
+	std::vector<double> v, r, last; // Series of the particles of the group (2T doubles each) and the positions of the frame before
+	for (int g0 = 0; g0 < N; g0 += group)
+	{
+		int g = min(group, N - g0);
+		if (vacf != NULL)
+			v.resize(2L*T*g);
+		if (msd != NULL)
+		{
+			r.resize(2L*T*g);
+			last.resize(2*g);
+		}
+		for (int t = 0; t < T; t++)
+		{
+			const float* frame = trajectory.View(first + t) + 4L*g0;
+			#pragma omp parallel for schedule(static)
+			for (int i = 0; i < g; i++)
+			{
+				if (vacf != NULL)
+				{
+					v[2L*T*i + 2*t] = frame[4*i+2];
+					v[2L*T*i + 2*t+1] = frame[4*i+3];
+				}
+				if (msd != NULL)
+				{
+					double* ri = r.data() + 2L*T*i;
+					if (t == 0)
+						ri[0] = ri[1] = 0; // The displacement from the first frame
+					else
+					{
+						double dx = frame[4*i] - last[2*i];
+						double dy = frame[4*i+1] - last[2*i+1];
+						ri[2*t] = ri[2*t-2] + dx - 2*Lx*round(dx / (2*Lx));
+						ri[2*t+1] = ri[2*t-1] + dy - 2*Ly*round(dy / (2*Ly));
+					}
+					last[2*i] = frame[4*i];
+					last[2*i+1] = frame[4*i+1];
+				}
+			}
+		}
+
+		#pragma omp parallel
+		{
+			std::vector<double> z(2*n), sum_vacf(T, 0), sum_msd(T, 0), correlation(T);
+			#pragma omp for schedule(static)
+			for (int i = 0; i < g; i++)
+			{
+				if (vacf != NULL)
+				{
+					std::copy(v.begin() + 2L*T*i, v.begin() + 2L*T*(i+1), z.begin());
+					Add_Autocorrelation(z.data(), T, n, sum_vacf.data());
+				}
+				if (msd != NULL)
+				{
+					const double* ri = r.data() + 2L*T*i;
+					std::copy(ri, ri + 2*T, z.begin());
+					correlation.assign(T, 0);
+					Add_Autocorrelation(z.data(), T, n, correlation.data());
+					double square_sum = 0;
+					for (int t = 0; t < T; t++)
+						square_sum += 2*(ri[2*t]*ri[2*t] + ri[2*t+1]*ri[2*t+1]);
+					for (int tau = 0; tau < T; tau++)
+					{
+						if (tau > 0)
+						{
+							int a = tau-1, b = T-tau;
+							square_sum -= ri[2*a]*ri[2*a] + ri[2*a+1]*ri[2*a+1] + ri[2*b]*ri[2*b] + ri[2*b+1]*ri[2*b+1];
+						}
+						sum_msd[tau] += square_sum - 2*correlation[tau];
+					}
+				}
+			}
+			#pragma omp critical
+			for (int tau = 0; tau < T; tau++)
+			{
+				if (vacf != NULL)
+					(*vacf)[tau] += sum_vacf[tau];
+				if (msd != NULL)
+					(*msd)[tau] += sum_msd[tau];
+			}
+		}
+	}
+
+	for (int tau = 0; tau < T; tau++)
+	{
+		if (vacf != NULL)
+			(*vacf)[tau] /= (double) N*(T - tau);
+		if (msd != NULL)
+			(*msd)[tau] /= (double) N*(T - tau);
+	}
+	return (true);
+}
+
+#endif
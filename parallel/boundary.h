@@ -2,32 +2,65 @@
 #define _BOUNDARY_
 
 #include "mpi.h"
+#include <cstring>
+
+// Compact halo: in each step the particles of boundary cells are sent with x and y as float offsets from the position of their cell (Cell::r) and theta as a 16 bit number in [0, 2 PI). That is 10 bytes instead of 24 bytes per particle. A 16 bit position is not enough, the repulsion of close particles is too sensitive to it.
+const int halo_bytes = 2*sizeof(float) + sizeof(unsigned short);
+const Real halo_angle_scale = 65536 / (2*PI);
+
+// Number of doubles of a particle record of the cell update, (id, x, y, theta) and the tangent vectors of the particle (tangent.h) if there are.
+inline int Record_Size() {return (4 + 3*Tangent::num);}
 
 struct Boundary{
 // Any node has a list of boundaries. Each boundary is aware of the node that it belongs to (this_node_id) and the node that it is connecting this_node_id to (that_node_id).
 	int this_node_id;
 	int that_node_id;
-	int tag; // Tag is used for the message tags of our MPI. We must give to each boundary a uniqe tag to avoid confilicts.
+	MPI_Comm comm; // Communicator of the grid of nodes
+	int tag; // Tag is used for the message tags of our MPI. It is the label (direction) of the boundary, the neighbor receives the message with its opposite boundary that has tag (tag+4)%8.
 	bool is_active; // This gives information about the boundary state, whether it is an inactive boundary (no real data transformation) or an active boundary (data must be transferred). For example if the boundary condition is a bounded box, the boundaries at the edges of the box are inactive becasue there is no neighboring node beyond the boundary.
 	bool box_edge; // This give information about the boundary that is at the edge of the box or not
+	int dx, dy; // Direction of the boundary, for example (1,0) for right and (-1,1) for up left.
+	C2DVector edge; // Position of the edge of thisnode at this boundary. edge.x is the x of the right (left) edge if dx is 1 (-1), the same for edge.y
+	Real* shared_data; // Shared memory of that_node if it is on the same computer, otherwise NULL. (see Node::Init_Shared_Memory)
 	vector<Cell*> this_cell; // the cells at the boundary that are in the this_node
 	vector<Cell*> that_cell; // the cells at the boundary that are in the that_node
+// Buffers of the non-blocking messages. They must be alive until the messages are finished.
+	vector<double> send_data, receive_data;
+	vector<double> send_tangent, receive_tangent;
+	vector<char> send_compact, receive_compact;
+	vector<int> send_size, send_index;
 
 	Boundary();
 	Boundary(const Boundary& b); // Copy constructor, because we want to manipulate boundaries by a vector (pushback) we need a copy constructor.
 	~Boundary(); // We need temporary boundary objects, because a boundary object has pointer we have to make sure that the allocated space is freed to avoid memmory leak.
 	void Delete(); // Freeing memory that is used by a boundary object
 
-	void Send_Data(); // Send the data of particles in this_cell of boundary of this_node to that_cell of boundary of that_node. We suppose that the particle indices of that_cells are known exactly and use this to enhance our computation.
-	void Receive_Data(); // Receive data of particles inside that cell wich are inside this_cell of that_node. We suppose that the particle indices of that_cells are known exactly and use this to enhance our computation.
-	void Send_Particle_Ids(); // Send particle ids that are inside this_cell to the neighboring node. Befor sending data each node must be aware of its neighboring node particles at boundary.
-	void Receive_Particle_Ids(); // Receive particle ids that are inside that_cell of neighboring node to this cell. Befor sending data each node must be aware of its neighboring node particles at boundary.
+// All send and receive functions are non-blocking. They add their request to the request list and the node must wait for all of them to finish (MPI_Waitall) before using the received data or changing the cells.
+	bool Near_Edge(int index); // Check if the particle is within the verlet radius (rv) of the edge. Other particles can not be a neighbor of the particles of the neighboring node.
+	void Send_Data(vector<MPI_Request>& request, bool compact); // Send the data of particles in this_cell of boundary of this_node to that_cell of boundary of that_node. We suppose that the particle indices of that_cells are known exactly and use this to enhance our computation. If compact is true the data is sent compact (see halo_bytes).
+	void Receive_Data(vector<MPI_Request>& request, bool compact); // Receive data of particles inside that cell wich are inside this_cell of that_node. We suppose that the particle indices of that_cells are known exactly and use this to enhance our computation.
+	void Unpack_Data(bool compact); // Copy the received data to the particles of that_cell.
+	void Write_Shared(Real* data); // Write x, y and theta of the particles in send_index to the shared memory of thisnode. Each particle has its place by its id.
+	void Read_Shared(Real* data); // Read the particles of that_cell from the shared memory of that_node.
+	void Send_Tangent(vector<MPI_Request>& request); // Send the tangent vectors of the particles in send_index, the same particles as Send_Data. The tags are shifted by 8 to not be mixed with the data.
+	void Receive_Tangent(vector<MPI_Request>& request);
+	void Unpack_Tangent(); // Copy the received tangent vectors to the particles of that_cell and null their sums.
+// The messages of the cell update describe their own size, the receiver finds it by a probe. Each particle is sent as (id, x, y, theta) in double followed by its tangent vectors (Record_Size), the ids are exact in a double.
+	void Receive_Records(); // Blocking receive of a message of unknown size to receive_data.
+	void Unpack_Record(int n, int& index); // Copy n'th received particle record to its particle, index is the id of the particle.
+	void Send_Migrants(vector<MPI_Request>& request); // Send the particles of thisnode that moved to that_cells (the cells of the neighboring node).
+	void Receive_Migrants(vector<int>& immigrant); // Receive the particles that moved to thisnode and add them to the immigrant list.
+	void Send_Ghosts(vector<MPI_Request>& request); // Send the ids and exact data of the particles near the edge in this_cells. The message is [number of particles in each this_cell, particle records]. Only these particles are sent in the next steps by Send_Data.
+	void Receive_Ghosts(); // Put the received particles in that_cells.
 	void Print_Info();
 };
 
 Boundary::Boundary()
 {
+	comm = MPI_COMM_WORLD;
 	tag = -1;
+	dx = dy = 0;
+	shared_data = NULL;
 	box_edge = false;
 	is_active = true;
 }
@@ -38,8 +71,14 @@ Boundary::Boundary(const Boundary& b)
 	Delete();
 	this_node_id = b.this_node_id;
 	that_node_id = b.that_node_id;
+	comm = b.comm;
+	dx = b.dx;
+	dy = b.dy;
+	edge = b.edge;
+	shared_data = b.shared_data;
 	tag = b.tag;
 	is_active = b.is_active;
+	box_edge = b.box_edge;
 	for (int i = 0; i < b.this_cell.size(); i++)
 		this_cell.push_back(b.this_cell[i]);
 	for (int i = 0; i < b.that_cell.size(); i++)
@@ -60,115 +99,294 @@ void Boundary::Delete()
 	that_node_id = -1;
 }
 
-void Boundary::Send_Data()
+bool Boundary::Near_Edge(int index)
 {
-// First we need to find the data size.
-	int data_size = 0;
-// Go over all bondary cells:
-	for (int i = 0; i < this_cell.size(); i++)
-		data_size += this_cell[i]->pid.size(); // Summing particles of each neighboring cell
-	data_size *= 3; // each particle has 3 double values (x,y and theta).
-	double* data_buffer = new double[data_size]; // Allocating buffer array
+	Particle* p = Cell::particle;
+	if (dx != 0 && abs(p[index].r.x - edge.x) >= Particle::rv)
+		return false;
+	if (dy != 0 && abs(p[index].r.y - edge.y) >= Particle::rv)
+		return false;
+	return true;
+}
 
-	int shift = 0; // We need to have a track of the last element of data_buffer that we wrote.
-// Go over particle ids of each boundary cell
-	for (int i = 0; i < this_cell.size(); i++)
+// The particles that are sent are in send_index, that is the list of particles near the edge in the order of this_cells. The neighboring node has the same list in its that_cells.
+void Boundary::Send_Data(vector<MPI_Request>& request, bool compact)
+{
+	request.push_back(MPI_REQUEST_NULL);
+	if (compact)
 	{
-		for (int j = 0; j < this_cell[i]->pid.size(); j++)
+		send_compact.resize(halo_bytes*send_index.size());
+		int shift = 0;
+		for (int i = 0; i < this_cell.size(); i++)
 		{
-			int index = this_cell[i]->pid[j]; // This is just for convinience. Save pid of j'th particle in i'th this_cell to index.
-// save the index'th particle data to data_buffer
-			data_buffer[shift+3*j] = this_cell[i]->particle[index].r.x; // The particles could be accessed through Cell class
-			data_buffer[shift+3*j+1] = this_cell[i]->particle[index].r.y;
-			data_buffer[shift+3*j+2] = this_cell[i]->particle[index].theta;
+			for (int j = 0; j < send_size[i]; j++)
+			{
+				Particle& p = Cell::particle[send_index[shift+j]];
+				C2DVector dr = p.r - this_cell[i]->r; // Offset from the cell
+				#ifdef PERIODIC_BOUNDARY_CONDITION
+					dr.Periodic_Transform();
+				#endif
+				float offset[2] = {(float) dr.x, (float) dr.y};
+				Real angle = p.theta - 2*PI*floor(p.theta / (2*PI)); // theta is not bounded, we need it in [0, 2 PI)
+				unsigned short angle_16 = ((int) (angle*halo_angle_scale + 0.5)) % 65536;
+				char* buffer = &send_compact[halo_bytes*(shift+j)];
+				memcpy(buffer, offset, sizeof(offset));
+				memcpy(buffer + sizeof(offset), &angle_16, sizeof(angle_16));
+			}
+			shift += send_size[i];
 		}
-		shift += 3*this_cell[i]->pid.size(); // the last element id must be added with amount of data that we added in the for loop.
+		MPI_Isend(send_compact.data(),send_compact.size(),MPI_BYTE,that_node_id,tag,comm,&request.back());
+		return;
 	}
-	MPI_Send(data_buffer,data_size,MPI_DOUBLE,that_node_id,tag,MPI_COMM_WORLD);
-	delete [] data_buffer;
+
+	send_data.resize(3*send_index.size()); // The buffer is kept for the next steps, it is sent with a non-blocking send and must be valid until the send is finished.
+// Go over particle ids of each boundary cell
+	for (int i = 0; i < send_index.size(); i++)
+	{
+		int index = send_index[i]; // This is just for convinience.
+// save the index'th particle data to data_buffer
+		send_data[3*i] = Cell::particle[index].r.x; // The particles could be accessed through Cell class
+		send_data[3*i+1] = Cell::particle[index].r.y;
+		send_data[3*i+2] = Cell::particle[index].theta;
+	}
+	MPI_Isend(send_data.data(),send_data.size(),MPI_DOUBLE,that_node_id,tag,comm,&request.back());
 }
 
-void Boundary::Receive_Data()
+void Boundary::Receive_Data(vector<MPI_Request>& request, bool compact)
 {
 // First we need to find the data size that thisnode is receiving.
 	int data_size = 0;
 // We go over the cells of neighboring node at the boundary to sum the number of particles.
 	for (int i = 0; i < that_cell.size(); i++)
 		data_size += that_cell[i]->pid.size();
-	data_size *= 3; // each particle has 3 double values (x,y and theta).
-	double* data_buffer = new double[data_size]; // Allocating space
-	MPI_Status status; // status is required in MPI_Recv call
-	MPI_Recv(data_buffer,data_size,MPI_DOUBLE,that_node_id,tag,MPI_COMM_WORLD,&status); // receiving data
+	request.push_back(MPI_REQUEST_NULL);
+	if (compact)
+	{
+		receive_compact.resize(halo_bytes*data_size);
+		MPI_Irecv(receive_compact.data(),receive_compact.size(),MPI_BYTE,that_node_id,(tag+4)%8,comm,&request.back());
+	}
+	else
+	{
+		data_size *= 3; // each particle has 3 double values (x,y and theta).
+		receive_data.resize(data_size);
+		MPI_Irecv(receive_data.data(),data_size,MPI_DOUBLE,that_node_id,(tag+4)%8,comm,&request.back()); // The neighbor sends it through its opposite boundary
+	}
+}
+
+void Boundary::Unpack_Data(bool compact)
+{
 	int shift = 0; // We need to have a track of the last element of data_buffer that we wrote.
 	for (int i = 0; i < that_cell.size(); i++)
 	{
 		for (int j = 0; j < that_cell[i]->pid.size(); j++)
 		{
-			int index = that_cell[i]->pid[j];
-			that_cell[i]->particle[index].r.x = data_buffer[shift+3*j];
-			that_cell[i]->particle[index].r.y = data_buffer[shift+3*j+1];
-			that_cell[i]->particle[index].theta = data_buffer[shift+3*j+2];
-			that_cell[i]->particle[index].v.x = cos(that_cell[i]->particle[index].theta); // Optimization required, computing every particle velocities is not a good idea. A first step is computing the velocity of particles that are within the node, not the one on the neighboring cells of that node.
-			that_cell[i]->particle[index].v.y = sin(that_cell[i]->particle[index].theta); // Optimization required, computing every particle velocities is not a good idea. A first step is computing the velocity of particles that are within the node, not the one on the neighboring cells of that node.
-			that_cell[i]->particle[index].Reset(); // eperimental for debug, it seems that this is needed!
+			Particle& p = Cell::particle[that_cell[i]->pid[j]];
+			if (compact)
+			{
+				float offset[2];
+				unsigned short angle_16;
+				char* buffer = &receive_compact[halo_bytes*(shift+j)];
+				memcpy(offset, buffer, sizeof(offset));
+				memcpy(&angle_16, buffer + sizeof(offset), sizeof(angle_16));
+				p.r.x = that_cell[i]->r.x + offset[0];
+				p.r.y = that_cell[i]->r.y + offset[1];
+				#ifdef PERIODIC_BOUNDARY_CONDITION
+					p.r.Periodic_Transform();
+				#endif
+				p.theta = angle_16 / halo_angle_scale;
+			}
+			else
+			{
+				p.r.x = receive_data[3*(shift+j)];
+				p.r.y = receive_data[3*(shift+j)+1];
+				p.theta = receive_data[3*(shift+j)+2];
+			}
+			p.v.x = cos(p.theta); // Optimization required, computing every particle velocities is not a good idea. A first step is computing the velocity of particles that are within the node, not the one on the neighboring cells of that node.
+			p.v.y = sin(p.theta); // Optimization required, computing every particle velocities is not a good idea. A first step is computing the velocity of particles that are within the node, not the one on the neighboring cells of that node.
+			p.Reset(); // eperimental for debug, it seems that this is needed!
 		}
-		shift += 3*that_cell[i]->pid.size();
+		shift += that_cell[i]->pid.size();
 	}
-	delete [] data_buffer;
 }
 
-void Boundary::Send_Particle_Ids()
+void Boundary::Write_Shared(Real* data)
 {
-// First we need to find the data size.
-	int index_size = 0;
-// Go over all bondary cells:
-	for (int i = 0; i < this_cell.size(); i++)
-		index_size += this_cell[i]->pid.size(); // Summing particles of each neighboring cell
-	int* index_buffer = new int[index_size]; // Allocating buffer array
-	int* cell_size = new int[this_cell.size()]; // Allocating a buffer of each cell particle count.
-
-	int shift = 0; // We need to have a track of the last element of data_buffer that we wrote.
-// Go over particle ids of each boundary cell
-	for (int i = 0; i < this_cell.size(); i++)
+	for (int i = 0; i < send_index.size(); i++)
 	{
-		for (int j = 0; j < this_cell[i]->pid.size(); j++)
-			index_buffer[shift+j] = this_cell[i]->pid[j];
-		cell_size[i] = this_cell[i]->pid.size(); // Saving particle number of i'th cell of thisnode at boundary.
-		shift += this_cell[i]->pid.size(); // the last element id must be added with amount of data that we added in the for loop.
+		int index = send_index[i];
+		data[3*index] = Cell::particle[index].r.x;
+		data[3*index+1] = Cell::particle[index].r.y;
+		data[3*index+2] = Cell::particle[index].theta;
 	}
-	MPI_Send(cell_size,this_cell.size(),MPI_INT,that_node_id,tag,MPI_COMM_WORLD);
-	MPI_Send(index_buffer,index_size,MPI_INT,that_node_id,tag,MPI_COMM_WORLD);
-	delete [] index_buffer;
-	delete [] cell_size;
 }
 
-void Boundary::Receive_Particle_Ids()
+void Boundary::Read_Shared(Real* data)
 {
-	int* cell_size = new int[that_cell.size()]; // Allocating a buffer of each cell particle count.
+	for (int i = 0; i < that_cell.size(); i++)
+		for (int j = 0; j < that_cell[i]->pid.size(); j++)
+		{
+			int index = that_cell[i]->pid[j];
+			Particle& p = Cell::particle[index];
+			p.r.x = data[3*index];
+			p.r.y = data[3*index+1];
+			p.theta = data[3*index+2];
+			p.v.x = cos(p.theta);
+			p.v.y = sin(p.theta);
+			p.Reset();
+		}
+}
 
-	MPI_Status status; // status is required in MPI_Recv call
-	MPI_Recv(cell_size, that_cell.size(),MPI_INT,that_node_id,tag,MPI_COMM_WORLD,&status); // Receiving particle number within each boundary cell
+void Boundary::Send_Tangent(vector<MPI_Request>& request)
+{
+	int size = 3*Tangent::num;
+	send_tangent.resize(size*send_index.size());
+	for (int i = 0; i < send_index.size(); i++)
+	{
+		const Real* t = Tangent::Of(send_index[i]);
+		for (int c = 0; c < size; c++)
+			send_tangent[size*i + c] = t[c];
+	}
+	request.push_back(MPI_REQUEST_NULL);
+	MPI_Isend(send_tangent.data(),send_tangent.size(),MPI_DOUBLE,that_node_id,tag+8,comm,&request.back());
+}
 
+void Boundary::Receive_Tangent(vector<MPI_Request>& request)
+{
 	int data_size = 0;
 	for (int i = 0; i < that_cell.size(); i++)
-		data_size += cell_size[i];
-	int* index_buffer = new int[data_size]; // Allocating space
-	MPI_Recv(index_buffer,data_size,MPI_DOUBLE,that_node_id,tag,MPI_COMM_WORLD,&status); // Receiving Indices
+		data_size += that_cell[i]->pid.size();
+	receive_tangent.resize(3*Tangent::num*data_size);
+	request.push_back(MPI_REQUEST_NULL);
+	MPI_Irecv(receive_tangent.data(),receive_tangent.size(),MPI_DOUBLE,that_node_id,(tag+4)%8+8,comm,&request.back());
+}
+
+void Boundary::Unpack_Tangent()
+{
+	int size = 3*Tangent::num;
+	int n = 0;
+	for (int i = 0; i < that_cell.size(); i++)
+		for (int j = 0; j < that_cell[i]->pid.size(); j++, n++)
+		{
+			int index = that_cell[i]->pid[j];
+			Real* t = Tangent::Of(index);
+			for (int c = 0; c < size; c++)
+				t[c] = receive_tangent[size*n + c];
+			Tangent::Reset(index);
+		}
+}
 
-	int shift = 0; // We need to have a track of the last element of data_buffer that we wrote.
+void Boundary::Receive_Records()
+{
+	MPI_Status status;
+	int data_size;
+	MPI_Probe(that_node_id,(tag+4)%8,comm,&status);
+	MPI_Get_count(&status,MPI_DOUBLE,&data_size);
+	receive_data.resize(data_size);
+	MPI_Recv(receive_data.data(),data_size,MPI_DOUBLE,that_node_id,(tag+4)%8,comm,MPI_STATUS_IGNORE);
+}
+
+void Boundary::Unpack_Record(int n, int& index)
+{
+	int record = Record_Size();
+	index = (int) receive_data[record*n];
+	Particle& p = Cell::particle[index];
+	p.r.x = receive_data[record*n+1];
+	p.r.y = receive_data[record*n+2];
+	p.theta = receive_data[record*n+3];
+	p.v.x = cos(p.theta);
+	p.v.y = sin(p.theta);
+	p.Reset();
+	if (Tangent::num)
+	{
+		Real* t = Tangent::Of(index);
+		for (int c = 0; c < record - 4; c++)
+			t[c] = receive_data[record*n+4+c];
+		Tangent::Reset(index);
+	}
+}
+
+void Boundary::Send_Migrants(vector<MPI_Request>& request)
+{
+	send_data.clear();
+	for (int i = 0; i < that_cell.size(); i++)
+		for (int j = 0; j < that_cell[i]->pid.size(); j++)
+		{
+			Particle& p = Cell::particle[that_cell[i]->pid[j]];
+			send_data.push_back(that_cell[i]->pid[j]);
+			send_data.push_back(p.r.x);
+			send_data.push_back(p.r.y);
+			send_data.push_back(p.theta);
+			if (Tangent::num)
+				send_data.insert(send_data.end(), Tangent::Of(that_cell[i]->pid[j]), Tangent::Of(that_cell[i]->pid[j]) + 3*Tangent::num);
+		}
+	request.push_back(MPI_REQUEST_NULL);
+	MPI_Isend(send_data.data(),send_data.size(),MPI_DOUBLE,that_node_id,tag,comm,&request.back());
+}
+
+void Boundary::Receive_Migrants(vector<int>& immigrant)
+{
+	Receive_Records();
+	for (int n = 0; n < receive_data.size() / Record_Size(); n++)
+	{
+		int index;
+		Unpack_Record(n, index);
+		immigrant.push_back(index);
+	}
+}
+
+void Boundary::Send_Ghosts(vector<MPI_Request>& request)
+{
+	send_size.resize(this_cell.size());
+	send_index.clear();
+// Go over particle ids of each boundary cell. The ids are saved for the data of the next steps (Send_Data).
+	for (int i = 0; i < this_cell.size(); i++)
+	{
+		send_size[i] = 0;
+		for (int j = 0; j < this_cell[i]->pid.size(); j++)
+			if (Near_Edge(this_cell[i]->pid[j]))
+			{
+				send_index.push_back(this_cell[i]->pid[j]);
+				send_size[i]++; // Saving particle number of i'th cell of thisnode at boundary.
+			}
+	}
+
+	int shift = send_size.size();
+	int record = Record_Size();
+	send_data.resize(shift + record*send_index.size());
+	for (int i = 0; i < send_size.size(); i++)
+		send_data[i] = send_size[i];
+	for (int i = 0; i < send_index.size(); i++)
+	{
+		int index = send_index[i];
+		send_data[shift+record*i] = index;
+		send_data[shift+record*i+1] = Cell::particle[index].r.x;
+		send_data[shift+record*i+2] = Cell::particle[index].r.y;
+		send_data[shift+record*i+3] = Cell::particle[index].theta;
+		for (int c = 0; c < record - 4; c++)
+			send_data[shift+record*i+4+c] = Tangent::Of(index)[c];
+	}
+	request.push_back(MPI_REQUEST_NULL);
+	MPI_Isend(send_data.data(),send_data.size(),MPI_DOUBLE,that_node_id,tag,comm,&request.back());
+}
+
+void Boundary::Receive_Ghosts()
+{
+	Receive_Records();
+	vector<int> size(that_cell.size());
+	for (int i = 0; i < that_cell.size(); i++)
+		size[i] = (int) receive_data[i];
+	receive_data.erase(receive_data.begin(), receive_data.begin() + that_cell.size()); // The rest are the particle records.
+	int n = 0;
 	for (int i = 0; i < that_cell.size(); i++)
 	{
 		that_cell[i]->Delete(); // Delete old informatinos
-		for (int j = 0; j < cell_size[i]; j++)
+		for (int j = 0; j < size[i]; j++, n++)
 		{
-			int index = index_buffer[shift+j];
+			int index;
+			Unpack_Record(n, index);
 			that_cell[i]->pid.push_back(index);
 		}
-		shift += that_cell[i]->pid.size();
 	}
-
-	delete [] cell_size;
-	delete [] index_buffer;
 }
 
 void Boundary::Print_Info()
@@ -8,7 +8,10 @@
 #include "../shared/wall.h"
 #include "../shared/set-up.h"
 #include "../shared/state-hyper-vector.h"
+#include "../shared/snapshot.h"
 #include "node.h"
+#include "trajectory.h"
+#include "checkpoint.h"
 
 #include <boost/algorithm/string.hpp>
 
@@ -19,6 +22,7 @@ public:
 	Wall wall[8]; // Array of walls in our system.
 
 	Real density;
+	long int step; // Number of steps from the beginning (or from the loaded checkpoint)
 	stringstream info; // information stream that contains the simulation information, like noise, density and etc. this will be used for the saving name of the system.
 
 	Node* thisnode; // Node is a class that has information about the node_id and its boundaries, neighbores and etc.
@@ -27,10 +31,15 @@ public:
 	// I believe that it is better to move these init functions to main files
 	void Init_Topology(); // Initialize the wall positions and numbers.
 	void Init(Node* input_node, Real input_density); // Intialize the box, positioning particles, giving them velocities, updating cells and sending information to all nodes.
-	bool Init(Node* input_node, const string name); // Intialize the box from a file, this includes reading particles information, updating cells and sending information to all nodes.
+	bool Init(Node* input_node, const string name); // Intialize the box from a checkpoint file, this includes reading particles information, updating cells and sending information to all nodes.
+	bool Load(const string name); // Load a checkpoint to an initialized box. It returns false if there is no valid checkpoint with that name.
 
-	void Load(const State_Hyper_Vector&); // Load new position and angles of particles and a gsl random generator from a state hyper vector
-	void Save(State_Hyper_Vector&) const; // Save current position and angles of particles and a gsl random generator to a state hyper vector
+	void Load(const State_Hyper_Vector&); // Load new position and angles of particles from a state hyper vector
+	void Save(State_Hyper_Vector&) const; // Save current position and angles of particles to a state hyper vector
+	void Load(const Box_State&); // Load a state and its gsl random generator
+	void Save(Box_State&) const; // Save the state and the gsl random generator
+	void Load(const Box_Snapshot&); // Restore the cells, neighbor lists and random generator of thisnode from a snapshot of this box. There is no communication, all nodes must load their snapshots of the same time.
+	void Save(Box_Snapshot&) const; // Save the engine state of thisnode to a snapshot
 
 	void Interact(); // Here the intractio of particles are computed that is the applied tourque to each particle.
 	void Move(); // Move all particles of this node.
@@ -39,7 +48,8 @@ public:
 	void Multi_Step(int steps, int interval); // Several steps with a cell upgrade call after each interval.
 	void Translate(C2DVector d); // Translate position of all particles with vector d
 
-	friend std::ostream& operator<<(std::ostream& os, Box* box); // Save
+	friend Trajectory& operator<<(Trajectory& traj, Box* box); // Save
+	friend Checkpoint& operator<<(Checkpoint& checkpoint, Box* box); // Save the full state, the writing is finished during the next steps.
 	friend std::istream& operator>>(std::istream& is, Box* box); // Input
 };
 
@@ -47,6 +57,7 @@ Box::Box()
 {
 	N = 0;
 	density = 0;
+	step = 0;
 	wall_num = 0;
 }
 
@@ -79,22 +90,25 @@ void Box::Init(Node* input_node, Real input_density)
 	Init_Topology(); // Adding walls
 
 	if (thisnode->node_id == 0)
-	{
 		cout << "number_of_particles = " << N << endl; // Printing number of particles.
+
+// Each node makes the particles by itself and keeps the ones in its own cells. The particles only depend on their id and the seed of the formation, that is the seed of the master node.
+	long int formation_seed = thisnode->seed;
+	MPI_Bcast(&formation_seed, 1, MPI_LONG, 0, thisnode->world);
+	vector<int> node_pid; // Particles of thisnode
+	for (int i = 0; i < N; i++)
+	{
 // Positioning the particles
-//		Polar_Formation(particle,N);
-//		Triangle_Lattice_Formation(particle, N, 1);
-		Random_Formation(particle, N, 0); // Positioning partilces Randomly, but distant from walls (the last argument is the distance from walls)
-//		Random_Formation_Circle(particle, N, Lx-1); // Positioning partilces Randomly, but distant from walls
-//		Single_Vortex_Formation(particle, N);
-	//	Four_Vortex_Formation(particle, N);
+//		Triangle_Lattice_Formation(particle[i], i, N, 1, formation_seed);
+		Random_Formation(particle[i], i, 0, formation_seed); // Positioning partilces Randomly, but distant from walls (the argument after the id is the distance from walls)
+//		Single_Vortex_Formation(particle[i], i, N);
+//		Four_Vortex_Formation(particle[i], i, N);
+//		Clump_Formation(particle[i], i, N/4, formation_seed);
+		if (thisnode->Is_Own_Cell(thisnode->Cell_X(particle[i].r.x), thisnode->Cell_Y(particle[i].r.y)))
+			node_pid.push_back(i);
 	}
-	MPI_Barrier(MPI_COMM_WORLD);
-
-// Master node will broadcast the particles information
-	thisnode->Root_Bcast();
-// Any node update cells, knowing particles and their cell that they are inside.
-	thisnode->Full_Update_Cells();
+// Any node update its cells, the particles of the neighboring cells come from the neighboring nodes.
+	thisnode->Init_Cells(node_pid);
 
 	#ifdef verlet_list
 	thisnode->Update_Neighbor_List();
@@ -102,94 +116,102 @@ void Box::Init(Node* input_node, Real input_density)
 
 // Buliding up info stream. In next versions we will take this part out of box, making our libraries more abstract for any simulation of SPP.
 	info.str("");
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(thisnode->world);
+}
+
+
+// Intialize the box from a checkpoint file. The number of particles and density are read from the file.
+bool Box::Init(Node* input_node, const string name)
+{
+	#ifdef TRACK_PARTICLE
+	track_p = &particle[track];
+	#endif
+
+	thisnode = input_node;
+
+	Checkpoint_Header header;
+	MPI_File file;
+	if (MPI_File_open(thisnode->world, (char*) name.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+		return false;
+	MPI_File_read_at_all(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+	MPI_File_close(&file);
+	if (strncmp(header.magic, "PSCHECK", 8) != 0 || header.N < 0 || header.N > max_N)
+		return false;
+
+	N = header.N;
+	density = header.density;
+	Init_Topology(); // Adding walls
+	return Load(name);
 }
 
+// Loading a checkpoint. Every node reads all records and keeps the particles of its own cells, therefore the number of nodes may be different from the nodes that wrote the checkpoint. The random generators are only loaded for the same number of nodes, otherwise each node keeps its own seed and the continuation is not the same.
+bool Box::Load(const string name)
+{
+	MPI_File file;
+	if (MPI_File_open(thisnode->world, (char*) name.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+		return false;
 
-//// Intialize the box from a file, this includes reading particles information, updating cells and sending information to all nodes. 
-//bool Box::Init(Node* input_node, const string input_name)
-//{
-//	#ifdef TRACK_PARTICLE
-//	track_p = &particle[track];
-//	#endif
-
-//	Real input_kapa;
-//	Real input_mu_plus;
-//	Real input_mu_minus;
-//	Real input_Dphi;
-//	Real input_L;
-
-//	string name = input_name;
-//	stringstream address(name);
-//	ifstream is;
-//	is.open(address.str().c_str());
-//	if (!is.is_open())
-//		return false;
-
-//	boost::replace_all(name, "-r-v.bin", "");
-//	boost::replace_all(name, "rho=", "");
-//	boost::replace_all(name, "-k=", "");
-//	boost::replace_all(name, "-mu+=", "\t");
-//	boost::replace_all(name, "-mu-=", "\t");
-//	boost::replace_all(name, "-Dphi=", "\t");
-//	boost::replace_all(name, "-L=", "\t");
-
-//	stringstream ss_name(name);
-//	ss_name >> density;
-//	ss_name >> input_kapa;
-//	ss_name >> input_mu_plus;
-//	ss_name >> input_mu_minus;
-//	ss_name >> input_Dphi;
-//	ss_name >> input_L;
-//	if (input_L != Lx_int)
-//	{
-//		cout << "The specified box size " << input_L << " is not the same as the size in binary file which is " << Lx_int << " please recompile the code with the right Lx_int in parameters.h file." << endl;
-//		return false;
-//	}
-
-//	Particle::kapa = input_kapa;
-//	Particle::mu_plus = input_mu_plus;
-//	Particle::mu_minus = input_mu_minus;
-//	Particle::D_phi = input_Dphi;
-
-//	thisnode = input_node;
-
-//	is.read((char*) &N, sizeof(int) / sizeof(char));
-//	if (N < 0 || N > 1000000)
-//		return (false);
-
-//	for (int i = 0; i < N; i++)
-//	{
-//		is >> particle[i].r;
-//		is >> particle[i].v;
-//	}
-
-//	is.close();
-
-//	MPI_Barrier(MPI_COMM_WORLD);
-
-//	Init_Topology(); // Adding walls
-
-//	if (thisnode->node_id == 0)
-//	{
-//		cout << "number_of_particles = " << N << endl; // Printing number of particles.
-//	}
-//	MPI_Barrier(MPI_COMM_WORLD);
-
-//// Master node will broadcast the particles information
-//	thisnode->Root_Bcast();
-//// Any node update cells, knowing particles and their cell that they are inside.
-//	thisnode->Full_Update_Cells();
-
-//	#ifdef verlet_list
-//	thisnode->Update_Neighbor_List();
-//	#endif
-
-//// Buliding up info stream. In next versions we will take this part out of box, making our libraries more abstract for any simulation of SPP.
-//	info.str("");
-//	return (true);
-//}
+	Checkpoint_Header header;
+	MPI_File_read_at_all(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+	if (strncmp(header.magic, "PSCHECK", 8) != 0 || header.version != checkpoint_version || header.N != N || header.records > N)
+	{
+		MPI_File_close(&file);
+		return false;
+	}
+	if (header.Lx != Lx || header.Ly != Ly || header.dt != dt)
+	{
+		if (thisnode->node_id == 0)
+			cout << "Error: The checkpoint " << name << " is for a box with Lx = " << header.Lx << ", Ly = " << header.Ly << " and dt = " << header.dt << " please recompile the code with the same values in parameters.h file." << endl;
+		exit(0);
+	}
 
+	vector<double> record(4*header.records);
+	MPI_File_read_at_all(file, sizeof(header), record.data(), record.size(), MPI_DOUBLE, MPI_STATUS_IGNORE);
+
+	bool same_nodes = (header.nodes == thisnode->total_nodes && header.rng_size == (int) gsl_rng_size(C2DVector::gsl_r));
+	if (same_nodes)
+	{
+		MPI_Offset rng_offset = sizeof(header) + 4*sizeof(double)*N + (MPI_Offset) header.rng_size*thisnode->node_id;
+		MPI_File_read_at_all(file, rng_offset, gsl_rng_state(C2DVector::gsl_r), header.rng_size, MPI_BYTE, MPI_STATUS_IGNORE);
+	}
+	MPI_File_close(&file);
+// The noises of a node come from its own generator, another number of nodes can not continue them. All nodes read the same header, so they stop together.
+	if (!same_nodes)
+	{
+		if (thisnode->node_id == 0)
+			cout << "Error: The checkpoint " << name << " is written by " << header.nodes << " nodes, it can only be continued by the same number of processes." << endl;
+		exit(0);
+	}
+
+	step = header.step;
+	density = header.density;
+	Particle::noise_amplitude = header.noise_amplitude;
+	Particle::rv = header.rv;
+	Particle::speed = header.speed;
+	info.str(header.info);
+
+// The particles are added to the cells in the order of their ids. This is the same order as the cells of the box that saved the checkpoint (see Node::Sort_Cells).
+	vector<int> node_pid(N, -1);
+	for (int i = 0; i < header.records; i++)
+	{
+		int index = (int) record[4*i];
+		particle[index].r.x = record[4*i+1];
+		particle[index].r.y = record[4*i+2];
+		particle[index].theta = record[4*i+3];
+		particle[index].v.x = cos(particle[index].theta);
+		particle[index].v.y = sin(particle[index].theta);
+		particle[index].Reset();
+		if (thisnode->Is_Own_Cell(thisnode->Cell_X(particle[index].r.x), thisnode->Cell_Y(particle[index].r.y)))
+			node_pid[index] = index;
+	}
+	node_pid.erase(remove(node_pid.begin(), node_pid.end(), -1), node_pid.end());
+	thisnode->Init_Cells(node_pid);
+	#ifdef verlet_list
+		thisnode->Update_Neighbor_List();
+	#endif
+	MPI_Barrier(thisnode->world);
+	return true;
+}
 
 // Loading a state to the box.
 void Box::Load(const State_Hyper_Vector& sv)
@@ -206,8 +228,7 @@ void Box::Load(const State_Hyper_Vector& sv)
 		particle[i].v.x = cos(particle[i].theta);
 		particle[i].v.y = sin(particle[i].theta);
 	}
-	sv.Set_C2DVector_Rand_Generator();
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(thisnode->world);
 	thisnode->Root_Bcast();
 	thisnode->Full_Update_Cells();
 	#ifdef verlet_list
@@ -230,20 +251,67 @@ void Box::Save(State_Hyper_Vector& sv) const
 		sv.particle[i].r = particle[i].r;
 		sv.particle[i].theta = particle[i].theta;
 	}
-	sv.Get_C2DVector_Rand_Generator();
 // We need to make sure that indexing of particles are the same to exactly recompute the same values. Therefor at a saving we update cells and neighore list therefore if we load the same sv and update cells and neighore list we will come to the same indexing
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(thisnode->world);
 	thisnode->Full_Update_Cells();
 	#ifdef verlet_list
 		thisnode->Update_Neighbor_List();
 	#endif
 }
 
+void Box::Load(const Box_State& bs)
+{
+	bs.rand.Set_C2DVector_Rand_Generator();
+	Load((const State_Hyper_Vector&) bs);
+}
+
+void Box::Save(Box_State& bs) const
+{
+	Save((State_Hyper_Vector&) bs);
+	bs.rand.Get_C2DVector_Rand_Generator();
+}
+
+void Box::Load(const Box_Snapshot& snapshot)
+{
+	snapshot.Load_Cells(&thisnode->cell[0][0], divisor_x*divisor_y, particle);
+	if (snapshot.send_index.size() != thisnode->boundary.size())
+	{
+		cout << "Error: The snapshot is not saved from a box with the same nodes" << endl;
+		exit(0);
+	}
+	for (int i = 0; i < thisnode->boundary.size(); i++)
+	{
+		thisnode->boundary[i].send_size = snapshot.send_size[i];
+		thisnode->boundary[i].send_index = snapshot.send_index[i];
+	}
+	step = snapshot.step;
+	thisnode->noise_step = snapshot.noise_step;
+	snapshot.rand.Set_C2DVector_Rand_Generator();
+}
+
+// The ghosts are saved with the send lists of the boundaries, then the next Send_Receive_Data after a load is the same.
+void Box::Save(Box_Snapshot& snapshot) const
+{
+	snapshot.Save_Cells(&thisnode->cell[0][0], divisor_x*divisor_y, particle);
+	snapshot.send_size.resize(thisnode->boundary.size());
+	snapshot.send_index.resize(thisnode->boundary.size());
+	for (int i = 0; i < thisnode->boundary.size(); i++)
+	{
+		snapshot.send_size[i] = thisnode->boundary[i].send_size;
+		snapshot.send_index[i] = thisnode->boundary[i].send_index;
+	}
+	snapshot.step = step;
+	snapshot.noise_step = thisnode->noise_step;
+	snapshot.rand.Get_C2DVector_Rand_Generator();
+}
+
 // Here the intractio of particles are computed that is the applied tourque to each particle.
 void Box::Interact()
 {
 	thisnode->Send_Receive_Data();
-	MPI_Barrier(MPI_COMM_WORLD);
+	if (Tangent::num)
+		thisnode->Send_Receive_Tangent();
+	MPI_Barrier(thisnode->world);
 
 	#ifdef verlet_list
 // with verlet list:
@@ -288,7 +356,8 @@ void Box::One_Step()
 {
 	Interact();
 	Move();
-	MPI_Barrier(MPI_COMM_WORLD);
+	step++;
+	MPI_Barrier(thisnode->world);
 }
 
 // Several steps befor a cell upgrade.
@@ -298,7 +367,8 @@ void Box::Multi_Step(int steps)
 	{
 		Interact();
 		Move();
-		MPI_Barrier(MPI_COMM_WORLD); // Barier guranty that the move step of all particles is done. Therefor in interact function we are using updated particles.
+		step++;
+		MPI_Barrier(thisnode->world); // Barier guranty that the move step of all particles is done. Therefor in interact function we are using updated particles.
 	}
 	thisnode->Quick_Update_Cells();
 	#ifdef verlet_list
@@ -330,27 +400,77 @@ void Box::Translate(C2DVector d)
 	#endif
 }
 
-// Saving the particle information (position and velocities) to a standard output stream (probably a file). This must be called by only the root.
-std::ostream& operator<<(std::ostream& os, Box* box)
+// Saving the full state of the box to a checkpoint. The cells are sorted first, so the box continues the same way as a box that loads this checkpoint.
+Checkpoint& operator<<(Checkpoint& checkpoint, Box* box)
 {
-	box->thisnode->Root_Gather();
-	box->thisnode->Root_Bcast();
+	checkpoint.Finish(); // The buffers of the last checkpoint must not change before its writing is finished.
+	Node* thisnode = box->thisnode;
+	thisnode->Sort_Cells();
+	#ifdef verlet_list
+		thisnode->Update_Neighbor_List();
+	#endif
 
-	if (box->thisnode->node_id == 0)
-	{
-		os.write((char*) &box->N, sizeof(box->N) / sizeof(char));
-		for (int i = 0; i < box->N; i++)
-		{
-			box->particle[i].r.write(os);
-			C2DVector v;
-			v.x = cos(box->particle[i].theta);
-			v.y = sin(box->particle[i].theta);
-			v.write(os);
+	Checkpoint_Header& header = checkpoint.header;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, "PSCHECK");
+	header.version = checkpoint_version;
+	header.N = box->N;
+	header.nodes = thisnode->total_nodes;
+	header.rng_size = gsl_rng_size(C2DVector::gsl_r);
+	header.step = box->step;
+	header.Lx = Lx;
+	header.Ly = Ly;
+	header.dt = dt;
+	header.density = box->density;
+	header.noise_amplitude = Particle::noise_amplitude;
+	header.rv = Particle::rv;
+	header.speed = Particle::speed;
+	strncpy(header.info, box->info.str().c_str(), sizeof(header.info) - 1);
+
+	checkpoint.record.clear();
+	for (int x = thisnode->head_cell_idx; x < thisnode->tail_cell_idx; x++)
+		for (int y = thisnode->head_cell_idy; y < thisnode->tail_cell_idy; y++)
+			for (int i = 0; i < thisnode->cell[x][y].pid.size(); i++)
+			{
+				Particle& p = box->particle[thisnode->cell[x][y].pid[i]];
+				checkpoint.record.push_back(thisnode->cell[x][y].pid[i]);
+				checkpoint.record.push_back(p.r.x);
+				checkpoint.record.push_back(p.r.y);
+				checkpoint.record.push_back(p.theta);
+			}
+
+	char* state = (char*) gsl_rng_state(C2DVector::gsl_r);
+	checkpoint.rng_state.assign(state, state + header.rng_size);
+
+	checkpoint.Start_Writing();
+	return checkpoint;
+}
 
-//			cout << i << "\t" << setprecision(100) << box->particle[i].theta << endl;
-		}
+// Saving the particle information (position and velocities) to the trajectory file. This must be called by all nodes, each node packs its own particles and the writing is finished during the next steps.
+Trajectory& operator<<(Trajectory& traj, Box* box)
+{
+	if (!traj.is_open)
+		return traj; // Like an ofstream that is not open, nothing is saved.
+	if (traj.frame_offset.empty())
+	{
+		Trajectory_Header& header = traj.header;
+		Init_Trajectory_Header(header);
+		header.N = box->N;
+		header.seed = box->thisnode->seed;
+		header.density = box->density;
+		header.noise = Particle::noise_amplitude*sqrt(dt);
+		header.rv = Particle::rv;
+		header.speed = Particle::speed;
+		strncpy(header.info, box->info.str().c_str(), sizeof(header.info) - 1);
+		if (box->thisnode->node_id == 0)
+			MPI_File_write_at(traj.file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+		traj.offset = sizeof(header);
+		traj.Start(box->N);
 	}
-	MPI_Barrier(MPI_COMM_WORLD);
+	Trajectory_Slot& slot = traj.Get_Slot();
+	box->thisnode->Pack_Particles(slot.data, slot.displacement);
+	traj.Write(slot, box->N);
+	return traj;
 }
 
 // Reading the particle information (position and velocities) from a standard input stream (probably a file).
@@ -365,7 +485,7 @@ std::istream& operator>>(std::istream& is, Box* box)
 			is >> box->particle[i].v;
 		}
 	}
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(box->thisnode->world);
 }
 
 #endif
@@ -0,0 +1,110 @@
+#ifndef _CHECKPOINT_
+#define _CHECKPOINT_
+
+#include "mpi.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+// Checkpoint is the binary file of the full state of the parallel program to continue a simulation after it is stopped. It has a header (Checkpoint_Header), then a record (id, x, y, theta) for each particle in double and then the state of the random generator of each node. Each node writes the records of its own particles and its random generator, the order of records depends on the nodes but each record has its particle id.
+// Writing is non-blocking (MPI-IO), the simulation goes on while the file is written. The file is written to name.tmp and it is renamed to name when the writing is finished, so a stop during the writing does not destroy the last checkpoint.
+struct Checkpoint_Header{
+	char magic[8]; // "PSCHECK"
+	int version;
+	int N;
+	int records; // Number of particle records, it is less than N if some particles are lost.
+	int nodes; // Number of nodes that wrote the checkpoint. The random generators are only loaded if it is the same.
+	int rng_size; // Size of the state of the random generator of each node in bytes
+	long int step; // Number of steps of the box
+	double Lx, Ly, dt; // They are compile time constants, a checkpoint of another compilation is not accepted.
+	double density, noise_amplitude, rv, speed;
+	char info[256]; // Box::info, the other parameters of the model are in it.
+};
+
+const int checkpoint_version = 1;
+
+struct Checkpoint{
+	std::string name;
+	MPI_Comm comm; // Nodes of the box
+	MPI_File file;
+	bool is_open; // The file is open and it might be still written.
+	Checkpoint_Header header;
+	std::vector<double> record; // Buffers of the non-blocking writes, they must be alive until the writes are finished.
+	std::vector<char> rng_state;
+	std::vector<MPI_Request> request;
+
+	Checkpoint();
+	~Checkpoint();
+
+	void Open(const std::string input_name, MPI_Comm input_comm = MPI_COMM_WORLD); // All nodes of input_comm (the nodes of the box) must call it. Nothing is written until a box is saved (operator<< in box.h).
+	void Start_Writing(); // Start the non-blocking writes of the buffers. All nodes must call it.
+	void Finish(); // Wait for the writes and rename the file. All nodes must call it.
+	void Close(); // All nodes must call it.
+};
+
+Checkpoint::Checkpoint()
+{
+	comm = MPI_COMM_WORLD;
+	is_open = false;
+}
+
+Checkpoint::~Checkpoint()
+{
+	Close();
+}
+
+void Checkpoint::Open(const std::string input_name, MPI_Comm input_comm)
+{
+	Close();
+	name = input_name;
+	comm = input_comm;
+}
+
+void Checkpoint::Start_Writing()
+{
+	Finish();
+	int node_id;
+	MPI_Comm_rank(comm, &node_id);
+	std::string temp_name = name + ".tmp";
+	MPI_File_open(comm, (char*) temp_name.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+	MPI_File_set_size(file, 0);
+	is_open = true;
+
+// The place of the records of thisnode is the number of records of the previous nodes.
+	int count = record.size() / 4;
+	int previous = 0;
+	MPI_Exscan(&count, &previous, 1, MPI_INT, MPI_SUM, comm);
+	if (node_id == 0)
+		previous = 0; // The result of MPI_Exscan is undefined for the first node.
+	MPI_Allreduce(&count, &header.records, 1, MPI_INT, MPI_SUM, comm);
+
+	MPI_Offset record_offset = sizeof(Checkpoint_Header) + 4*sizeof(double)*previous;
+	MPI_Offset rng_offset = sizeof(Checkpoint_Header) + 4*sizeof(double)*header.N + (MPI_Offset) header.rng_size*node_id;
+	request.resize(3, MPI_REQUEST_NULL);
+	if (node_id == 0)
+		MPI_File_iwrite_at(file, 0, &header, sizeof(header), MPI_BYTE, &request[0]);
+	MPI_File_iwrite_at(file, record_offset, record.data(), record.size(), MPI_DOUBLE, &request[1]);
+	MPI_File_iwrite_at(file, rng_offset, rng_state.data(), rng_state.size(), MPI_BYTE, &request[2]);
+}
+
+void Checkpoint::Finish()
+{
+	if (!is_open)
+		return;
+	MPI_Waitall(request.size(), request.data(), MPI_STATUSES_IGNORE);
+	MPI_File_close(&file); // It is collective, after it all nodes have written their data.
+	is_open = false;
+	int node_id;
+	MPI_Comm_rank(comm, &node_id);
+	if (node_id == 0)
+		rename((name + ".tmp").c_str(), name.c_str());
+	MPI_Barrier(comm);
+}
+
+void Checkpoint::Close()
+{
+	Finish();
+}
+
+#endif
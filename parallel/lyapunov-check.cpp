@@ -0,0 +1,106 @@
+#include "../shared/parameters.h"
+#include "../shared/c2dvector.h"
+#include "../shared/particle.h"
+#include "../shared/cell.h"
+#include "../shared/vector-set.h"
+#include "lyapunovbox.h"
+
+// The largest exponent of the last Lyapunov_Exponent of the box and its error. A direction with zero ratios (Lyapunov_Estimate::is_null) has no exponent.
+void Largest_Exponent(const LyapunovBox& box, Real& exponent, Real& error)
+{
+	exponent = error = 0;
+	bool found = false;
+	for (int i = 0; i < box.estimate.sum.size(); i++)
+		if (!box.estimate.is_null[i] && (!found || box.estimate.Exponent(i) > exponent))
+		{
+			exponent = box.estimate.Exponent(i);
+			error = box.estimate.Error(i);
+			found = true;
+		}
+}
+
+// The exponents of two ways agree if they differ by less than three errors of the difference.
+bool Agree(string name_a, Real a, Real error_a, string name_b, Real b, Real error_b)
+{
+	Real limit = 3*sqrt(error_a*error_a + error_b*error_b);
+	bool agree = (fabs(a - b) <= limit);
+	cout << name_a << " - " << name_b << " = " << a - b << " (limit " << limit << ")" << (agree ? "" : " do not agree") << endl;
+	return (agree);
+}
+
+// To run:
+// mpirun -np 3 lyapunov-check.out [rho g noise duration equilibrium_steps]
+// The largest Lyapunov exponent of the same box is found by the three ways of LyapunovBox: concurrent replicas (three groups of one process, two directions), the finite deviations one after the other and the linearized dynamics (both on group 0). They must agree within their batch errors. It returns 1 if they do not agree.
+// The three ways take the box one after the other, so it must be in its steady state before the first one. With the ordering of small noises the exponent changes for a long time and the ways do not agree.
+int main(int argc, char *argv[])
+{
+	int this_node_id, total_nodes;
+	int thread_support;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support);
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &this_node_id);
+	MPI_Comm_size(MPI_COMM_WORLD, &total_nodes);
+	if (total_nodes != 3)
+	{
+		if (this_node_id == 0)
+			cout << "Error: lyapunov-check must run on 3 processes" << endl;
+		MPI_Finalize();
+		exit(0);
+	}
+	Real input_rho = (argc > 1) ? atof(argv[1]) : 0.5;
+	Real input_g = (argc > 2) ? atof(argv[2]) : 1;
+	Real input_noise = (argc > 3) ? atof(argv[3]) : 1;
+	Real duration = (argc > 4) ? atof(argv[4]) : 200;
+	long int eq_steps = (argc > 5) ? atol(argv[5]) : 20000;
+
+	int group = this_node_id;
+	MPI_Comm box_comm;
+	MPI_Comm_split(MPI_COMM_WORLD, group, this_node_id, &box_comm);
+
+	Node thisnode(box_comm);
+	thisnode.compact_halo = false;
+	thisnode.seed = seed;
+	C2DVector::Init_Rand(thisnode.seed);
+
+	Particle::g = input_g;
+	Particle::noise_amplitude = input_noise / sqrt(dt);
+
+	static LyapunovBox box; // Box is about the size of the default stack (8 MB), so it must not be a local variable.
+	box.Init(&thisnode, input_rho);
+	box.Init_Replicas(MPI_COMM_WORLD, group, 3);
+	box.Multi_Step(eq_steps, cell_update_period);
+
+	Real exponent[3], error[3];
+	box.Lyapunov_Exponent(1, 10, 0.1, duration, 2);
+	Largest_Exponent(box, exponent[0], error[0]);
+
+// Group 0 goes on alone from the state of the end of the replicas.
+	bool agree = true;
+	if (group == 0)
+	{
+		box.groups = 1;
+		box.linearized = false;
+		box.Lyapunov_Exponent(1, 10, 0.1, duration, 2);
+		Largest_Exponent(box, exponent[1], error[1]);
+
+		box.linearized = true;
+		box.Lyapunov_Exponent(1, 10, 0.1, duration, 1);
+		Largest_Exponent(box, exponent[2], error[2]);
+		Tangent::Delete();
+
+		if (box.Is_Root())
+		{
+			string name[3] = {"replicas", "finite deviations", "linearized"};
+			for (int i = 0; i < 3; i++)
+				cout << name[i] << ": " << exponent[i] << " +- " << error[i] << endl;
+			agree = Agree(name[0], exponent[0], error[0], name[1], exponent[1], error[1]);
+			agree = Agree(name[1], exponent[1], error[1], name[2], exponent[2], error[2]) && agree;
+			agree = Agree(name[0], exponent[0], error[0], name[2], exponent[2], error[2]) && agree;
+		}
+	}
+	MPI_Bcast(&agree, 1, MPI_C_BOOL, 0, MPI_COMM_WORLD);
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+	return (agree ? 0 : 1);
+}
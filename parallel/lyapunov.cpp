@@ -41,7 +41,7 @@ inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period)
 	return(t);
 }
 
-void Run(int argc, char *argv[], Node* thisnode)
+void Run(int argc, char *argv[], Node* thisnode, int group, int groups)
 {
 	Real input_rho = atof(argv[1]);
 	Real input_kapa = atof(argv[2]);
@@ -51,8 +51,10 @@ void Run(int argc, char *argv[], Node* thisnode)
 
 	Real t_eq,t_sim;
 
-	LyapunovBox box;
+	static LyapunovBox box; // Box is about the size of the default stack (8 MB), so it must not be a local variable.
 	box.Init(thisnode, input_rho);
+	if (groups > 1)
+		box.Init_Replicas(MPI_COMM_WORLD, group, groups);
 
 	MarkusParticle::kapa = input_kapa;
 	MarkusParticle::mu_plus = input_mu_plus;
@@ -63,73 +65,85 @@ void Run(int argc, char *argv[], Node* thisnode)
 	box.info.str("");
 	box.info << "rho=" << box.density <<  "-k=" << Particle::kapa << "-mu+=" << Particle::mu_plus << "-mu-=" << Particle::mu_minus << "-Dphi=" << Particle::D_phi << "-L=" << Lx;
 
-	if (thisnode->node_id == 0)
+	stringstream address;
+	address.str("");
+	address << box.info.str() << "-r-v.bin";
+	if (group == 0)
+		box.trajfile.Open(address.str(), thisnode->world); // Every node writes its own particles to the trajectory file. Only the box without deviation (group 0) is saved.
+	if (box.Is_Root())
 	{
-		stringstream address;
-		address.str("");
-		address << box.info.str() << "-r-v.bin";
-		box.trajfile.open(address.str().c_str());
 		address.str("");
 		address << "deviation-" << box.info.str() << ".dat";
 		box.outfile.open(address.str().c_str());
+		address.str("");
+		address << "lyapunov-" << box.info.str() << ".dat";
+		box.estimatefile.open(address.str().c_str());
 	}
 
-	if (thisnode->node_id == 0)
+	if (box.Is_Root())
 		cout << " Box information is: " << box.info.str() << endl;
 
 	MPI_Barrier(MPI_COMM_WORLD);
 	t_eq = equilibrium(&box, equilibrium_step, saving_period);
 	MPI_Barrier(MPI_COMM_WORLD);
 
-	if (thisnode->node_id == 0)
+	if (box.Is_Root())
 		cout << " Done in " << floor(t_eq / 60.0) << " minutes and " << t_eq - 60*floor(t_eq / 60.0) << " s" << endl;
 
 	MPI_Barrier(MPI_COMM_WORLD);
-	t_sim = box.Lyapunov_Exponent(10,100, 0.1, 100, 0.01, 20, 5);
+	t_sim = box.Lyapunov_Exponent(10,100, 0.1, 100, 0.01, 20, (groups > 1) ? groups - 1 : 5); // With replicas, each group evolves one direction.
 	MPI_Barrier(MPI_COMM_WORLD);
 
-	if (thisnode->node_id == 0)
+	if (box.Is_Root())
 	{
 		cout << " Done in " << floor(t_sim / 60.0) << " minutes and " << t_sim - 60*floor(t_sim / 60.0) << " s" << endl;
 		box.outfile.close();
-		box.trajfile.close();
+		box.estimatefile.close();
 	}
+	box.trajfile.Close();
 
 	MPI_Barrier(MPI_COMM_WORLD);
 }
 
-bool Run_From_File(int argc, char *argv[], Node* thisnode)
+bool Run_From_File(int argc, char *argv[], Node* thisnode, int group, int groups)
 {
 	Real t_eq,t_sim;
 
-	LyapunovBox box;
+	static LyapunovBox box; // Box is about the size of the default stack (8 MB), so it must not be a local variable.
 	if (!box.Init(thisnode, argv[1]))
 		return false;
+	if (groups > 1)
+		box.Init_Replicas(MPI_COMM_WORLD, group, groups);
 
 	Particle::noise_amplitude = sqrt(2*Particle::D_phi) / sqrt(dt); // noise amplitude depends on the step (dt) because of ito calculation. If we have epsilon in our differential equation and we descritise it with time steps dt, the noise in each step that we add is epsilon times sqrt(dt) if we factorise it with a dt we have dt*(epsilon/sqrt(dt)).
 	box.info.str("");
 	box.info << "rho=" << box.density <<  "-k=" << Particle::kapa << "-mu+=" << Particle::mu_plus << "-mu-=" << Particle::mu_minus << "-Dphi=" << Particle::D_phi << "-L=" << Lx;
 
 	ofstream out_file;
-	if (thisnode->node_id == 0)
+	if (box.Is_Root())
 	{
 		stringstream address;
 		address.str("");
 		address << "deviation-" << box.info.str() << ".dat";
 		box.outfile.open(address.str().c_str());
+		address.str("");
+		address << "lyapunov-" << box.info.str() << ".dat";
+		box.estimatefile.open(address.str().c_str());
 	}
 
-	if (thisnode->node_id == 0)
+	if (box.Is_Root())
 		cout << " Box information is: " << box.info.str() << endl;
 
 	MPI_Barrier(MPI_COMM_WORLD);
- 	t_sim = box.Lyapunov_Exponent(1, 10, 0.1, 10, 3);
+ 	t_sim = box.Lyapunov_Exponent(1, 10, 0.1, 10, (groups > 1) ? groups - 1 : 3);
 	MPI_Barrier(MPI_COMM_WORLD);
 
-	if (thisnode->node_id == 0)
+	if (box.Is_Root())
 	{
 		cout << " Done in " << floor(t_sim / 60.0) << " minutes and " << t_sim - 60*floor(t_sim / 60.0) << " s" << endl;
 		out_file.close();
+		box.outfile.close();
+		box.estimatefile.close();
 	}
 	
 	MPI_Barrier(MPI_COMM_WORLD);
@@ -145,29 +159,54 @@ void Init_Nodes(Node& thisnode, int input_seed = seed)
 		while (!thisnode.Chek_Seeds())
 		{
 			thisnode.seed = time(NULL) + thisnode.node_id*112488;
-			MPI_Barrier(MPI_COMM_WORLD);
+			MPI_Barrier(thisnode.world);
 		}
 	#endif
 	C2DVector::Init_Rand(thisnode.seed);
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(thisnode.world);
 }
 
+// To run:
+// mpirun -np num_process a.out rho kapa mu_plus mu_minus D_phi [ranks_per_box]
+// mpirun -np num_process a.out checkpoint [ranks_per_box]
+// If ranks_per_box is given, the processes are split to groups of ranks_per_box, group 0 evolves the box and each other group evolves one deviation at the same time (LyapunovBox::Evolution_Replicas). Otherwise the directions are the tangent vectors of the linearized dynamics (LINEARIZED_LYAPUNOV), or the deviations are evolved one after the other.
 int main(int argc, char *argv[])
 {
 	int this_node_id, total_nodes;
 	MPI_Status status;
-	MPI_Init(&argc, &argv);
+	int thread_support;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support); // Nodes may use threads (OpenMP), but only the master thread calls MPI.
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &this_node_id);
+	MPI_Comm_size(MPI_COMM_WORLD, &total_nodes);
+	bool from_file = (argc <= 3);
+	int ranks_per_box = total_nodes;
+	if (from_file && argc == 3)
+		ranks_per_box = atoi(argv[2]);
+	if (!from_file && argc > 6)
+		ranks_per_box = atoi(argv[6]);
+	if (ranks_per_box < 1 || total_nodes % ranks_per_box != 0)
+	{
+		if (this_node_id == 0)
+			cout << "Error: number of processes must be a multiple of ranks_per_box" << endl;
+		MPI_Finalize();
+		exit(0);
+	}
+	int groups = total_nodes / ranks_per_box;
+	int group = this_node_id / ranks_per_box;
+	MPI_Comm box_comm;
+	MPI_Comm_split(MPI_COMM_WORLD, group, this_node_id, &box_comm);
 
-	Node thisnode;
+	Node thisnode(box_comm);
+	thisnode.compact_halo = false; // Deviations are much smaller than the precision of compact boundary data.
 	Init_Nodes(thisnode);
 
-	if (argc > 2)
-		Run(argc, argv, &thisnode);
+	if (!from_file)
+		Run(argc, argv, &thisnode, group, groups);
 	else
-		Run_From_File(argc, argv, &thisnode);
+		Run_From_File(argc, argv, &thisnode, group, groups);
 
 	MPI_Barrier(MPI_COMM_WORLD);
 	MPI_Finalize();
 
 }
-
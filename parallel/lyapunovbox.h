@@ -13,59 +13,305 @@ public:
 	VectorSet us,vs,vs0; // The us (unit set) is the unit vector showing direction of the largest lyapunov exponents.
 	vector<Real> t,tau;
 	vector<GrowthRatio> ratio;
-	vector<State_Hyper_Vector> gamma;
-	
-	ofstream outfile, trajfile;
+	Lyapunov_Estimate estimate; // Running exponents of the last Lyapunov_Exponent, the evolution stops when they are converged.
+	vector<Box_State> gamma; // States of the box at the times t (Evolution), they are reused by the next evolutions of the same length.
+	Box_Snapshot snapshot[2]; // Engine states that the deviations start from, Load of a snapshot does not need to update the cells.
+	vector<Box_Snapshot> lists; // Cells and verlet lists of the unperturbed box after each cell update of the current interval (Reference_Multi_Step), the deviations use them (Follow_Multi_Step).
+	Real list_skin; // The pairs of the own particles of the reference lists are found up to Particle::rv + list_skin. It is lyapunov_skin if the cells are wide enough, otherwise zero and the lists are not reused.
 	
+	ofstream outfile;
+	ofstream estimatefile; // The running exponents and their errors after each batch
+	Trajectory trajfile;
+
+// Concurrent replicas (Init_Replicas): the nodes are split to groups, group 0 evolves the box and group i+1 evolves the box with deviation i at the same time. The deviations are not kept as full state vectors, each node of a group keeps a slice of particle ids of all of them (slice_first to slice_first + slice_size) and the dot products are summed over the nodes of the group by MPI_Allreduce.
+	int group, groups;
+	MPI_Comm slice_comm; // Nodes with the same node_id in all groups, they have the same slice.
+	int slice_first, slice_size;
+	vector<int> slice_count, slice_displacement; // Number of doubles and first double of the slice of each node of the group (3 doubles for each particle).
+	vector<vector<Real> > u, deviation; // Slices of us and vs
+// Linearized dynamics (LINEARIZED_LYAPUNOV): the directions are the tangent vectors of the particles (Tangent), they are evolved with the box and each node keeps the tangent vectors of its own particles.
+	bool linearized; // It is set by LINEARIZED_LYAPUNOV and can be changed before Init_Deviation.
+
+	LyapunovBox();
+
 	void Init_Deviation(int direction_num);
 	void Init_Time(const Real, const Real);
-
-	void Add_Deviation(const State_Hyper_Vector&); // Add argument state vector as a deviation to the state of the box
+	void Init_Replicas(MPI_Comm all, int input_group, int input_groups); // All nodes of all groups must call it after Init of the box.
+	bool Is_Root() const; // The first node of group 0 writes the outputs
+
+	void Add_Deviation(const State_Hyper_Vector&, const Box_Snapshot* reference = NULL); // Add argument state vector as a deviation to the state of the box. The verlet lists of the reference are used if they are valid.
+	void Reference_Multi_Step(int steps, int interval); // Multi_Step of the unperturbed box that keeps its lists after each cell update.
+	void Follow_Multi_Step(int steps, int interval); // Multi_Step of a perturbed box with the lists of the last Reference_Multi_Step.
+	bool Follow_Neighbor_List(const Box_Snapshot& reference); // Use the verlet lists of the reference for the pairs of the own particles if thisnode has the same particles in its cells and they are close to the reference. It returns false if the lists must be made again.
+	void Init_List_Skin(); // Set list_skin by the narrowest cell
+	void Gather_State(State_Hyper_Vector& sv); // Every node gets the state of all particles without the cell update of Save.
+	void Measure_Deviation(const State_Hyper_Vector& reference, State_Hyper_Vector& dsv); // dsv is the state of the box minus the reference (like State_Hyper_Vector::Difference), every node gets all of it.
 	void Evolution();
 	void Evolution_Reorthonormalize(bool save);
+	void Evolution_Replicas(bool save); // Evolution_Reorthonormalize with concurrent replicas.
+	void Evolution_Tangent(bool save); // Evolution_Reorthonormalize with the linearized dynamics.
+	bool Record(int j); // Write the ratios of interval j and add them to the estimate. It returns true if the estimate is converged.
+	void Write_Header(); // First line of outfile, the way of the computation and its directions.
+	void Print_Estimate() const;
+
+	void Gather_Slice(vector<Real>& slice); // Slice of the state of the box (x, y, theta of each particle of the slice)
+	void Set_State(const vector<Real>& slice); // Set the state of the box from the slices of all nodes of the group
+	void Load_Replica(const vector<Real>& reference); // A replica (group > 0) starts from the state of the box (reference slice) plus its deviation, like Add_Deviation.
+	void Reset_Replica(const vector<vector<Real> >& v); // A replica that has the deviation v from the box goes back to the box plus its new deviation. Only the own particles are changed.
+	void Own_Entries(const vector<Real>& slice, vector<int>& id, vector<Real>& entry); // Entries of a sliced vector for the own particles (id, sorted)
+	void Exchange_Slices(vector<vector<Real> >& state); // state[g] is the slice of the state of group g.
+	Real Slice_Dot(const vector<Real>& a, const vector<Real>& b); // Dot product of two sliced vectors
+	void Renormalize_Slices(vector<vector<Real> >& v); // Gram-Schmidt like VectorSet::Renormalize(us), the result is in u.
+	void Own_Particles(vector<int>& id); // Ids of the particles of the cells of thisnode
+	Real Tangent_Dot(const vector<int>& id, int a, int b); // Dot product of tangent vectors a and b of all particles
+	void Renormalize_Tangent(vector<Real>& magnitude); // Gram-Schmidt of the tangent vectors, magnitude[i] is the length of vector i after the projection.
 	Real Lyapunov_Exponent(const Real, const Real, const Real, const Real, const int); // Finding the largest lyapunov exponent
 	Real Lyapunov_Exponent(const Real, const Real, const Real, const Real, const Real, const Real, const int); // Finding the largest lyapunov exponent
 };
 
 
 
+LyapunovBox::LyapunovBox()
+{
+	group = 0;
+	groups = 1;
+	list_skin = 0;
+	slice_comm = MPI_COMM_NULL;
+	#ifdef LINEARIZED_LYAPUNOV
+		linearized = true;
+	#else
+		linearized = false;
+	#endif
+}
+
+bool LyapunovBox::Is_Root() const
+{
+	return (thisnode->node_id == 0 && group == 0);
+}
+
 void LyapunovBox::Init_Deviation(int direction_num)
 {
+	if (groups > 1)
+	{
+		if (direction_num != groups - 1)
+		{
+			cout << "Error: number of directions must be the number of groups minus one" << endl;
+			exit(0);
+		}
+// Every group but the box evolves a direction, there is no null direction. The vectors are random (the same on all nodes) and orthonormal.
+		VectorSet::amplitude = 1e-7;
+		us.amplitude = 1e-7;
+		u.assign(direction_num, vector<Real>(3*slice_size, 0));
+		deviation = u;
+		vector<vector<Real> > v = u;
+		for (int i = 0; i < direction_num; i++)
+			for (int j = 0; j < 3*slice_size; j++)
+				v[i][j] = 0.001*(2*Counter_Random(thisnode->noise_seed, (long int) i*N + slice_first + j/3, 2 + j%3) - 1);
+		Renormalize_Slices(v);
+		GrowthRatio::direction_num = direction_num;
+		return;
+	}
+// All tangent vectors are random (the same on all nodes) and orthonormal, like the deviations no direction is null.
+	if (linearized)
+	{
+		long int tangent_seed = thisnode->seed;
+		MPI_Bcast(&tangent_seed, 1, MPI_LONG, 0, thisnode->world);
+		Tangent::Init(N, direction_num);
+		for (int id = 0; id < N; id++)
+			for (int i = 0; i < direction_num; i++)
+				for (int c = 0; c < 3; c++)
+					Tangent::Of(id)[3*i+c] = 2*Counter_Random(tangent_seed, (long int) id*direction_num + i, c) - 1;
+		vector<Real> magnitude;
+		Renormalize_Tangent(magnitude);
+		GrowthRatio::direction_num = direction_num;
+		return;
+	}
+	Tangent::Delete();
+// Like the replicas and the tangent vectors, no direction is null.
+	VectorSet::null_num = 0;
 	us.direction_num = direction_num;
 	us.particle_num = N;
 	us.amplitude = 1e-7;
 	us.Init();
 	us.Rand();
+// The random generators of the nodes differ, the directions of the master node are used by all nodes (each node adds the deviations to its own particles).
+	for (int i = 0; i < direction_num; i++)
+		MPI_Bcast(us.v[i].particle, 3*N, MPI_DOUBLE, 0, thisnode->world);
 	vs.Init();
 	vs0.Init();
 	GrowthRatio::direction_num = direction_num;
 }
 
 
-// Add argument state vector as a deviation to the state of the box
-void LyapunovBox::Add_Deviation(const State_Hyper_Vector& dsv)
+// Add argument state vector as a deviation to the state of the box. Each node moves its own particles, the deviation is small and a quick update of the cells is enough.
+void LyapunovBox::Add_Deviation(const State_Hyper_Vector& dsv, const Box_Snapshot* reference)
 {
-	thisnode->Root_Gather();
 	if (N != dsv.N)
 	{
 		cout << "Error: Number of particles in state vectors differ from box" << endl;
 		exit(0);
 	}
-	for (int i = 0; i < N; i++)
+	vector<int> id;
+	Own_Particles(id);
+	for (int n = 0; n < id.size(); n++)
 	{
+		int i = id[n];
 		particle[i].r += dsv.particle[i].r;
 		particle[i].r.Periodic_Transform();
 		particle[i].theta += dsv.particle[i].theta;
 		particle[i].v.x = cos(particle[i].theta);
 		particle[i].v.y = sin(particle[i].theta);
 	}
-	thisnode->Root_Bcast();
-	thisnode->Full_Update_Cells();
+	thisnode->Quick_Update_Cells();
 	#ifdef verlet_list
+	if (reference == NULL || !Follow_Neighbor_List(*reference))
 		thisnode->Update_Neighbor_List();
 	#endif
 }
 
+// Like Box::Multi_Step(steps, interval), but the lists of the pairs of the own particles have the larger radius of the reference.
+void LyapunovBox::Reference_Multi_Step(int steps, int interval)
+{
+	int updates = steps/interval + 1;
+	if (lists.size() < updates)
+		lists.resize(updates);
+	for (int i = 0; i < updates; i++)
+	{
+		int n = (i < updates - 1) ? interval : steps % interval;
+		for (int k = 0; k < n; k++)
+			One_Step();
+		thisnode->Quick_Update_Cells();
+		#ifdef verlet_list
+		thisnode->Update_Neighbor_List(Particle::rv + list_skin);
+		#endif
+		Save(lists[i]);
+	}
+}
+
+void LyapunovBox::Follow_Multi_Step(int steps, int interval)
+{
+	int updates = steps/interval + 1;
+	for (int i = 0; i < updates; i++)
+	{
+		int n = (i < updates - 1) ? interval : steps % interval;
+		for (int k = 0; k < n; k++)
+			One_Step();
+		thisnode->Quick_Update_Cells();
+		#ifdef verlet_list
+		if (!Follow_Neighbor_List(lists[i]))
+			thisnode->Update_Neighbor_List();
+		#endif
+	}
+}
+
+// The lists of the reference have all pairs of the own particles closer than rv + list_skin. If no own particle of thisnode is farther than list_skin/2 from the reference, these lists have all own pairs closer than rv for thisnode too. Only the pairs with the particles of the other nodes are made again (Update_Boundary_Neighbor_List), they have the radius rv like the boundary particles that the nodes send. The own pairs are before them in the lists (Update_Neighbor_List), so the order of the pairs is the same as the lists that thisnode would make and only the far pairs are added, the interactions are the same. Each node decides by itself, the lists are not communicated.
+bool LyapunovBox::Follow_Neighbor_List(const Box_Snapshot& reference)
+{
+	if (list_skin <= 0)
+		return false;
+	static vector<int> first; // First particle of each cell in the reference
+	first.resize(divisor_x*divisor_y);
+	int shift = 0;
+	for (int c = 0; c < divisor_x*divisor_y; c++)
+	{
+		first[c] = shift;
+		shift += reference.cell_size[c];
+	}
+
+	static vector<char> own; // The own particles of thisnode, they are the same in the reference.
+	own.assign(N, 0);
+	Real max_drift2 = list_skin*list_skin/4;
+	for (int x = thisnode->head_cell_idx; x < thisnode->tail_cell_idx; x++)
+		for (int y = thisnode->head_cell_idy; y < thisnode->tail_cell_idy; y++)
+		{
+			int c = x*divisor_y + y;
+			const vector<int>& pid = thisnode->cell[x][y].pid;
+			if (pid.size() != reference.cell_size[c])
+				return false;
+			for (int i = 0; i < pid.size(); i++)
+			{
+				int j = first[c] + i;
+				if (pid[i] != reference.pid[j])
+					return false;
+				C2DVector dr;
+				dr.x = particle[pid[i]].r.x - reference.data[5*j];
+				dr.y = particle[pid[i]].r.y - reference.data[5*j+1];
+				dr.Periodic_Transform();
+				if (dr.Square() > max_drift2)
+					return false;
+				own[pid[i]] = 1;
+			}
+		}
+
+	for (int x = thisnode->head_cell_idx; x < thisnode->tail_cell_idx; x++)
+		for (int y = thisnode->head_cell_idy; y < thisnode->tail_cell_idy; y++)
+		{
+			int c = x*divisor_y + y;
+			for (int i = 0; i < thisnode->cell[x][y].pid.size(); i++)
+			{
+				int j = first[c] + i;
+				vector<int>::const_iterator begin = reference.neighbor_id.begin() + reference.neighbor_offset[j];
+				vector<int>::const_iterator end = reference.neighbor_id.begin() + reference.neighbor_offset[j+1];
+				vector<int>::const_iterator k = begin;
+				while (k != end && own[*k])
+					k++;
+				particle[reference.pid[j]].neighbor_id.assign(begin, k);
+			}
+		}
+	thisnode->Update_Boundary_Neighbor_List();
+	return true;
+}
+
+// Cell_X does not make equal cells, the pairs of the reference lists are only found in the neighboring cells, so the narrowest cell must be as wide as rv + lyapunov_skin.
+void LyapunovBox::Init_List_Skin()
+{
+	Real narrowest = Lx2;
+	for (int i = 0; i < divisor_x; i++)
+		narrowest = min(narrowest, thisnode->Edge_X(i+1) - thisnode->Edge_X(i));
+	for (int i = 0; i < divisor_y; i++)
+		narrowest = min(narrowest, thisnode->Edge_Y(i+1) - thisnode->Edge_Y(i));
+	list_skin = lyapunov_skin;
+	if (lyapunov_skin > 0 && narrowest < Particle::rv + lyapunov_skin)
+	{
+		list_skin = 0;
+		static bool told = false;
+		if (Is_Root() && !told)
+			cout << "The narrowest cell (" << narrowest << ") is smaller than rv + lyapunov_skin, the deviations make their own verlet lists. Decrease the number of cells (divisor_x or divisor_y) or lyapunov_skin to reuse the lists of the box." << endl;
+		told = true;
+	}
+}
+
+// Each node puts its own particles in the state and the sum over the nodes is given to all nodes. The cells and the lists are not changed.
+void LyapunovBox::Gather_State(State_Hyper_Vector& sv)
+{
+	vector<int> id;
+	Own_Particles(id);
+	sv.Null();
+	for (int n = 0; n < id.size(); n++)
+	{
+		sv.particle[id[n]].r = particle[id[n]].r;
+		sv.particle[id[n]].theta = particle[id[n]].theta;
+	}
+	MPI_Allreduce(MPI_IN_PLACE, sv.particle, 3*N, MPI_DOUBLE, MPI_SUM, thisnode->world);
+}
+
+// Like Gather_State, each node only measures the deviation of its own particles. The deviation and the reference may have different particles in a node, so the reference must be the full state.
+void LyapunovBox::Measure_Deviation(const State_Hyper_Vector& reference, State_Hyper_Vector& dsv)
+{
+	vector<int> id;
+	Own_Particles(id);
+	dsv.Null();
+	for (int n = 0; n < id.size(); n++)
+	{
+		int i = id[n];
+		dsv.particle[i].r = particle[i].r - reference.particle[i].r;
+		dsv.particle[i].r.Periodic_Transform();
+		Real theta = particle[i].theta - reference.particle[i].theta;
+		dsv.particle[i].theta = theta - 2*M_PI*ceil((theta - M_PI) / (2*M_PI));
+	}
+	MPI_Allreduce(MPI_IN_PLACE, dsv.particle, 3*N, MPI_DOUBLE, MPI_SUM, thisnode->world);
+}
+
 
 void LyapunovBox::Init_Time(const Real interval, const Real durution)
 {
@@ -92,29 +338,28 @@ void LyapunovBox::Evolution()
 	vs0 = us;
 	vs0.Scale();
 
-	static State_Hyper_Vector gamma_0(N);
-	static State_Hyper_Vector temp_gamma(N);
 	static State_Hyper_Vector temp_gamma_prime(N);
 
-	gamma.clear();
-	Save(gamma_0);
+	if (gamma.size() != tau.size())
+		gamma.assign(tau.size(), Box_State(N));
+	Save(snapshot[0]);
 
 	for (int i = 0; i < tau.size(); i++)
 	{
 		Multi_Step(tau[i], 20);
-		Save(temp_gamma);
-		gamma.push_back(temp_gamma);
+		Save(gamma[i]);
 	}
+	Save(snapshot[1]);
 
 	for (int i = 0; i < us.direction_num; i++)
 	{
-		Load(gamma_0);
+		Load(snapshot[0]);
 		Add_Deviation(vs0.v[i]);
 		for (int j = 0; j < tau.size(); j++)
 		{
 			Multi_Step(tau[j], 20);
 			Save(temp_gamma_prime);
-			vs.v[i] = (temp_gamma_prime - gamma[j]);
+			vs.v[i].Difference(temp_gamma_prime, gamma[j]);
 			Real temp = (vs.v[i] * us.v[i]) / (us.amplitude);
 			ratio[j].r[i] = temp;
 			ratio[j].r2[i] = temp*temp;
@@ -122,34 +367,32 @@ void LyapunovBox::Evolution()
 	}
 
 	vs.Renormalize(us);
-	Load(gamma.back());
+	Load(snapshot[1]);
 }
 
+// The box is evolved for tau[j] from the snapshot of t[j-1], then each deviation starts from the same snapshot. Only the snapshots of t[j-1] and t[j] are kept (snapshot[j%2] and snapshot[(j+1)%2]). The full state is never gathered to the root, the deviations are measured by each node for its own particles (Measure_Deviation).
 void LyapunovBox::Evolution_Reorthonormalize(bool save = false)
 {
+	if (groups > 1)
+	{
+		Evolution_Replicas(save);
+		return;
+	}
+	if (linearized)
+	{
+		Evolution_Tangent(save);
+		return;
+	}
+
 	vs0 = us;
 	vs0.Scale();
 	vs = vs0;
 
-	static State_Hyper_Vector gamma_0(N);
-	static State_Hyper_Vector temp_gamma(N);
-	static State_Hyper_Vector temp_gamma_prime(N);
-
-	gamma.clear();
-	Save(gamma_0);
-
-	gamma.push_back(gamma_0);
+	static State_Hyper_Vector gamma_next(N);
 
-	for (int j = 0; j < tau.size(); j++)
-	{
-		if (thisnode->node_id == 0 && (j % 1000 == 0))
-				cout << "Evolving unpurturbed system for " << dt*t[j] << endl;
-		Multi_Step(tau[j], 20);
-		Save(temp_gamma);
-		gamma.push_back(temp_gamma);
-		if (save && (j % 100 == 0))
-			trajfile << this;
-	}
+	Init_List_Skin();
+	Save(snapshot[0]);
+	int intervals = tau.size();
 
 	if (save)
 	{
@@ -163,34 +406,417 @@ void LyapunovBox::Evolution_Reorthonormalize(bool save = false)
 	{
 		if (thisnode->node_id == 0 && (j % 1000 == 0))
 			cout << "System is in time " << dt*t[j] << endl;
+		Box_Snapshot& current = snapshot[j%2];
+		Box_Snapshot& next = snapshot[(j+1)%2];
+		if (j > 0)
+			Load(current);
+		Reference_Multi_Step(tau[j], 20);
+		Gather_State(gamma_next);
+		Save(next);
+		if (save && (j % 100 == 0))
+			trajfile << this;
+
 		for (int i = 0; i < us.direction_num; i++)
 		{
-			Load(gamma[j]);
-			Add_Deviation(vs.v[i]);
-			Multi_Step(tau[j], 20);
-			Save(temp_gamma_prime);
-			vs.v[i] = (temp_gamma_prime - gamma[j+1]);
+			Load(current);
+			Add_Deviation(vs.v[i], &current);
+			Follow_Multi_Step(tau[j], 20);
+			Measure_Deviation(gamma_next, vs.v[i]);
 		}
 
-		vs.Renormalize(us);
+		vector<Real> growth;
+		vs.Renormalize(us, growth);
 
+// Each deviation starts the next interval with the amplitude again, so the ratio is the growth of one interval and not of all intervals since the start.
 		for (int i = 0; i < us.direction_num; i++)
 		{
-			vs.v[i] = us.v[i]*(vs.v[i] * us.v[i]);
-			Real temp_ratio = (vs.v[i].Magnitude()) / (us.amplitude);
+			vs.v[i].Set_Scaled(us.amplitude, us.v[i]);
+			Real temp_ratio = fabs(growth[i]) / (us.amplitude);
 			ratio[j].r[i] = temp_ratio;
 			ratio[j].r2[i] = temp_ratio*temp_ratio;
 		}
-		if (save)
+		if (save && Record(j))
 		{
-			outfile << dt*t[j];
-			for (int i = 0; i < us.direction_num; i++)
-				outfile << "\t" << ratio[j].r[i];
-			outfile << endl;
+			intervals = j + 1;
+			break;
 		}
 	}
 	vs.Renormalize(us);
-	Load(gamma.back());
+	Load(snapshot[intervals%2]);
+}
+
+void LyapunovBox::Init_Replicas(MPI_Comm all, int input_group, int input_groups)
+{
+	group = input_group;
+	groups = input_groups;
+	if (slice_comm != MPI_COMM_NULL)
+		MPI_Comm_free(&slice_comm);
+	MPI_Comm_split(all, thisnode->node_id, group, &slice_comm);
+
+	slice_count.resize(thisnode->total_nodes);
+	slice_displacement.resize(thisnode->total_nodes);
+	for (int i = 0; i < thisnode->total_nodes; i++)
+	{
+		int first = (long int) N*i / thisnode->total_nodes;
+		int last = (long int) N*(i+1) / thisnode->total_nodes;
+		slice_count[i] = 3*(last - first);
+		slice_displacement[i] = 3*first;
+	}
+	slice_first = slice_displacement[thisnode->node_id] / 3;
+	slice_size = slice_count[thisnode->node_id] / 3;
+
+// The replicas must have the same noises as the box. The noise of a particle depends on its id and the step, not on the node.
+	long int noise_seed = thisnode->seed;
+	MPI_Bcast(&noise_seed, 1, MPI_LONG, 0, all);
+	thisnode->counter_noise = true;
+	thisnode->noise_seed = noise_seed;
+	thisnode->noise_step = 0;
+}
+
+// Each node puts its own particles in a full state and the sum over the nodes is scattered as slices.
+void LyapunovBox::Gather_Slice(vector<Real>& slice)
+{
+	vector<Real> full(3*N, 0);
+	for (int x = thisnode->head_cell_idx; x < thisnode->tail_cell_idx; x++)
+		for (int y = thisnode->head_cell_idy; y < thisnode->tail_cell_idy; y++)
+			for (int i = 0; i < thisnode->cell[x][y].pid.size(); i++)
+			{
+				int id = thisnode->cell[x][y].pid[i];
+				full[3*id] = particle[id].r.x;
+				full[3*id+1] = particle[id].r.y;
+				full[3*id+2] = particle[id].theta;
+			}
+	slice.resize(3*slice_size);
+	MPI_Reduce_scatter(full.data(), slice.data(), slice_count.data(), MPI_DOUBLE, MPI_SUM, thisnode->world);
+}
+
+// Like Load, every node gets the full state and updates its cells.
+void LyapunovBox::Set_State(const vector<Real>& slice)
+{
+	vector<Real> full(3*N);
+	MPI_Allgatherv((void*) slice.data(), 3*slice_size, MPI_DOUBLE, full.data(), slice_count.data(), slice_displacement.data(), MPI_DOUBLE, thisnode->world);
+	for (int i = 0; i < N; i++)
+	{
+		particle[i].r.x = full[3*i];
+		particle[i].r.y = full[3*i+1];
+		particle[i].theta = full[3*i+2];
+		particle[i].v.x = cos(particle[i].theta);
+		particle[i].v.y = sin(particle[i].theta);
+	}
+	thisnode->Full_Update_Cells();
+	#ifdef verlet_list
+		thisnode->Update_Neighbor_List();
+	#endif
+}
+
+void LyapunovBox::Load_Replica(const vector<Real>& reference)
+{
+	if (group == 0)
+		return;
+	vector<Real> slice = reference;
+	for (int k = 0; k < slice_size; k++)
+	{
+		C2DVector r;
+		r.x = slice[3*k] + deviation[group-1][3*k];
+		r.y = slice[3*k+1] + deviation[group-1][3*k+1];
+		r.Periodic_Transform();
+		slice[3*k] = r.x;
+		slice[3*k+1] = r.y;
+		slice[3*k+2] += deviation[group-1][3*k+2];
+	}
+	Set_State(slice);
+}
+
+// The replica is at the box plus v, so the box plus the new deviation is the replica plus (deviation - v). The particles move much less than a cell and each node only needs its own particles, the cells are updated like after a step.
+void LyapunovBox::Reset_Replica(const vector<vector<Real> >& v)
+{
+	if (group == 0)
+		return;
+	vector<Real> change(3*slice_size);
+	for (int k = 0; k < 3*slice_size; k++)
+		change[k] = deviation[group-1][k] - v[group-1][k];
+	vector<int> id;
+	vector<Real> entry;
+	Own_Entries(change, id, entry);
+	for (int n = 0; n < id.size(); n++)
+	{
+		Particle& p = particle[id[n]];
+		p.r.x += entry[3*n];
+		p.r.y += entry[3*n+1];
+		p.r.Periodic_Transform();
+		p.theta += entry[3*n+2];
+		p.v.x = cos(p.theta);
+		p.v.y = sin(p.theta);
+	}
+	thisnode->Quick_Update_Cells();
+	#ifdef verlet_list
+		thisnode->Update_Neighbor_List();
+	#endif
+}
+
+// Each node asks the nodes that keep the slices of its own particles for their entries (MPI_Alltoallv), so only the own particles are sent and not the full vector.
+void LyapunovBox::Own_Entries(const vector<Real>& slice, vector<int>& id, vector<Real>& entry)
+{
+	int nodes = thisnode->total_nodes;
+	Own_Particles(id);
+	sort(id.begin(), id.end()); // The slices are ranges of ids, so the ids of each node are together.
+	vector<int> ask_count(nodes, 0), ask_displacement(nodes, 0), give_count(nodes), give_displacement(nodes, 0);
+	int m = 0;
+	for (int n = 0; n < id.size(); n++)
+	{
+		while (3*id[n] >= slice_displacement[m] + slice_count[m])
+			m++;
+		ask_count[m]++;
+	}
+	MPI_Alltoall(ask_count.data(), 1, MPI_INT, give_count.data(), 1, MPI_INT, thisnode->world);
+	for (int i = 1; i < nodes; i++)
+	{
+		ask_displacement[i] = ask_displacement[i-1] + ask_count[i-1];
+		give_displacement[i] = give_displacement[i-1] + give_count[i-1];
+	}
+	vector<int> give_id(give_displacement[nodes-1] + give_count[nodes-1]);
+	MPI_Alltoallv(id.data(), ask_count.data(), ask_displacement.data(), MPI_INT, give_id.data(), give_count.data(), give_displacement.data(), MPI_INT, thisnode->world);
+
+	vector<Real> give(3*give_id.size());
+	for (int n = 0; n < give_id.size(); n++)
+		for (int c = 0; c < 3; c++)
+			give[3*n+c] = slice[3*(give_id[n] - slice_first) + c];
+	for (int i = 0; i < nodes; i++)
+	{
+		ask_count[i] *= 3;
+		ask_displacement[i] *= 3;
+		give_count[i] *= 3;
+		give_displacement[i] *= 3;
+	}
+	entry.resize(3*id.size());
+	MPI_Alltoallv(give.data(), give_count.data(), give_displacement.data(), MPI_DOUBLE, entry.data(), ask_count.data(), ask_displacement.data(), MPI_DOUBLE, thisnode->world);
+}
+
+void LyapunovBox::Exchange_Slices(vector<vector<Real> >& state)
+{
+	vector<Real> slice;
+	Gather_Slice(slice);
+	vector<Real> all(groups*slice.size());
+	MPI_Allgather(slice.data(), slice.size(), MPI_DOUBLE, all.data(), slice.size(), MPI_DOUBLE, slice_comm);
+	state.resize(groups);
+	for (int g = 0; g < groups; g++)
+		state[g].assign(all.begin() + g*slice.size(), all.begin() + (g+1)*slice.size());
+}
+
+Real LyapunovBox::Slice_Dot(const vector<Real>& a, const vector<Real>& b)
+{
+	Real local = 0, result;
+	for (int j = 0; j < a.size(); j++)
+		local += a[j]*b[j];
+	MPI_Allreduce(&local, &result, 1, MPI_DOUBLE, MPI_SUM, thisnode->world);
+	return (result);
+}
+
+void LyapunovBox::Renormalize_Slices(vector<vector<Real> >& v)
+{
+	for (int i = 0; i < v.size(); i++)
+	{
+		u[i] = v[i];
+		for (int j = 0; j < i; j++)
+		{
+			Real projection = Slice_Dot(u[j], u[i]);
+			for (int k = 0; k < u[i].size(); k++)
+				u[i][k] -= u[j][k]*projection;
+		}
+		Real magnitude = sqrt(Slice_Dot(u[i], u[i]));
+		for (int k = 0; k < u[i].size(); k++)
+			u[i][k] /= magnitude;
+	}
+}
+
+// All groups evolve for tau[j] at the same time, then the deviations are the differences of the replicas and the box (group 0). After Gram-Schmidt, each replica starts again from the box plus its new deviation, like Load(gamma[j]) and Add_Deviation in Evolution_Reorthonormalize. Only the first start loads the full state (the replicas may be far from the box), the next ones move the own particles (Reset_Replica).
+void LyapunovBox::Evolution_Replicas(bool save = false)
+{
+	int direction_num = u.size();
+	for (int i = 0; i < direction_num; i++)
+		for (int k = 0; k < u[i].size(); k++)
+			deviation[i][k] = u[i][k]*us.amplitude;
+
+	vector<vector<Real> > state;
+	Exchange_Slices(state);
+	Load_Replica(state[0]);
+
+	if (save && Is_Root())
+	{
+		outfile << 0;
+		for (int i = 0; i < direction_num; i++)
+			outfile << "\t" << 1;
+		outfile << endl;
+	}
+
+	vector<vector<Real> > v(direction_num, vector<Real>(3*slice_size));
+	for (int j = 0; j < tau.size(); j++)
+	{
+		if (Is_Root() && (j % 1000 == 0))
+			cout << "System is in time " << dt*t[j] << endl;
+		Multi_Step(tau[j], 20);
+		if (save && group == 0 && (j % 100 == 0))
+			trajfile << this;
+
+		Exchange_Slices(state);
+// Deviations are the differences of the states like State_Hyper_Vector::Difference
+		for (int i = 0; i < direction_num; i++)
+			for (int k = 0; k < slice_size; k++)
+			{
+				C2DVector dr;
+				dr.x = state[i+1][3*k] - state[0][3*k];
+				dr.y = state[i+1][3*k+1] - state[0][3*k+1];
+				dr.Periodic_Transform();
+				Real dtheta = state[i+1][3*k+2] - state[0][3*k+2];
+				v[i][3*k] = dr.x;
+				v[i][3*k+1] = dr.y;
+				v[i][3*k+2] = dtheta - 2*M_PI*ceil((dtheta - M_PI) / (2*M_PI));
+			}
+
+		Renormalize_Slices(v);
+
+// Like the VectorSet renormalization, each replica starts the next interval with a deviation of the amplitude along its new direction.
+		for (int i = 0; i < direction_num; i++)
+		{
+			Real projection = Slice_Dot(v[i], u[i]);
+			for (int k = 0; k < u[i].size(); k++)
+				deviation[i][k] = u[i][k]*us.amplitude;
+			Real temp_ratio = fabs(projection) / (us.amplitude);
+			ratio[j].r[i] = temp_ratio;
+			ratio[j].r2[i] = temp_ratio*temp_ratio;
+		}
+		if (save && Record(j))
+			break;
+
+		Reset_Replica(v);
+	}
+	Renormalize_Slices(deviation);
+}
+
+void LyapunovBox::Own_Particles(vector<int>& id)
+{
+	id.clear();
+	for (int x = thisnode->head_cell_idx; x < thisnode->tail_cell_idx; x++)
+		for (int y = thisnode->head_cell_idy; y < thisnode->tail_cell_idy; y++)
+			id.insert(id.end(), thisnode->cell[x][y].pid.begin(), thisnode->cell[x][y].pid.end());
+}
+
+Real LyapunovBox::Tangent_Dot(const vector<int>& id, int a, int b)
+{
+	Real local = 0, result;
+	for (int n = 0; n < id.size(); n++)
+	{
+		const Real* t = Tangent::Of(id[n]);
+		for (int c = 0; c < 3; c++)
+			local += t[3*a+c]*t[3*b+c];
+	}
+	MPI_Allreduce(&local, &result, 1, MPI_DOUBLE, MPI_SUM, thisnode->world);
+	return (result);
+}
+
+// Only the tangent vectors of the own particles are changed, the ghosts get them in the next step (Node::Send_Receive_Tangent).
+void LyapunovBox::Renormalize_Tangent(vector<Real>& magnitude)
+{
+	vector<int> id;
+	Own_Particles(id);
+	magnitude.resize(Tangent::num);
+	for (int i = 0; i < Tangent::num; i++)
+	{
+		for (int j = 0; j < i; j++)
+		{
+			Real projection = Tangent_Dot(id, j, i);
+			for (int n = 0; n < id.size(); n++)
+			{
+				Real* t = Tangent::Of(id[n]);
+				for (int c = 0; c < 3; c++)
+					t[3*i+c] -= t[3*j+c]*projection;
+			}
+		}
+		magnitude[i] = sqrt(Tangent_Dot(id, i, i));
+		for (int n = 0; n < id.size(); n++)
+		{
+			Real* t = Tangent::Of(id[n]);
+			for (int c = 0; c < 3; c++)
+				t[3*i+c] /= magnitude[i];
+		}
+	}
+}
+
+// The box and its tangent vectors are evolved for tau[j] in one pass, the growth ratio of each direction is its length after Gram-Schmidt, like the ratio of the deviations in Evolution_Reorthonormalize. The deviations are infinitesimal, there is no amplitude.
+void LyapunovBox::Evolution_Tangent(bool save = false)
+{
+	if (save && Is_Root())
+	{
+		outfile << 0;
+		for (int i = 0; i < Tangent::num; i++)
+			outfile << "\t" << 1;
+		outfile << endl;
+	}
+
+	vector<Real> magnitude;
+	for (int j = 0; j < tau.size(); j++)
+	{
+		if (Is_Root() && (j % 1000 == 0))
+			cout << "System is in time " << dt*t[j] << endl;
+		Multi_Step(tau[j], 20);
+		if (save && (j % 100 == 0))
+			trajfile << this;
+
+		Renormalize_Tangent(magnitude);
+		for (int i = 0; i < Tangent::num; i++)
+		{
+			ratio[j].r[i] = magnitude[i];
+			ratio[j].r2[i] = magnitude[i]*magnitude[i];
+		}
+		if (save && Record(j))
+			break;
+	}
+}
+
+// All nodes of all groups have the same ratios, so they stop at the same interval.
+bool LyapunovBox::Record(int j)
+{
+	if (Is_Root())
+	{
+		outfile << dt*t[j];
+		for (int i = 0; i < ratio[j].r.size(); i++)
+			outfile << "\t" << ratio[j].r[i];
+		outfile << endl;
+	}
+	if (estimate.Add(ratio[j].r, dt*tau[j]) && Is_Root())
+	{
+		estimatefile << dt*t[j];
+		for (int i = 0; i < estimate.sum.size(); i++)
+			estimatefile << "\t" << estimate.Exponent(i) << "\t" << estimate.Error(i);
+		estimatefile << endl;
+	}
+	return (estimate.Converged());
+}
+
+void LyapunovBox::Write_Header()
+{
+	if (!Is_Root())
+		return;
+	outfile << "# ";
+	if (groups > 1)
+		outfile << "concurrent replicas";
+	else if (linearized)
+		outfile << "linearized dynamics";
+	else
+		outfile << "finite deviations";
+	outfile << ", time and growth ratio of " << GrowthRatio::direction_num << " random orthonormal directions (none is null)" << endl;
+}
+
+void LyapunovBox::Print_Estimate() const
+{
+	if (estimate.Converged())
+		cout << "Lyapunov exponents converged after " << estimate.intervals << " intervals:";
+	else
+		cout << "Lyapunov exponents after " << estimate.intervals << " intervals (not converged):";
+	for (int i = 0; i < estimate.sum.size(); i++)
+		if (!estimate.is_null[i])
+			cout << " " << estimate.Exponent(i) << " +- " << estimate.Error(i);
+	cout << endl;
 }
 
 // Finding the largest lyapunov exponent
@@ -204,19 +830,24 @@ Real LyapunovBox::Lyapunov_Exponent(const Real eq_interval, const Real eq_durati
 	Evolution_Reorthonormalize(false);
 
 	end_time = clock();
-	if (thisnode->node_id == 0)
+	if (Is_Root())
 		cout << "Finded unit orthonormal vectors in: " << (end_time - start_time) / CLOCKS_PER_SEC << " s" << endl;
 	start_time = end_time;
 	
 	Init_Time(interval, duration);
-	if (thisnode->node_id == 0)
+	if (Is_Root())
 		cout << "Initialized time set for lyapunov computation " << endl;
+	estimate.Init(GrowthRatio::direction_num, lyapunov_batch, lyapunov_min_batches, lyapunov_tolerance);
+	Write_Header();
 	Evolution_Reorthonormalize(true);
 
 	end_time = clock();
 	Real running_time = (end_time - start_time) / CLOCKS_PER_SEC;
-	if (thisnode->node_id == 0)
+	if (Is_Root())
+	{
 		cout << "Finded unit orthonormal vectors in: " << (end_time - start_time) / CLOCKS_PER_SEC << " s" << endl;
+		Print_Estimate();
+	}
 	return (running_time);
 }
 
@@ -230,7 +861,7 @@ Real LyapunovBox::Lyapunov_Exponent(const Real eq_interval0, const Real eq_durat
 	Evolution_Reorthonormalize(false);
 
 	end_time = clock();
-	if (thisnode->node_id == 0)
+	if (Is_Root())
 		cout << "Finded unit orthonormal vectors in: " << (end_time - start_time) / CLOCKS_PER_SEC << " s" << endl;
 	start_time = end_time;
 
@@ -238,19 +869,24 @@ Real LyapunovBox::Lyapunov_Exponent(const Real eq_interval0, const Real eq_durat
 	Evolution_Reorthonormalize(false);
 
 	end_time = clock();
-	if (thisnode->node_id == 0)
+	if (Is_Root())
 		cout << "Finded unit orthonormal vectors more precise in: " << (end_time - start_time) / CLOCKS_PER_SEC << " s" << endl;
 	start_time = end_time;	
 
 	Init_Time(interval, duration);
-	if (thisnode->node_id == 0)
+	if (Is_Root())
 		cout << "Initialized time set for lyapunov computation " << endl;
+	estimate.Init(GrowthRatio::direction_num, lyapunov_batch, lyapunov_min_batches, lyapunov_tolerance);
+	Write_Header();
 	Evolution_Reorthonormalize(true);
 
 	end_time = clock();
 	Real running_time = (end_time - start_time) / CLOCKS_PER_SEC;
-	if (thisnode->node_id == 0)
+	if (Is_Root())
+	{
 		cout << "Finded unit orthonormal vectors in: " << (end_time - start_time) / CLOCKS_PER_SEC << " s" << endl;
+		Print_Estimate();
+	}
 	return (running_time);
 }
 
@@ -17,7 +17,7 @@ inline void timing_information(Node* node, clock_t start_time, int i_step, int t
 }
 
 
-inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period, ofstream& out_file)
+inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period, Trajectory& out_file)
 {
 	clock_t start_time, end_time;
 	start_time = clock();
@@ -41,7 +41,7 @@ inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period,
 }
 
 
-inline Real data_gathering(Box* box, long int total_step, int saving_period, ofstream& out_file)
+inline Real data_gathering(Box* box, long int total_step, int saving_period, Trajectory& out_file)
 {
 	clock_t start_time, end_time;
 	start_time = clock();
@@ -88,10 +88,10 @@ void Change_Noise(int argc, char *argv[], Node* thisnode)
 	Particle::g = input_g;
 	Particle::alpha = input_alpha;
 
-	Box box;
+	static Box box; // Box is about the size of the default stack (8 MB), so it must not be a local variable.
 	box.Init(thisnode, input_rho);
 
-	ofstream out_file;
+	Trajectory out_file;
 
 	for (int i = 0; i < noise_list.size(); i++)
 	{
@@ -99,13 +99,10 @@ void Change_Noise(int argc, char *argv[], Node* thisnode)
 		box.info.str("");
 		box.info << "rho=" << box.density <<  "-g=" << Particle::g << "-alpha=" << Particle::alpha << "-noise=" << noise_list[i] << "-cooling";
 
-		if (thisnode->node_id == 0)
-		{
-			stringstream address;
-			address.str("");
-			address << box.info.str() << "-r-v.bin";
-			out_file.open(address.str().c_str());
-		}
+		stringstream address;
+		address.str("");
+		address << box.info.str() << "-r-v.bin";
+		out_file.Open(address.str()); // Every node writes its own particles to the trajectory file.
 
 		if (thisnode->node_id == 0)
 			cout << " Box information is: " << box.info.str() << endl;
@@ -121,10 +118,8 @@ void Change_Noise(int argc, char *argv[], Node* thisnode)
 		MPI_Barrier(MPI_COMM_WORLD);
 
 		if (thisnode->node_id == 0)
-		{
 			cout << " Done in " << (t_sim / 60.0) << " minutes" << endl;
-			out_file.close();
-		}
+		out_file.Close();
 	}
 	MPI_Barrier(MPI_COMM_WORLD);
 }
@@ -145,10 +140,10 @@ void Change_Alpha(int argc, char *argv[], Node* thisnode)
 	Particle::g = input_g;
 	Particle::alpha = 0;
 
-	Box box;
+	static Box box; // Box is about the size of the default stack (8 MB), so it must not be a local variable.
 	box.Init(thisnode, input_rho);
 
-	ofstream out_file;
+	Trajectory out_file;
 
 	for (int i = 0; i < alpha_list.size(); i++)
 	{
@@ -156,13 +151,10 @@ void Change_Alpha(int argc, char *argv[], Node* thisnode)
 		box.info.str("");
 		box.info << "rho=" << box.density <<  "-g=" << Particle::g << "-alpha=" << Particle::alpha << "-noise=" << input_noise << "-cooling";
 
-		if (thisnode->node_id == 0)
-		{
-			stringstream address;
-			address.str("");
-			address << box.info.str() << "-r-v.bin";
-			out_file.open(address.str().c_str());
-		}
+		stringstream address;
+		address.str("");
+		address << box.info.str() << "-r-v.bin";
+		out_file.Open(address.str()); // Every node writes its own particles to the trajectory file.
 
 		if (thisnode->node_id == 0)
 		{
@@ -189,10 +181,8 @@ void Change_Alpha(int argc, char *argv[], Node* thisnode)
 		MPI_Barrier(MPI_COMM_WORLD);
 
 		if (thisnode->node_id == 0)
-		{
 			cout << " Done in " << (t_sim / 60.0) << " minutes" << endl;
-			out_file.close();
-		}
+		out_file.Close();
 	}
 	MPI_Barrier(MPI_COMM_WORLD);
 }
@@ -325,7 +315,8 @@ int main(int argc, char *argv[])
 {
 	int this_node_id, total_nodes;
 	MPI_Status status;
-	MPI_Init(&argc, &argv);
+	int thread_support;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support); // Nodes may use threads (OpenMP), but only the master thread calls MPI.
 
 	Node thisnode;
 	Init_Nodes(thisnode);
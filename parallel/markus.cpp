@@ -16,7 +16,7 @@ inline void timing_information(Node* node, clock_t start_time, int i_step, int t
 	MPI_Barrier(MPI_COMM_WORLD);
 }
 
-inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period, ofstream& out_file)
+inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period, Trajectory& out_file)
 {
 	clock_t start_time, end_time;
 	start_time = clock();
@@ -39,7 +39,7 @@ inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period,
 	return(t);
 }
 
-inline Real data_gathering(Box* box, long int total_step, int saving_period, ofstream& out_file)
+inline Real data_gathering(Box* box, long int total_step, int saving_period, Trajectory& out_file)
 {
 	clock_t start_time, end_time;
 	start_time = clock();
@@ -82,13 +82,13 @@ void Change_Noise(int argc, char *argv[], Node* thisnode)
 
 	Real t_eq,t_sim;
 
-	Box box;
+	static Box box; // Box is about the size of the default stack (8 MB), so it must not be a local variable.
 	box.Init(thisnode, input_rho);
 
 	MarkusParticle::mu_plus = input_mu_plus;
 	MarkusParticle::mu_minus = input_mu_minus;
 
-	ofstream out_file;
+	Trajectory out_file;
 
 	for (int i = 0; i < D_list.size(); i++)
 	{
@@ -97,13 +97,10 @@ void Change_Noise(int argc, char *argv[], Node* thisnode)
 		box.info.str("");
 		box.info << "rho=" << box.density <<  "-mu+=" << Particle::mu_plus << "-mu-=" << Particle::mu_minus << "-Dphi=" << Particle::D_phi << "-L=" << Lx;
 
-		if (thisnode->node_id == 0)
-		{
-			stringstream address;
-			address.str("");
-			address << box.info.str() << "-r-v.bin";
-			out_file.open(address.str().c_str());
-		}
+		stringstream address;
+		address.str("");
+		address << box.info.str() << "-r-v.bin";
+		out_file.Open(address.str()); // Every node writes its own particles to the trajectory file.
 
 		if (thisnode->node_id == 0)
 			cout << " Box information is: " << box.info.str() << endl;
@@ -119,10 +116,8 @@ void Change_Noise(int argc, char *argv[], Node* thisnode)
 		MPI_Barrier(MPI_COMM_WORLD);
 
 		if (thisnode->node_id == 0)
-		{
 			cout << " Done in " << (t_sim / 60.0) << " minutes" << endl;
-			out_file.close();
-		}
+		out_file.Close();
 	}
 	MPI_Barrier(MPI_COMM_WORLD);
 }
@@ -147,7 +142,8 @@ int main(int argc, char *argv[])
 {
 	int this_node_id, total_nodes;
 	MPI_Status status;
-	MPI_Init(&argc, &argv);
+	int thread_support;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support); // Nodes may use threads (OpenMP), but only the master thread calls MPI.
 
 	Node thisnode;
 	Init_Nodes(thisnode);
@@ -3,9 +3,16 @@
 
 #include "boundary.h" // Any node has some boundaries with the neighboring nodes. Boundaries have information about adjasent nodes id and cells that are neighbor.
 
+// The 8 neighbors of a node (or a cell) are labelled 0 to 7 starting from right and going counterclockwise. These are the shifts of each neighbor.
+const int neighbor_dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+const int neighbor_dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
 struct Node{
 	int total_nodes; // total number of nodes
 	int node_id; // node_id is the id of thisnode.
+	MPI_Comm world; // Communicator of all nodes of the box. It is MPI_COMM_WORLD unless the world is split to several boxes (like a parameter sweep).
+	MPI_Comm comm; // Cartesian communicator of the grid of nodes.
+	int npx, npy; // The box is divided to npx by npy nodes. They are chosen at runtime by the number of nodes.
 // Box is divided to reagions for our nodes. We lable the node position by idx and idy
 	int idx,idy; // idx and idy shows the x position of the node inside the box
 	int size_x, size_y; // size_x and size_y is the column and row number of cells within thisnode. It might be different, because the number of columns in the box is not dividable to the number of node columns.
@@ -16,23 +23,50 @@ struct Node{
 	int N; // Number of particles in the box. This will be transmitted from the box.
 	Particle* particle; // This is a pointer to the original particle array pointer of the box. We need this pointer in some subroutins
 	vector<Boundary> boundary; // Boundary list
+	vector<Real> noise; // Noise of each particle for the next move
+	bool counter_noise; // If it is true the noise of a particle only depends on noise_seed, noise_step and its id (Counter_Gaussian), not on the generator and the cells of the node. Replicas of a box on different nodes get the same noises (concurrent Lyapunov replicas).
+	long int noise_seed, noise_step;
+	bool compact_halo; // If it is true the boundary data of each step is sent compact with float and 16 bit numbers (see boundary.h). It is not exact, therefore it is only on with COMPACT_HALO (parameters.h), and never for Lyapunov computations and COMPARE.
+// Nodes on the same computer share the boundary data by memory (SHARED_MEMORY_HALO). Each node has two copies of x, y and theta of its particles in shared_window, one for even and one for odd calls of Send_Receive_Data. The neighbors read one copy while thisnode writes the other one, so one synchronization in each step is enough.
+	MPI_Comm shared_comm; // Nodes on the same computer
+	MPI_Win shared_window;
+	Real* shared_data; // Shared memory of thisnode
+	int shared_N; // Number of particles that shared_window has room for. It is allocated again for a bigger box.
+	int shared_parity; // The copy of shared memory that is used in this step
 
 	Cell cell[divisor_x][divisor_y]; // We used cell list in our program. we divide the box to divisor_x by divisor_y cells. each cell has the information about particles id that are inside them.
 	
-	Node();
+	Node(MPI_Comm input_world = MPI_COMM_WORLD);
 
 	void Get_Box_Info(int size, Particle* p);
+	int Boundary_Cells(int px, int py); // Number of boundary cells of a node for a px by py grid of nodes.
+	void Find_Grid(); // Choose npx and npy for the number of nodes.
+	int Find_Node(int x, int y); // Node id at position (x,y) of the grid of nodes.
 	void Init_Topology();
-	void Send_Receive_Data(); // Send and Receive data of each neighboring cell
+	void Init_Shared_Memory(); // Find the nodes on the same computer and allocate the shared window. It is called by Init_Topology.
+	void Send_Receive_Data(bool exact = false); // Send and Receive data of each neighboring cell. Data is sent compact if compact_halo is true, unless exact data is requested.
+	void Send_Receive_Tangent(); // Send and Receive the tangent vectors (tangent.h) of the particles of Send_Receive_Data. It is only needed if there are tangent vectors.
+	void Exchange_Migrants(vector<int>& immigrant); // Send the particles that moved to other nodes to their new node. The particles that moved to thisnode are added to immigrant.
+	void Exchange_Ghosts(); // Send and Receive particle ids and data of each neighboring cell
+	bool Neighbor_Cell(int x, int y, int d, int& nx, int& ny); // Neighbor of cell (x,y) in direction d.
+	bool Is_Own_Cell(int x, int y); // Check if cell (x,y) belongs to thisnode.
+	int Cell_X(Real x); // Column of the cell of a particle at x
+	int Cell_Y(Real y); // Row of the cell of a particle at y
+	Real Edge_X(int i); // Position of the left edge of column i of cells
+	Real Edge_Y(int i); // Position of the bottom edge of row i of cells
 	void Quick_Update_Cells(); // Update particles that are inside each cell
-	void Full_Update_Cells(); // Befor this function, Gather and Bcast must be called to have appropirate behaviour.
-	void Update_Self_Neighbor_List(); // Updating neighborlist of particles inside cells within this node. But the pairs inside the node are considered
+	void Full_Update_Cells(); // Every node must have the same positions of all particles before this function (Root_Bcast or a loaded state). The cells are filled from them and the boundary particles are exchanged with the neighbors (Exchange_Ghosts).
+	void Init_Cells(vector<int>& pid); // Put the particles of thisnode (pid) to the cells, without any information of the other particles.
+	void Sort_Cells(); // Sort particles of each cell by their ids. The order of cells only depends on the positions then (like Init_Cells with sorted ids).
+	void Add_To_Cells(vector<int>& pid); // Add particles to the cells that they are inside.
+	void Update_Self_Neighbor_List(Real radius = Particle::rv); // Updating neighborlist of particles inside cells within this node. But the pairs inside the node are considered
 	void Update_Boundary_Neighbor_List(); // Updating neighborlist of particles inside cells within this node. But one the particles is outside this node.
-	void Update_Neighbor_List(); // Updating neighborlist of particles inside cells within this node. All the pairs are considered.
+	void Update_Neighbor_List(Real self_radius = Particle::rv); // Updating neighborlist of particles inside cells within this node. All the pairs are considered. The pairs inside the node may have a larger radius (Lyapunov reference), the pairs with the other nodes always have rv like the boundary particles (Boundary::Near_Edge).
 	void Send_To_Root(); // Send thisnode information (particle position and angles) to the root node.
 	void Root_Receive(); // Receive the sent information by other nodes
 	void Root_Gather(); // Gather the information by root. Like a Send_To_Root() and Root_Receive() function.
 	void Root_Bcast(); // Send all informations in root to other nodes
+	void Pack_Particles(vector<float>& data, vector<int>& displacement); // Floats of the particles of thisnode for a frame of the trajectory and their places in the frame (in number of particles).
 
 	void Neighbor_List_Interact(); // Interact using neighbor list
 	void Self_Interact(); // Compute interaction of particles withing thisnode
@@ -43,11 +77,25 @@ struct Node{
 	void Print_Info(); // Print information of this node
 };
 
-Node::Node()
+Node::Node(MPI_Comm input_world)
 {
 // Get the information abount total nodes and thisnode id
-	MPI_Comm_size(MPI_COMM_WORLD, &total_nodes);
-	MPI_Comm_rank(MPI_COMM_WORLD, &node_id);
+	world = input_world;
+	comm = MPI_COMM_NULL;
+	MPI_Comm_size(world, &total_nodes);
+	MPI_Comm_rank(world, &node_id);
+	#if defined(COMPACT_HALO) && !defined(COMPARE)
+		compact_halo = true;
+	#else
+		compact_halo = false;
+	#endif
+	shared_comm = MPI_COMM_NULL;
+	shared_window = MPI_WIN_NULL;
+	shared_data = NULL;
+	shared_N = 0;
+	shared_parity = 0;
+	counter_noise = false;
+	noise_seed = noise_step = 0;
 
 	for (int i = 0; i < divisor_x; i++)
 		for (int j = 0; j < divisor_y; j++)
@@ -61,14 +109,81 @@ void Node::Get_Box_Info(int size, Particle* p)
 	Cell::particle = p; // Each cell has a pointer to partilce array of the box. The cell needs this pointer for sum of its actions.
 }
 
-void Node::Init_Topology() // This function must be called after box definition.
+// Number of cells at the boundary of a node (cells of the neighboring nodes that thisnode needs) if the box is divided to px by py nodes. It is a measure of the communication that each node must do in each step. A direction with one node has no boundary, because the node is its own neighbor.
+int Node::Boundary_Cells(int px, int py)
+{
+	int width_x = (divisor_x + px - 1) / px; // The biggest node in the grid
+	int width_y = (divisor_y + py - 1) / py;
+	int count = 0;
+	if (px > 1)
+		count += 2*width_y;
+	if (py > 1)
+		count += 2*width_x;
+	if (px > 1 && py > 1)
+		count += 4;
+	return (count);
+}
+
+// Choosing the grid of nodes. Any number of nodes is accepted. MPI_Dims_create gives the most square grid, but for a prime number of nodes or a narrow box slabs (one row or column of nodes) might need less communication. So we check all grids with npx*npy = total_nodes and choose the one with the least boundary cells.
+void Node::Find_Grid()
 {
-// Check if the number of total nodes is in agreement with the way that the system is devided
-	if ((npx*npy) != total_nodes)
+	int dims[2] = {0, 0};
+	MPI_Dims_create(total_nodes, 2, dims);
+	npx = dims[0];
+	npy = dims[1];
+	if (npx > divisor_x || npy > divisor_y)
+		npx = npy = 0;
+	for (int px = 1; px <= total_nodes; px++)
+		if (total_nodes % px == 0)
+		{
+			int py = total_nodes / px;
+			if (px <= divisor_x && py <= divisor_y)
+				if (npx == 0 || Boundary_Cells(px, py) < Boundary_Cells(npx, npy))
+				{
+					npx = px;
+					npy = py;
+				}
+		}
+// Each node needs at least one column and one row of cells.
+	if (npx == 0)
 	{
-		cout << "Error, bad number of processors. Grid dimension is " << npx << " by " << npy << " that needs exactly " << npx*npy << " processors, but you ran the program with " << total_nodes << " processors." << endl;
+		cout << "Error, bad number of processors. The box has " << divisor_x << " by " << divisor_y << " cells that can not be divided between " << total_nodes << " processors." << endl;
 		exit(0);
 	}
+}
+
+// Finding the node id of the node at position (x,y) of the grid of nodes. MPI_PROC_NULL is returned if there is no such node (outside of a closed box).
+int Node::Find_Node(int x, int y)
+{
+	#ifdef PERIODIC_BOUNDARY_CONDITION
+		x = (x + npx) % npx;
+		y = (y + npy) % npy;
+	#else
+		if (x < 0 || x >= npx || y < 0 || y >= npy)
+			return (MPI_PROC_NULL);
+	#endif
+	int coords[2] = {x, y};
+	int id;
+	MPI_Cart_rank(comm, coords, &id);
+	return (id);
+}
+
+void Node::Init_Topology() // This function must be called after box definition.
+{
+	Find_Grid();
+
+// The grid of nodes is an MPI cartesian topology. It is periodic if the box is periodic. Ranks are not reordered, therefore node_id is the same in comm and world.
+	int dims[2] = {npx, npy};
+	int periods[2];
+	#ifdef PERIODIC_BOUNDARY_CONDITION
+		periods[0] = periods[1] = 1;
+	#else
+		periods[0] = periods[1] = 0;
+	#endif
+	if (comm != MPI_COMM_NULL) // The topology is made again for a new box.
+		MPI_Comm_free(&comm);
+	boundary.clear();
+	MPI_Cart_create(world, 2, dims, periods, 0, &comm);
 
 // Computing the typical column and row number of cells in each node
 	int width_x = divisor_x / npx;
@@ -77,8 +192,10 @@ void Node::Init_Topology() // This function must be called after box definition.
 	int remain_y = divisor_y % npy;
 
 // Finding the position of the node in the grid of nodes. First y index is increasing that means it changes faster than x index
-	idx = node_id / npy;
-	idy = node_id % npy;
+	int coords[2];
+	MPI_Cart_coords(comm, node_id, 2, coords);
+	idx = coords[0];
+	idy = coords[1];
 
 // The first nodes are slightly bigger (width + 1) to match the size of the system. Their number is the same as the reminder of cells in division
 	if (idx < remain_x)
@@ -107,274 +224,198 @@ void Node::Init_Topology() // This function must be called after box definition.
 	tail_cell_idx = head_cell_idx + size_x;
 	tail_cell_idy = head_cell_idy + size_y;
 
-	int list_of_node[npx][npy]; // We need id of the other nodes by giving their position on grid
-	for (int i = 0; i < npx; i++)
-		for (int j = 0; j < npy; j++)
-			list_of_node[i][j] = i*npy+j;
-
-
-// Define a tmporary boundary object for pushback to boundary list of nodes
-	Boundary temp_boundary;
-
-// We first add all boundaries like a periodic boundary system, but at the end we will remove teh nodes boundaries that are within the box boundary.
 // How we label boundaries are important. Typically (Like periodic boundary condition) each node must have 8 neighbors. Right, up righr, up, up left, left, down left, down, down right. We lable them as 0,1,2,3,4,5,6,7 respectively. Shecmaticly they will look like this:
 //	3			2			1
 //	4		thisnode		0
 //	5			6			7
+	int neighbor_node[8]; // Node id of the neighbors. It is MPI_PROC_NULL at the edges of a closed box.
+	MPI_Cart_shift(comm, 0, 1, &neighbor_node[4], &neighbor_node[0]);
+	MPI_Cart_shift(comm, 1, 1, &neighbor_node[6], &neighbor_node[2]);
+	neighbor_node[1] = Find_Node(idx+1, idy+1);
+	neighbor_node[3] = Find_Node(idx-1, idy+1);
+	neighbor_node[5] = Find_Node(idx-1, idy-1);
+	neighbor_node[7] = Find_Node(idx+1, idy-1);
 
-
-// 0 right edge
-	temp_boundary.this_node_id = node_id; // node_id is the current node, thus we give it to the this node of the boundary.
-	temp_boundary.that_node_id = list_of_node[(idx+1)%npx][idy]; // The right node id. Periodic transformation is applied.
-	if (idx == npx)
-		temp_boundary.box_edge = true;
-	for (int y = head_cell_idy; y < tail_cell_idy; y++)
+	for (int i = 0; i < 8; i++)
 	{
-		temp_boundary.this_cell.push_back(&cell[tail_cell_idx-1][y]); // Note: tail_cell_idx-1 is the id of the last cell in thisnode. Because tail_Cell_idx is greater than 1 we don't need % npx
-		temp_boundary.that_cell.push_back(&cell[tail_cell_idx % divisor_x][y]); // Left node cell boundary x index is equal to tail_cell_idx
-	}
-	boundary.push_back(temp_boundary); // Push back to boundary
-	temp_boundary.Delete(); // Deleting temporary boundary for next assignment
-// 1 top right corner
-	temp_boundary.this_node_id = node_id;
-	temp_boundary.that_node_id = list_of_node[(idx+1)%npx][(idy+1)%npy];  // The above right node id. Periodic transformation is applied.
-	if (idx == npx || idy == npy)
-		temp_boundary.box_edge = true;
-	temp_boundary.this_cell.push_back(&cell[tail_cell_idx-1][tail_cell_idy-1]);
-	temp_boundary.that_cell.push_back(&cell[tail_cell_idx % divisor_x][tail_cell_idy % divisor_y]);
-	boundary.push_back(temp_boundary);
-	temp_boundary.Delete();
-// 2 top edge
-	temp_boundary.this_node_id = node_id;
-	temp_boundary.that_node_id = list_of_node[idx][(idy+1)%npy]; // The above node id. Periodic transformation is applied.
-	if (idy == npy)
-		temp_boundary.box_edge = true;
-	for (int x = head_cell_idx; x < tail_cell_idx; x++)
-	{
-		temp_boundary.this_cell.push_back(&cell[x][tail_cell_idy-1]);
-		temp_boundary.that_cell.push_back(&cell[x][tail_cell_idy % divisor_y]);
+// Define a tmporary boundary object for pushback to boundary list of nodes
+		Boundary temp_boundary;
+		temp_boundary.this_node_id = node_id;
+		temp_boundary.that_node_id = neighbor_node[i];
+		temp_boundary.comm = comm;
+// Tag of the boundary is its label. A message that is sent through boundary i is received by boundary (i+4)%8 of the neighbor, so the tag of a message tells its direction. This keeps the messages apart even if two boundaries connect the same pair of nodes (two nodes in a row).
+		temp_boundary.tag = i;
+		temp_boundary.is_active = (neighbor_node[i] != MPI_PROC_NULL);
+		temp_boundary.dx = neighbor_dx[i];
+		temp_boundary.dy = neighbor_dy[i];
+		temp_boundary.edge.x = (neighbor_dx[i] == 1) ? Edge_X(tail_cell_idx) : Edge_X(head_cell_idx);
+		temp_boundary.edge.y = (neighbor_dy[i] == 1) ? Edge_Y(tail_cell_idy) : Edge_Y(head_cell_idy);
+		temp_boundary.box_edge = ((neighbor_dx[i] == 1 && idx == npx-1) || (neighbor_dx[i] == -1 && idx == 0) || (neighbor_dy[i] == 1 && idy == npy-1) || (neighbor_dy[i] == -1 && idy == 0));
+// Cells of thisnode that are next to the boundary and the cells of neighboring node on the other side of it.
+		int x0 = head_cell_idx, x1 = tail_cell_idx;
+		int y0 = head_cell_idy, y1 = tail_cell_idy;
+		if (neighbor_dx[i] == 1)
+			x0 = tail_cell_idx - 1;
+		if (neighbor_dx[i] == -1)
+			x1 = head_cell_idx + 1;
+		if (neighbor_dy[i] == 1)
+			y0 = tail_cell_idy - 1;
+		if (neighbor_dy[i] == -1)
+			y1 = head_cell_idy + 1;
+		for (int x = x0; x < x1; x++)
+			for (int y = y0; y < y1; y++)
+			{
+				temp_boundary.this_cell.push_back(&cell[x][y]);
+				temp_boundary.that_cell.push_back(&cell[(x + neighbor_dx[i] + divisor_x) % divisor_x][(y + neighbor_dy[i] + divisor_y) % divisor_y]);
+			}
+		boundary.push_back(temp_boundary); // Push back to boundary
 	}
-	boundary.push_back(temp_boundary);
-	temp_boundary.Delete();
-// 3 top left corner
-	temp_boundary.this_node_id = node_id;
-	temp_boundary.that_node_id = list_of_node[(idx-1+npx)%npx][(idy+1)%npy]; // The above left node id. Periodic transformation is applied.
-	if (idx == 0 || idy == npy)
-		temp_boundary.box_edge = true;
-	temp_boundary.this_cell.push_back(&cell[head_cell_idx][tail_cell_idy-1]);
-	temp_boundary.that_cell.push_back(&cell[(head_cell_idx-1+divisor_x) % divisor_x][tail_cell_idy % divisor_y]);
-	boundary.push_back(temp_boundary);
-	temp_boundary.Delete();
-// 4 left edge
-	temp_boundary.this_node_id = node_id;
-	temp_boundary.that_node_id = list_of_node[(idx-1+npx)%npx][idy]; // The left node id. Periodic transformation is applied.
-	if (idx == 0)
-		temp_boundary.box_edge = true;
-	for (int y = head_cell_idy; y < tail_cell_idy; y++)
+
+// If there is only one column of nodes, the left and right cells of thisnode are its own cells and there is nothing to send. The corner cells are in the top and bottom boundaries as well, therefore corners must be inactive to avoid sending them twice. The same for a single row of nodes.
+	if (npx == 1)
 	{
-		temp_boundary.this_cell.push_back(&cell[head_cell_idx][y]);
-		temp_boundary.that_cell.push_back(&cell[(head_cell_idx-1+divisor_x) % divisor_x][y]);
+		boundary[0].is_active = boundary[4].is_active = false;
+		boundary[1].is_active = boundary[3].is_active = boundary[5].is_active = boundary[7].is_active = false;
 	}
-	boundary.push_back(temp_boundary);
-	temp_boundary.Delete();
-// 5 bot left corner
-	temp_boundary.this_node_id = node_id;
-	temp_boundary.that_node_id = list_of_node[(idx-1+npx)%npx][(idy-1+npy)%npy]; // The down left node id. Periodic transformation is applied.
-	if (idx == 0 || idy == 0)
-		temp_boundary.box_edge = true;
-	temp_boundary.this_cell.push_back(&cell[head_cell_idx][head_cell_idy]);
-	temp_boundary.that_cell.push_back(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(head_cell_idy-1+divisor_y) % divisor_y]);
-	boundary.push_back(temp_boundary);
-	temp_boundary.Delete();
-// 6 bot edge
-	temp_boundary.this_node_id = node_id;
-	temp_boundary.that_node_id = list_of_node[idx][(idy-1+npy)%npy]; // The down node id. Periodic transformation is applied.
-	if (idy == 0)
-		temp_boundary.box_edge = true;
-	for (int x = head_cell_idx; x < tail_cell_idx; x++)
+	if (npy == 1)
 	{
-		temp_boundary.this_cell.push_back(&cell[x][head_cell_idy]);
-		temp_boundary.that_cell.push_back(&cell[x][(head_cell_idy-1+divisor_y)%divisor_y]);
+		boundary[2].is_active = boundary[6].is_active = false;
+		boundary[1].is_active = boundary[3].is_active = boundary[5].is_active = boundary[7].is_active = false;
 	}
-	boundary.push_back(temp_boundary);
-	temp_boundary.Delete();
-// 7 bot right corner
-	temp_boundary.this_node_id = node_id;
-	temp_boundary.that_node_id = list_of_node[(idx+1)%npx][(idy-1+npy)%npy]; // The douwn right node id. Periodic transformation is applied.
-	if (idx == npx || idy == 0)
-		temp_boundary.box_edge = true;
-	temp_boundary.this_cell.push_back(&cell[tail_cell_idx-1][head_cell_idy]);
-	temp_boundary.that_cell.push_back(&cell[tail_cell_idx % divisor_x][(head_cell_idy-1+divisor_y) % divisor_y]);
-	boundary.push_back(temp_boundary);
-	temp_boundary.Delete();
-// Assigning a uniqe tag to each boundary. The same boundary of different nodes must have the same tag.
+	#ifdef SHARED_MEMORY_HALO
+		Init_Shared_Memory();
+	#endif
+	MPI_Barrier(comm);
+// All nodes are ready
+}
+
+void Node::Init_Shared_Memory()
+{
+	if (shared_comm == MPI_COMM_NULL)
+		MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, node_id, MPI_INFO_NULL, &shared_comm);
+	int shared_size;
+	MPI_Comm_size(shared_comm, &shared_size);
+	if (shared_size == 1) // A node alone on its computer sends messages as before.
+		return;
+// All nodes of shared_comm have the same box, so they all free and allocate the window together.
+	if (shared_window != MPI_WIN_NULL && N > shared_N)
+		MPI_Win_free(&shared_window);
+	if (shared_window == MPI_WIN_NULL)
+	{
+		MPI_Win_allocate_shared(2*3*N*sizeof(Real), sizeof(Real), MPI_INFO_NULL, shared_comm, &shared_data, &shared_window);
+		shared_N = N;
+	}
+
+// The rank of each neighbor in shared_comm. If it is not on this computer it is MPI_UNDEFINED.
+	MPI_Group group, shared_group;
+	MPI_Comm_group(comm, &group);
+	MPI_Comm_group(shared_comm, &shared_group);
 	for (int i = 0; i < boundary.size(); i++)
 	{
-		if (boundary[i].this_node_id < boundary[i].that_node_id)
+		boundary[i].shared_data = NULL;
+		if (!boundary[i].is_active)
+			continue;
+		int shared_rank;
+		MPI_Group_translate_ranks(group, 1, &boundary[i].that_node_id, shared_group, &shared_rank);
+		if (shared_rank != MPI_UNDEFINED)
 		{
-			#ifdef PERIODIC_BOUNDARY_CONDITION
-				boundary[i].tag = 0*boundary[i].box_edge*total_nodes*total_nodes + boundary[i].this_node_id*total_nodes + boundary[i].that_node_id;
-			#else
-				boundary[i].tag = boundary[i].this_node_id*total_nodes + boundary[i].that_node_id;
-			#endif
-		}
-		else
-		{
-			#ifdef PERIODIC_BOUNDARY_CONDITION
-				boundary[i].tag = 0*boundary[i].box_edge*total_nodes*total_nodes + boundary[i].that_node_id*total_nodes + boundary[i].this_node_id;
-			#else
-				boundary[i].tag = boundary[i].that_node_id*total_nodes + boundary[i].this_node_id;
-			#endif
+			MPI_Aint size;
+			int unit;
+			MPI_Win_shared_query(shared_window, shared_rank, &size, &unit, &boundary[i].shared_data);
 		}
 	}
-// Reforming boundaries in accord to the bondary condition.
-	#ifndef PERIODIC_BOUNDARY_CONDITION
-// Here the boundaries of edge nodes are removed:
-	if (idx == (npx-1)) // The rightmost nodes
-		if ((idy != 0) && (idy != npy-1)) // The nodes that are not at the corners (top and bot).
-		{
-// The erase must be from the last element, to avoid lable changes and a correct delletion for other boundaries
-			boundary[7].is_active = false; // down right
-			boundary[1].is_active = false; // up right
-			boundary[0].is_active = false; // right
-		}
-
-	if (idx == 0) // The leftmost node
-		if ((idy != 0) && (idy != npy-1)) // The nodes that are not at the corners (top and bot).
-		{
-			boundary[5].is_active = false; // down left
-			boundary[4].is_active = false; // left
-			boundary[3].is_active = false; // up left
-		}
-
-	if (idy == (npy-1)) // The top nodes
-		if ((idx != 0) && (idx != npx-1)) // The nodes that are not at the corners (left and right).
-		{
-			boundary[3].is_active = false; // up left
-			boundary[2].is_active = false; // up
-			boundary[1].is_active = false; // up right
-		}
-
-
-	if (idy == 0) // The bottum nodes
-		if ((idx != 0) && (idx != npx-1)) // The nodes that are not at the corners (left and right).
-		{
-			boundary[7].is_active = false; // down right
-			boundary[6].is_active = false; // down
-			boundary[5].is_active = false; // down left
-		}
-
-// Here the boundaries of corner nodes are removed:
-	if (idx == 0) // The leftmost
-		if (idy == 0) // The bottum
-		{
-			boundary[7].is_active = false;
-			boundary[6].is_active = false;
-			boundary[5].is_active = false;
-			boundary[4].is_active = false;
-			boundary[3].is_active = false;
-		}
-	if (idx == npx-1) // The rightmost
-		if (idy == 0) // The bottum
-		{
-			boundary[7].is_active = false;
-			boundary[6].is_active = false;
-			boundary[5].is_active = false;
-			boundary[1].is_active = false;
-			boundary[0].is_active = false;
-		}
-	if (idx == npx-1) // The rightmost
-		if (idy == npy-1) // The top
-		{
-			boundary[7].is_active = false;
-			boundary[3].is_active = false;
-			boundary[2].is_active = false;
-			boundary[1].is_active = false;
-			boundary[0].is_active = false;
-		}
-	if (idx == 0) // The leftmost
-		if (idy == npy-1) // The top
-		{
-			boundary[5].is_active = false;
-			boundary[4].is_active = false;
-			boundary[3].is_active = false;
-			boundary[2].is_active = false;
-			boundary[1].is_active = false;
-		}
-	#endif
-	MPI_Barrier(MPI_COMM_WORLD);
-// All nodes are ready
+	MPI_Group_free(&group);
+	MPI_Group_free(&shared_group);
 }
 
 // Send_Receive_Data will update boundary cells of each node with its neighboring nodes
-// each node sends its information of boundary cells to the correspounding node.
-void Node::Send_Receive_Data()
+// each node sends its information of boundary cells to the correspounding node. All the receives and sends are non-blocking and they are posted together, so there is no dead lock for any grid of nodes.
+// The neighbors on the same computer read the data from the shared memory of thisnode after a fence. The shared data is always exact.
+void Node::Send_Receive_Data(bool exact)
 {
+	bool compact = compact_halo && !exact;
+	Real* this_shared = shared_data + 3*N*shared_parity;
+	vector<MPI_Request> request;
 	for (int i = 0; i < boundary.size(); i++)
-	{
-		if (i % 4 != 2)
+		if (boundary[i].is_active && !boundary[i].shared_data)
+			boundary[i].Receive_Data(request, compact); // Receive information of the neighboring node that shares i'th boundary.
+	for (int i = 0; i < boundary.size(); i++)
+		if (boundary[i].is_active)
 		{
-			if (idx % 2 == 0)
-			{
-				if (boundary[i].is_active)
-					boundary[i].Send_Data(); // Send information of i'th boundary of thisnode to the neighboring node that shares this boundary.
-			}
-			else
-				if (boundary[(i+4)%8].is_active)
-					boundary[(i+4)%8].Receive_Data(); // Receive information of i'th boundary of neighboring node.
-			if (idx % 2 == 1)
-			{
-				if (boundary[i].is_active)
-					boundary[i].Send_Data(); // Send information of i'th boundary of thisnode to the neighboring node that shares this boundary (if there is any).
-			}
+			if (boundary[i].shared_data)
+				boundary[i].Write_Shared(this_shared);
 			else
-				if (boundary[(i+4)%8].is_active)
-					boundary[(i+4)%8].Receive_Data(); // Receive information of i'th boundary of neighboring node (if the neighbor exitst).
+				boundary[i].Send_Data(request, compact); // Send information of i'th boundary of thisnode to the neighboring node that shares this boundary.
 		}
-		else
+	if (shared_window != MPI_WIN_NULL)
+		MPI_Win_fence(0, shared_window); // All nodes of this computer have written their data.
+	MPI_Waitall(request.size(), request.data(), MPI_STATUSES_IGNORE);
+	for (int i = 0; i < boundary.size(); i++)
+		if (boundary[i].is_active)
 		{
-			if (idy % 2 == 0)
-			{
-				if (boundary[i].is_active)
-					boundary[i].Send_Data(); // Send information of i'th boundary of thisnode to the neighboring node that shares this boundary (if there is any).
-			}
-			else
-				if (boundary[(i+4)%8].is_active)
-					boundary[(i+4)%8].Receive_Data(); // Receive information of i'th boundary of neighboring node (if the neighbor exitst).
-			if (idy % 2 == 1)
-			{
-				if (boundary[i].is_active)
-					boundary[i].Send_Data(); // Send information of i'th boundary of thisnode to the neighboring node that shares this boundary (if there is any).
-			}
+			if (boundary[i].shared_data)
+				boundary[i].Read_Shared(boundary[i].shared_data + 3*N*shared_parity);
 			else
-				if (boundary[(i+4)%8].is_active)
-					boundary[(i+4)%8].Receive_Data(); // Receive information of i'th boundary of neighboring node (if the neighbor exitst).
+				boundary[i].Unpack_Data(compact);
 		}
-		MPI_Barrier(MPI_COMM_WORLD);
-	}
+	shared_parity = 1 - shared_parity;
 }
 
-// Quick_Update_Cells will update cells of each node (their particle) with the local information that means we have only information about particle position of thisnode and the boundary cells. This must be quicker than usage of the global information with a gather and bcast. Here neighobr list of each particle is computed as well.
-void Node::Quick_Update_Cells()
+// The tangent vectors are always sent by messages, the shared memory only has x, y and theta.
+void Node::Send_Receive_Tangent()
 {
-	Send_Receive_Data();
-	MPI_Barrier(MPI_COMM_WORLD);
+	vector<MPI_Request> request;
+	for (int i = 0; i < boundary.size(); i++)
+		if (boundary[i].is_active)
+			boundary[i].Receive_Tangent(request);
+	for (int i = 0; i < boundary.size(); i++)
+		if (boundary[i].is_active)
+			boundary[i].Send_Tangent(request);
+	MPI_Waitall(request.size(), request.data(), MPI_STATUSES_IGNORE);
+	for (int i = 0; i < boundary.size(); i++)
+		if (boundary[i].is_active)
+			boundary[i].Unpack_Tangent();
+}
 
-	vector<int> node_pid; // pid is particle ids that possibly are within this node
+// The cell update is done by two rounds of messages, the migrants and then the ghosts. The receiver finds the size of each message by a probe. All sends are posted before the receives, so there is no dead lock.
+void Node::Exchange_Migrants(vector<int>& immigrant)
+{
+	vector<MPI_Request> request;
+	for (int i = 0; i < boundary.size(); i++)
+		if (boundary[i].is_active)
+			boundary[i].Send_Migrants(request);
+	for (int i = 0; i < boundary.size(); i++)
+		if (boundary[i].is_active)
+			boundary[i].Receive_Migrants(immigrant);
+	MPI_Waitall(request.size(), request.data(), MPI_STATUSES_IGNORE);
+}
 
-// First we add particles in the neighboring cells which are not within the node. These particles may travell inside thisnode and we add them to the list of possible particles (node_pid). thisnode has a list of boundaries (right, top right, ...) and in the list of boundaries we have pointer to cells that belong to thisnode (this_cell) or to the neighobring node (that_cell). Here we only add that_cell particle ids because in future we will add all thisnode particles.
+// Exchange_Ghosts tells the neighboring nodes which particles are in the cells of thisnode at the boundaries and where they are.
+void Node::Exchange_Ghosts()
+{
+	vector<MPI_Request> request;
 	for (int i = 0; i < boundary.size(); i++)
-		for (int j = 0; j < boundary[i].that_cell.size(); j++)
-		{
-			for (int k = 0; k < boundary[i].that_cell[j]->pid.size(); k++)
-				node_pid.push_back(boundary[i].that_cell[j]->pid[k]);
-		}
+		if (boundary[i].is_active)
+			boundary[i].Send_Ghosts(request);
+	for (int i = 0; i < boundary.size(); i++)
+		if (boundary[i].is_active)
+			boundary[i].Receive_Ghosts();
+	MPI_Waitall(request.size(), request.data(), MPI_STATUSES_IGNORE);
+}
+
+// Quick_Update_Cells will update cells of each node (their particle) with the local information that means we have only information about particle position of thisnode and the boundary cells. This must be quicker than usage of the global information with a gather and bcast. Here neighobr list of each particle is computed as well.
+void Node::Quick_Update_Cells()
+{
+	vector<int> node_pid; // pid is particle ids that are within this node
+
+// Cells of the neighboring nodes are emptied, the neighboring nodes will send their new particles. thisnode has a list of boundaries (right, top right, ...) and in the list of boundaries we have pointer to cells that belong to thisnode (this_cell) or to the neighobring node (that_cell).
+// Inactive boundaries are skipped, their that_cells are either outside of a closed box or cells of thisnode.
 	for (int i = 0; i < boundary.size(); i++)
-		for (int j = 0; j < boundary[i].that_cell.size(); j++)
-			boundary[i].that_cell[j]->Delete();
-			
+		if (boundary[i].is_active)
+			for (int j = 0; j < boundary[i].that_cell.size(); j++)
+				boundary[i].that_cell[j]->Delete();
 
-// In this part we go over all cells of thisnode (the first two for) and add particle of each cell to the node_pid (particle ids that may be inside thisnode). Here I also delete each cell, because I will add particles in the node_pid to the cell the cell must be empty to avoid repeatation of particles list in a cell.
+// In this part we go over all cells of thisnode (the first two for) and add particle of each cell to the node_pid. Here I also delete each cell, because I will add particles in the node_pid to the cell the cell must be empty to avoid repeatation of particles list in a cell.
 	for (int x = head_cell_idx; x < tail_cell_idx; x++)
 		for (int y = head_cell_idy; y < tail_cell_idy; y++)
 		{
@@ -383,90 +424,52 @@ void Node::Quick_Update_Cells()
 			cell[x][y].Delete();
 		}
 
-// Here the program checks each particle in node_pid. If the particle position is in a cell which belongs to thisnode, the program will add them to the list. It is very important that information about particles of neighboring cells must be up to date. For example this function must be used after an interaction computation to make sure that recently such an update has been occured.
-	for (int i = 0; i < node_pid.size(); i++)
+// Here the program puts each particle of thisnode in the cell of its position. The positions of thisnode particles are exact, the particles that moved out of thisnode go to that_cells and are sent to their new node.
+	Add_To_Cells(node_pid);
+
+// We don't need node_pid anymore and we need it to be empty for our further use.
+	node_pid.clear();
+
+// The particles that moved out of thisnode are sent to their new node, and the ones that moved in are added to the cells. A particle can not move more than one cell, so the immigrants are in the cells of thisnode.
+	Exchange_Migrants(node_pid);
+	Add_To_Cells(node_pid);
+
+// Now particle indices are changed and we have to update information of boundaries. The particles of other nodes that are at boundaries
+	Exchange_Ghosts();
+}
+
+// Add particles to the cell that they are inside. Finding the cells is done by threads, but adding to the cells is done by one thread to keep the order of particles in each cell (that makes the results independent of number of threads).
+void Node::Add_To_Cells(vector<int>& pid)
+{
+	vector<int> cell_x(pid.size()), cell_y(pid.size());
+	#pragma omp parallel for
+	for (int i = 0; i < pid.size(); i++)
 	{
 // Find the index of the cell in which a particle are located.
-		int x,y;
-		x = (int) (particle[node_pid[i]].r.x + Lx)*divisor_x / Lx2;
-		y = (int) (particle[node_pid[i]].r.y + Ly)*divisor_y / Ly2;
+		cell_x[i] = Cell_X(particle[pid[i]].r.x);
+		cell_y[i] = Cell_Y(particle[pid[i]].r.y);
+	}
 
+	for (int i = 0; i < pid.size(); i++)
+	{
+		int x = cell_x[i];
+		int y = cell_y[i];
 // Check if the particles are inside the box for a debug.
 		#ifdef DEBUG
 		if ((x >= divisor_x) || (x < 0) || (y >= divisor_y) || (y < 0))
 		{
-			cout << "\n Particle number " << node_pid[i] << " is Out of the box" << endl << flush;
-			cout << "Particle Position is " << particle[node_pid[i]].r << endl;
-			cout << "Particle  " << particle[node_pid[i]].v << endl;
+			cout << "\n Particle number " << pid[i] << " is Out of the box" << endl << flush;
+			cout << "Particle Position is " << particle[pid[i]].r << endl;
+			cout << "Particle  " << particle[pid[i]].v << endl;
 			exit(0);
 		}
 		#endif
 
-		#ifdef TRACK_PARTICLE
-//			if (node_pid[i] == track)
-//				if ((head_cell_idx <= x) && (x < tail_cell_idx))
-//					if ((head_cell_idy <=  y)&& (y < tail_cell_idy))
-//						if (flag)
-//							cout << "Node: " << node_id << " Cell: " << x << " " << y << " " << particle[track].r << " " << particle[track].theta << endl << flush;
-		#endif
-		
-		cell[x][y].Add(node_pid[i]);
+		cell[x][y].Add(pid[i]);
 	}
-
-// We don't need node_pid anymore and we need it to be empty for our further use.
-	node_pid.clear();
-
-
-// Now particle indices are changed and we have to update information of boundaries. The particles of other nodes that are at boundaries
-	MPI_Barrier(MPI_COMM_WORLD);
-
-	for (int i = 0; i < boundary.size(); i++)
-	{
-		if (i % 4 != 2)
-		{
-			if (idx % 2 == 0)
-			{
-				if (boundary[i].is_active)
-					boundary[i].Send_Particle_Ids(); // Send information of i'th boundary of thisnode to the neighboring node that shares this boundary.
-			}
-			else
-				if (boundary[(i+4)%8].is_active)
-					boundary[(i+4)%8].Receive_Particle_Ids(); // Receive information of i'th boundary of neighboring node.
-			if (idx % 2 == 1)
-			{
-				if (boundary[i].is_active)
-					boundary[i].Send_Particle_Ids(); // Send information of i'th boundary of thisnode to the neighboring node that shares this boundary (if there is any).
-			}
-			else
-				if (boundary[(i+4)%8].is_active)
-					boundary[(i+4)%8].Receive_Particle_Ids(); // Receive information of i'th boundary of neighboring node (if the neighbor exitst).
-		}
-		else
-		{
-			if (idy % 2 == 0)
-			{
-				if (boundary[i].is_active)
-					boundary[i].Send_Particle_Ids(); // Send information of i'th boundary of thisnode to the neighboring node that shares this boundary (if there is any).
-			}
-			else
-				if (boundary[(i+4)%8].is_active)
-					boundary[(i+4)%8].Receive_Particle_Ids(); // Receive information of i'th boundary of neighboring node (if the neighbor exitst).
-			if (idy % 2 == 1)
-			{
-				if (boundary[i].is_active)
-					boundary[i].Send_Particle_Ids(); // Send information of i'th boundary of thisnode to the neighboring node that shares this boundary (if there is any).
-			}
-			else
-				if (boundary[(i+4)%8].is_active)
-					boundary[(i+4)%8].Receive_Particle_Ids(); // Receive information of i'th boundary of neighboring node (if the neighbor exitst).
-		}
-		MPI_Barrier(MPI_COMM_WORLD);
-	}
-
-	MPI_Barrier(MPI_COMM_WORLD);
 }
 
-// Full_Update_Cells will update cells of each node (their particle) with the global information that means the master node will gather information of all other nodes and broadcast the whole information to every nodes. Therefor each node has the information of any other node and is aware of all particles. After we check all particles to see to which cell they belong.
+// Full_Update_Cells will update cells of each node (their particle) with the global information. It does no gather or broadcast itself, the caller gives every node the positions of all particles (Root_Bcast after Root_Gather, or a state that all nodes loaded). Each node puts all particles in their cells, so every cell of the box is filled, and then the ghosts of the neighboring nodes are replaced by Exchange_Ghosts: each node posts non-blocking sends of the ids and data of the particles near the edge of its boundary cells, receives the ones of its neighbors into their that_cells and waits for its sends.
 void Node::Full_Update_Cells()
 {
 // First we need to empty the cells from our particle ids. (To avoid degeneracies!)
@@ -474,223 +477,149 @@ void Node::Full_Update_Cells()
 		for (int y = 0; y < divisor_y; y++)
 			cell[x][y].Delete();
 
+	vector<int> all_pid(N);
 	for (int i = 0; i < N; i++)
-	{
-// Find the index of the cell in which a particle are located.
-		int x,y;
-		x = (int) (particle[i].r.x + Lx)*divisor_x / Lx2;
-		y = (int) (particle[i].r.y + Ly)*divisor_y / Ly2;
+		all_pid[i] = i;
+	Add_To_Cells(all_pid);
 
-// Check if the particles are inside the box for a debug.
-		#ifdef DEBUG
-		if ((x >= divisor_x) || (x < 0) || (y >= divisor_y) || (y < 0))
-		{
-			cout << "\n Particle number " << i << " is Out of the box" << endl << flush;
-			cout << "Particle Position is " << particle[i].r << endl;
-			exit(0);
-		}
-		#endif
-
-		cell[x][y].Add(i);
+// A particle may change its node, its forces and torques as a ghost of the new node are not valid.
+	for (int i = 0; i < N; i++)
+	{
+		particle[i].Reset();
+		if (Tangent::num)
+			Tangent::Reset(i);
 	}
+
+// Neighboring nodes only keep the particles of boundary cells that are near the edge.
+	Exchange_Ghosts();
 }
 
-// Using the information of particles we update a list for each particle showing the neighboring particles. But we are considering the third newton law. That means particles within the same node are counted once as neighbor in the neighbor list of one of the two particles.
-void Node::Update_Self_Neighbor_List()
+// Init_Cells is like Full_Update_Cells but each node only knows its own particles, that is enough for the first step.
+void Node::Init_Cells(vector<int>& pid)
 {
-// Each cell must interact with itself and 4 of its 8 neihbors that are right cell, up cell, righ up and right down. Because each intertion compute the torque to both particles we need to use 4 of the 8 directions.
+	for (int x = 0; x < divisor_x; x++)
+		for (int y = 0; y < divisor_y; y++)
+			cell[x][y].Delete();
+	Add_To_Cells(pid);
+	Exchange_Ghosts();
+}
 
-// Self interaction
+void Node::Sort_Cells()
+{
 	for (int x = head_cell_idx; x < tail_cell_idx; x++)
 		for (int y = head_cell_idy; y < tail_cell_idy; y++)
-			cell[x][y].Neighbor_List();
-// right, up and up right cells:
-// The righmost cells and top cells must be excluded to avoid nieghbor node interactions.
-	for (int x = head_cell_idx; x < (tail_cell_idx-1); x++)
-		for (int y = head_cell_idy; y < (tail_cell_idy-1); y++)
-		{
-// No need for % divisor_x and % divisor_y because we are only considering interaction of cells inside thisnode.
-			cell[x][y].Neighbor_List(&cell[x+1][y]);
-			cell[x][y].Neighbor_List(&cell[x][y+1]);
-			cell[x][y].Neighbor_List(&cell[x+1][y+1]);
-		}
-
-// The rest that I forgot:
-	for (int x = head_cell_idx; x < (tail_cell_idx-1); x++)
-		cell[x][tail_cell_idy-1].Neighbor_List(&cell[x+1][tail_cell_idy-1]);
-	for (int y = head_cell_idy; y < (tail_cell_idy-1); y++)
-		cell[tail_cell_idx-1][y].Neighbor_List(&cell[tail_cell_idx-1][y+1]);
-
-// right down cell:
-// The righmost cells and buttom cells must be excluded to avoid nieghbor node interactions.
-	for (int x = head_cell_idx; x < (tail_cell_idx-1); x++)
-		for (int y = head_cell_idy+1; y < (tail_cell_idy); y++)
-			cell[x][y].Neighbor_List(&cell[x+1][y-1]);	
+			sort(cell[x][y].pid.begin(), cell[x][y].pid.end());
+	Exchange_Ghosts();
 }
 
-// Interaction of thisnode particles with particles outside of thisnode
-void Node::Update_Boundary_Neighbor_List()
+// Finding the neighbor (nx,ny) of cell (x,y) in direction d (labelled like boundaries). It returns false if there is no such cell (outside of a closed box).
+bool Node::Neighbor_Cell(int x, int y, int d, int& nx, int& ny)
 {
+	nx = x + neighbor_dx[d];
+	ny = y + neighbor_dy[d];
 	#ifdef PERIODIC_BOUNDARY_CONDITION
-// The first and last columns are excluded to avoid multiple interaction for the same pair of cells
-	for (int x = (head_cell_idx+1); x < (tail_cell_idx-1); x++)
-	{
-// Buttom cells of thisnode interacting
-		cell[x][head_cell_idy].Neighbor_List(&cell[x][(head_cell_idy-1+divisor_y)%divisor_y]);
-		cell[x][head_cell_idy].Neighbor_List(&cell[(x+1)%divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]);
-		cell[x][head_cell_idy].Neighbor_List(&cell[(x-1+divisor_x)%divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]);
-
-// Top cells of thisnode interacting
-		cell[x][tail_cell_idy-1].Neighbor_List(&cell[x][tail_cell_idy%divisor_y]);
-		cell[x][tail_cell_idy-1].Neighbor_List(&cell[(x+1)%divisor_x][tail_cell_idy%divisor_y]);
-		cell[x][tail_cell_idy-1].Neighbor_List(&cell[(x-1+divisor_x)%divisor_x][tail_cell_idy%divisor_y]);
-	}
+		nx = (nx + divisor_x) % divisor_x;
+		ny = (ny + divisor_y) % divisor_y;
+	#else
+		if (nx < 0 || nx >= divisor_x || ny < 0 || ny >= divisor_y)
+			return false;
+	#endif
+	return true;
+}
 
-// The first and last rows are excluded to avoid multiple interaction for the same pair of cells
-	for (int y = (head_cell_idy+1); y < (tail_cell_idy-1); y++)
-	{
-// Left cells of this node
-		cell[head_cell_idx][y].Neighbor_List(&cell[(head_cell_idx-1+divisor_x) % divisor_x][y]);
-		cell[head_cell_idx][y].Neighbor_List(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(y+1)%divisor_y]);
-		cell[head_cell_idx][y].Neighbor_List(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(y-1+divisor_y)%divisor_y]);
-
-// Right cells of this node
-		cell[tail_cell_idx-1][y].Neighbor_List(&cell[tail_cell_idx % divisor_x][y]);
-		cell[tail_cell_idx-1][y].Neighbor_List(&cell[tail_cell_idx % divisor_x][(y+1)%divisor_y]);
-		cell[tail_cell_idx-1][y].Neighbor_List(&cell[tail_cell_idx % divisor_x][(y-1+divisor_y)%divisor_y]);
-	}
+int Node::Cell_X(Real x)
+{
+	return ((int) (x + Lx)*divisor_x / Lx2);
+}
 
-// Interaction of corners:
-// Left Buttom:
-	cell[head_cell_idx][head_cell_idy].Neighbor_List(&cell[(head_cell_idx+1)%divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]); // 7
-	cell[head_cell_idx][head_cell_idy].Neighbor_List(&cell[head_cell_idx][(head_cell_idy-1+divisor_y)%divisor_y]); // 6
-	cell[head_cell_idx][head_cell_idy].Neighbor_List(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]); // 5
-	cell[head_cell_idx][head_cell_idy].Neighbor_List(&cell[(head_cell_idx-1+divisor_x) % divisor_x][head_cell_idy]); // 4
-	cell[head_cell_idx][head_cell_idy].Neighbor_List(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(head_cell_idy+1)%divisor_y]); // 3
-// Left Top:
-	cell[head_cell_idx][(tail_cell_idy-1+divisor_y)%divisor_y].Neighbor_List(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(tail_cell_idy-2+divisor_y)%divisor_y]); // 5
-	cell[head_cell_idx][(tail_cell_idy-1+divisor_y)%divisor_y].Neighbor_List(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(tail_cell_idy-1+divisor_y)%divisor_y]); // 4
-	cell[head_cell_idx][(tail_cell_idy-1+divisor_y)%divisor_y].Neighbor_List(&cell[(head_cell_idx-1+divisor_x) % divisor_x][tail_cell_idy%divisor_y]); // 3
-	cell[head_cell_idx][(tail_cell_idy-1+divisor_y)%divisor_y].Neighbor_List(&cell[head_cell_idx][tail_cell_idy%divisor_y]); // 2
-	cell[head_cell_idx][(tail_cell_idy-1+divisor_y)%divisor_y].Neighbor_List(&cell[(head_cell_idx+1)%divisor_x][tail_cell_idy%divisor_y]); // 1
-// Right Top:
-	cell[tail_cell_idx-1][tail_cell_idy-1].Neighbor_List(&cell[(tail_cell_idx-2+divisor_x)%divisor_x][tail_cell_idy%divisor_y]); // 3
-	cell[tail_cell_idx-1][tail_cell_idy-1].Neighbor_List(&cell[tail_cell_idx-1][tail_cell_idy%divisor_y]); // 2
-	cell[tail_cell_idx-1][tail_cell_idy-1].Neighbor_List(&cell[tail_cell_idx % divisor_x][tail_cell_idy%divisor_y]); // 1
-	cell[tail_cell_idx-1][tail_cell_idy-1].Neighbor_List(&cell[tail_cell_idx % divisor_x][tail_cell_idy-1]); // 0
-	cell[tail_cell_idx-1][tail_cell_idy-1].Neighbor_List(&cell[tail_cell_idx % divisor_x][(tail_cell_idy-2+divisor_y)%divisor_y]); // 7
-// Right Buttom:
-	cell[tail_cell_idx-1][head_cell_idy].Neighbor_List(&cell[tail_cell_idx % divisor_x][(head_cell_idy+1)%divisor_y]); // 1
-	cell[tail_cell_idx-1][head_cell_idy].Neighbor_List(&cell[tail_cell_idx % divisor_x][head_cell_idy]); // 0
-	cell[tail_cell_idx-1][head_cell_idy].Neighbor_List(&cell[tail_cell_idx % divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]); // 7
-	cell[tail_cell_idx-1][head_cell_idy].Neighbor_List(&cell[tail_cell_idx-1][(head_cell_idy-1+divisor_y)%divisor_y]); // 6
-	cell[tail_cell_idx-1][head_cell_idy].Neighbor_List(&cell[(tail_cell_idx-2+divisor_x)%divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]); // 5
-	#else
-// In future I'm going to remove the if conditions for a better performance
+int Node::Cell_Y(Real y)
+{
+	return ((int) (y + Ly)*divisor_y / Ly2);
+}
 
+// Cell_X does not divide the box to equal columns (the integer part of x+Lx is used). The edge is found by bisection to be the same as Cell_X.
+Real Node::Edge_X(int i)
+{
+	Real a = -Lx, b = Lx;
+	if (i <= 0)
+		return (a);
+	if (i >= divisor_x)
+		return (b);
+	for (int k = 0; k < 60; k++)
+	{
+		Real c = (a + b) / 2;
+		if (Cell_X(c) < i)
+			a = c;
+		else
+			b = c;
+	}
+	return (b);
+}
 
-// Right cells of thisnode interacting
-	if (tail_cell_idx != divisor_x)
-		for (int y = (head_cell_idy+1); y < (tail_cell_idy-1); y++) // The first and last rows are excluded to avoid multiple interaction for the same pair of cells
-		{
-			cell[tail_cell_idx-1][y].Neighbor_List(&cell[tail_cell_idx][y]);
-			cell[tail_cell_idx-1][y].Neighbor_List(&cell[tail_cell_idx][y+1]);
-			cell[tail_cell_idx-1][y].Neighbor_List(&cell[tail_cell_idx][y-1]);
-		}
+Real Node::Edge_Y(int i)
+{
+	Real a = -Ly, b = Ly;
+	if (i <= 0)
+		return (a);
+	if (i >= divisor_y)
+		return (b);
+	for (int k = 0; k < 60; k++)
+	{
+		Real c = (a + b) / 2;
+		if (Cell_Y(c) < i)
+			a = c;
+		else
+			b = c;
+	}
+	return (b);
+}
 
-// Top cells of thisnode interacting
-	if (tail_cell_idy != divisor_y) // If tail_cell y cordinate is not at the top
-		for (int x = (head_cell_idx+1); x < (tail_cell_idx-1); x++) // The first and last columns are excluded to avoid multiple interaction for the same pair of cells
-		{
-			cell[x][tail_cell_idy-1].Neighbor_List(&cell[x][tail_cell_idy]);
-			cell[x][tail_cell_idy-1].Neighbor_List(&cell[x+1][tail_cell_idy]);
-			cell[x][tail_cell_idy-1].Neighbor_List(&cell[x-1][tail_cell_idy]);
-		}
+// Check if cell (x,y) belongs to thisnode.
+bool Node::Is_Own_Cell(int x, int y)
+{
+	return ((head_cell_idx <= x) && (x < tail_cell_idx) && (head_cell_idy <= y) && (y < tail_cell_idy));
+}
 
-// Left cells of thisnode interacting
-	if (head_cell_idx != 0)
-		for (int y = (head_cell_idy+1); y < (tail_cell_idy-1); y++) // The first and last rows are excluded to avoid multiple interaction for the same pair of cells
+// Using the information of particles we update a list for each particle showing the neighboring particles. But we are considering the third newton law. That means particles within the same node are counted once as neighbor in the neighbor list of one of the two particles.
+void Node::Update_Self_Neighbor_List(Real radius)
+{
+// Each cell must interact with itself and 4 of its 8 neihbors that are right cell, up cell, righ up and right down (0, 1, 2 and 7). Because each intertion compute the torque to both particles we need to use 4 of the 8 directions. Neighbors of the other nodes are excluded. With one column (row) of nodes the neighbor might be a cell of thisnode through the periodic boundary, it is included like the serial program.
+// Neighbor_List of a cell only changes the particles of the cell, so cells are divided between threads.
+	#pragma omp parallel for collapse(2) schedule(dynamic)
+	for (int x = head_cell_idx; x < tail_cell_idx; x++)
+		for (int y = head_cell_idy; y < tail_cell_idy; y++)
 		{
-			cell[head_cell_idx][y].Neighbor_List(&cell[head_cell_idx-1][y]);
-			cell[head_cell_idx][y].Neighbor_List(&cell[head_cell_idx-1][y+1]);
-			cell[head_cell_idx][y].Neighbor_List(&cell[head_cell_idx-1][y-1]);
+			int nx, ny;
+			cell[x][y].Neighbor_List(radius);
+			for (int d = 0; d < 8; d++)
+				if (d == 0 || d == 1 || d == 2 || d == 7)
+					if (Neighbor_Cell(x, y, d, nx, ny) && Is_Own_Cell(nx, ny))
+						cell[x][y].Neighbor_List(&cell[nx][ny], radius);
 		}
+}
 
-// Buttom cells of thisnode interacting
-	if (head_cell_idy != 0) // If head_cell y cordinate is not at the bottom
-		for (int x = (head_cell_idx+1); x < (tail_cell_idx-1); x++) // The first and last columns are excluded to avoid multiple interaction for the same pair of cells
+// Interaction of thisnode particles with particles outside of thisnode. All 8 directions are needed because the neighboring node computes the torque of its own particles.
+void Node::Update_Boundary_Neighbor_List()
+{
+	#pragma omp parallel for collapse(2) schedule(dynamic)
+	for (int x = head_cell_idx; x < tail_cell_idx; x++)
+		for (int y = head_cell_idy; y < tail_cell_idy; y++)
 		{
-			cell[x][head_cell_idy].Neighbor_List(&cell[x][head_cell_idy-1]);
-			cell[x][head_cell_idy].Neighbor_List(&cell[x+1][head_cell_idy-1]);
-			cell[x][head_cell_idy].Neighbor_List(&cell[x-1][head_cell_idy-1]);
+			int nx, ny;
+			for (int d = 0; d < 8; d++)
+				if (Neighbor_Cell(x, y, d, nx, ny) && !Is_Own_Cell(nx, ny))
+					cell[x][y].Neighbor_List(&cell[nx][ny]);
 		}
-
-// Interaction of corners:
-// Left Buttom:
-	if (head_cell_idx != 0)
-	{
-		cell[head_cell_idx][head_cell_idy].Neighbor_List(&cell[head_cell_idx-1][head_cell_idy]); // left: Number 4
-		cell[head_cell_idx][head_cell_idy].Neighbor_List(&cell[head_cell_idx-1][head_cell_idy+1]); // up left: Number 3
-		if (head_cell_idy != 0)
-			cell[head_cell_idx][head_cell_idy].Neighbor_List(&cell[head_cell_idx-1][head_cell_idy-1]); // down left: Number 5
-	}
-	if (head_cell_idy != 0)
-	{
-		cell[head_cell_idx][head_cell_idy].Neighbor_List(&cell[head_cell_idx][head_cell_idy-1]); // down: Number 6
-		cell[head_cell_idx][head_cell_idy].Neighbor_List(&cell[head_cell_idx+1][head_cell_idy-1]); // down right: Number 7
-	}
-	
-// Left Top:
-	if (head_cell_idx != 0)
-	{
-		cell[head_cell_idx][tail_cell_idy-1].Neighbor_List(&cell[head_cell_idx-1][tail_cell_idy-1]); // left: Number 4
-		cell[head_cell_idx][tail_cell_idy-1].Neighbor_List(&cell[head_cell_idx-1][tail_cell_idy-2]); // down left: Number 5
-		if (tail_cell_idy != divisor_y)
-			cell[head_cell_idx][tail_cell_idy-1].Neighbor_List(&cell[head_cell_idx-1][tail_cell_idy]); // up left: Number 3
-	}
-	if (tail_cell_idy != divisor_y)
-	{
-		cell[head_cell_idx][tail_cell_idy-1].Neighbor_List(&cell[head_cell_idx][tail_cell_idy]); // up: Number 2
-		cell[head_cell_idx][tail_cell_idy-1].Neighbor_List(&cell[head_cell_idx+1][tail_cell_idy]); // up right: Number 1
-	}
-
-// Right Top:
-	if (tail_cell_idx != divisor_x)
-	{
-		cell[tail_cell_idx-1][tail_cell_idy-1].Neighbor_List(&cell[tail_cell_idx][tail_cell_idy-1]); // right: Number 0
-		cell[tail_cell_idx-1][tail_cell_idy-1].Neighbor_List(&cell[tail_cell_idx][tail_cell_idy-2]); // down right: Number 7
-		if (tail_cell_idy != divisor_y)
-			cell[tail_cell_idx-1][tail_cell_idy-1].Neighbor_List(&cell[tail_cell_idx][tail_cell_idy]); // up right: Number 1
-	}
-	if (tail_cell_idy != divisor_y)
-	{
-		cell[tail_cell_idx-1][tail_cell_idy-1].Neighbor_List(&cell[tail_cell_idx-1][tail_cell_idy]); // up: Number 2
-		cell[tail_cell_idx-1][tail_cell_idy-1].Neighbor_List(&cell[tail_cell_idx-2][tail_cell_idy]); // up left: Number 3
-	}
-
-// Right Buttom:
-	if (tail_cell_idx != divisor_x)
-	{
-		cell[tail_cell_idx-1][head_cell_idy].Neighbor_List(&cell[tail_cell_idx][head_cell_idy]); // right: Number 0
-		cell[tail_cell_idx-1][head_cell_idy].Neighbor_List(&cell[tail_cell_idx][head_cell_idy+1]); // up right: Number 1
-		if (head_cell_idy != 0)
-			cell[tail_cell_idx-1][head_cell_idy].Neighbor_List(&cell[tail_cell_idx][head_cell_idy-1]); // down right: Number 7
-	}
-	if (head_cell_idy != 0)
-	{
-		cell[tail_cell_idx-1][head_cell_idy].Neighbor_List(&cell[tail_cell_idx-1][head_cell_idy-1]); // down: Number 6
-		cell[tail_cell_idx-1][head_cell_idy].Neighbor_List(&cell[tail_cell_idx-2][head_cell_idy-1]); // down: Number 5
-	}
-	#endif
 }
 
 // This function must be called after transfer of data between nodes.
-void Node::Update_Neighbor_List()
+void Node::Update_Neighbor_List(Real self_radius)
 {
+	#pragma omp parallel for collapse(2)
 	for (int x = head_cell_idx; x < tail_cell_idx; x++)
 		for (int y = head_cell_idy; y < tail_cell_idy; y++)
 			cell[x][y].Clear_Neighbor_List();
-	Update_Self_Neighbor_List();
+	Update_Self_Neighbor_List(self_radius);
 	Update_Boundary_Neighbor_List();
 }
 
@@ -726,8 +655,8 @@ void Node::Send_To_Root()
 				}
 			}
 // tag_max is the maximum of the available tag value. tag_max-1 is for index and tag_max is for the data
-		MPI_Send(index_buffer, particle_count, MPI_INT, 0, tag_max-1,MPI_COMM_WORLD);
-		MPI_Send(data_buffer, 3*particle_count, MPI_DOUBLE, 0, tag_max,MPI_COMM_WORLD);
+		MPI_Send(index_buffer, particle_count, MPI_INT, 0, tag_max-1,world);
+		MPI_Send(data_buffer, 3*particle_count, MPI_DOUBLE, 0, tag_max,world);
 
 // Deallocation
 		delete [] index_buffer;
@@ -747,10 +676,10 @@ void Node::Root_Receive()
 		for (int i = 1; i < total_nodes; i++)
 		{
 			MPI_Status status;
-			MPI_Recv(index_buffer,N,MPI_INT,i,tag_max-1,MPI_COMM_WORLD,&status); // receiving the indices.
+			MPI_Recv(index_buffer,N,MPI_INT,i,tag_max-1,world,&status); // receiving the indices.
 			MPI_Get_count(&status, MPI_INT, &count); // Finding the number of indices that masternode received form node i.
 			data_buffer = new double[3*count]; // Initialize array with length 3*counts (3 double for each particle)
-			MPI_Recv(data_buffer,3*count,MPI_DOUBLE,i,tag_max,MPI_COMM_WORLD,&status); // receiving the data
+			MPI_Recv(data_buffer,3*count,MPI_DOUBLE,i,tag_max,world,&status); // receiving the data
 // Update each particle in according to the data that is received.
 			for (int j = 0; j < count; j++)
 			{
@@ -774,7 +703,7 @@ void Node::Root_Gather()
 	Send_To_Root(); // Sending information to master node.
 	Root_Receive(); // Receiving information by master node
 
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(world);
 }
 
 // Bcast send the information of every particles from the master node to other nodes. Perhaps befor a Bcast we may call Gather to have the correct information of all particles.
@@ -792,7 +721,7 @@ void Node::Root_Bcast()
 		}
 	}
 // Broad casting to all nodes. The root node is 0.
-	MPI_Bcast(data_buffer, 3*N, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	MPI_Bcast(data_buffer, 3*N, MPI_DOUBLE, 0, world);
 // Other nodes have to assign the received valuse to the particles. No index is needed because we sent the information of particles by their order.
 	if (node_id != 0)
 	{
@@ -806,213 +735,117 @@ void Node::Root_Bcast()
 		}
 	}
 	delete [] data_buffer;
-	MPI_Barrier(MPI_COMM_WORLD); // We want to make sure that all the nodes have the same information at the end (finished their task).
+	MPI_Barrier(world); // We want to make sure that all the nodes have the same information at the end (finished their task).
 }
 
-// Interaction of all particles within thisnode
+// Each node writes its own particles directly to the trajectory file. The place of a particle in the frame is known from its id, therefore no gather is needed and each node only deals with its N/total_nodes particles.
+void Node::Pack_Particles(vector<float>& data, vector<int>& displacement)
+{
+// MPI file views need increasing displacements, so we sort the particle ids of thisnode.
+	displacement.clear();
+	for (int x = head_cell_idx; x < tail_cell_idx; x++)
+		for (int y = head_cell_idy; y < tail_cell_idy; y++)
+			displacement.insert(displacement.end(), cell[x][y].pid.begin(), cell[x][y].pid.end());
+	sort(displacement.begin(), displacement.end());
+
+	int count = displacement.size();
+	data.resize(4*count);
+	for (int i = 0; i < count; i++)
+	{
+		const Particle& p = particle[displacement[i]];
+		data[4*i] = (float) p.r.x;
+		data[4*i+1] = (float) p.r.y;
+		data[4*i+2] = (float) cos(p.theta);
+		data[4*i+3] = (float) sin(p.theta);
+	}
+}
+
+// Interaction of all particles within thisnode. Interact of a cell changes the particles of the 8 neighboring cells as well (the third newton law), therefore threads can only work on cells that are at least 3 cells apart. The cells are divided to 9 groups by (x%3, y%3) and cells of each group are divided between threads. Each particle gets its interactions in the same order for any number of threads.
 void Node::Neighbor_List_Interact()
 {
-// Self interaction
+// If thisnode is the only node in a direction (npx == 1), the first and the last column are neighbors through the periodic boundary. The columns after the last multiple of 3 are done by one thread at the end to avoid conflicts.
+	int group_x = size_x;
+	int group_y = size_y;
+	#ifdef PERIODIC_BOUNDARY_CONDITION
+		if (npx == 1)
+			group_x -= size_x % 3;
+		if (npy == 1)
+			group_y -= size_y % 3;
+	#endif
+
+	for (int group = 0; group < 9; group++)
+	{
+		int x0 = head_cell_idx + group / 3;
+		int y0 = head_cell_idy + group % 3;
+		int nx = (group_x - group / 3 + 2) / 3; // number of columns in this group
+		int ny = (group_y - group % 3 + 2) / 3;
+		#pragma omp parallel for collapse(2) schedule(dynamic)
+		for (int i = 0; i < nx; i++)
+			for (int j = 0; j < ny; j++)
+				cell[x0 + 3*i][y0 + 3*j].Interact();
+	}
+
 	for (int x = head_cell_idx; x < tail_cell_idx; x++)
 		for (int y = head_cell_idy; y < tail_cell_idy; y++)
-			cell[x][y].Interact();
+			if ((x - head_cell_idx) >= group_x || (y - head_cell_idy) >= group_y)
+				cell[x][y].Interact();
 }
 
 // Interaction of all particles within thisnode
 void Node::Self_Interact()
 {
-// Each cell must interact with itself and 4 of its 8 neihbors that are right cell, up cell, righ up and right down. Because each intertion compute the torque to both particles we need to use 4 of the 8 directions.
-
-// Self interaction
+// Each cell must interact with itself and 4 of its 8 neihbors that are right cell, up cell, righ up and right down (0, 1, 2 and 7). Because each intertion compute the torque to both particles we need to use 4 of the 8 directions. Neighbors of the other nodes are excluded.
+	int nx, ny;
 	for (int x = head_cell_idx; x < tail_cell_idx; x++)
 		for (int y = head_cell_idy; y < tail_cell_idy; y++)
-			cell[x][y].Self_Interact();
-// right, up and up right cells:
-// The righmost cells and top cells must be excluded to avoid nieghbor node interactions.
-	for (int x = head_cell_idx; x < (tail_cell_idx-1); x++)
-		for (int y = head_cell_idy; y < (tail_cell_idy-1); y++)
 		{
-// No need for % divisor_x and % divisor_y because we are only considering interaction of cells inside thisnode.
-			cell[x][y].Interact(&cell[x+1][y]);
-			cell[x][y].Interact(&cell[x][y+1]);
-			cell[x][y].Interact(&cell[x+1][y+1]);
+			cell[x][y].Self_Interact();
+			for (int d = 0; d < 8; d++)
+				if (d == 0 || d == 1 || d == 2 || d == 7)
+					if (Neighbor_Cell(x, y, d, nx, ny) && Is_Own_Cell(nx, ny))
+						cell[x][y].Interact(&cell[nx][ny]);
 		}
-
-// The rest that I forgot:
-	for (int x = head_cell_idx; x < (tail_cell_idx-1); x++)
-		cell[x][tail_cell_idy-1].Interact(&cell[x+1][tail_cell_idy-1]);
-	for (int y = head_cell_idy; y < (tail_cell_idy-1); y++)
-		cell[tail_cell_idx-1][y].Interact(&cell[tail_cell_idx-1][y+1]);
-
-// right down cell:
-// The righmost cells and buttom cells must be excluded to avoid nieghbor node interactions.
-	for (int x = head_cell_idx; x < (tail_cell_idx-1); x++)
-		for (int y = head_cell_idy+1; y < (tail_cell_idy); y++)
-			cell[x][y].Interact(&cell[x+1][y-1]);
 }
 
 // Interaction of thisnode particles with particles outside of thisnode
 void Node::Boundary_Interact()
 {
-	#ifdef PERIODIC_BOUNDARY_CONDITION
-// The first and last columns are excluded to avoid multiple interaction for the same pair of cells
-	for (int x = (head_cell_idx+1); x < (tail_cell_idx-1); x++)
-	{
-// Buttom cells of thisnode interacting
-		cell[x][head_cell_idy].Interact(&cell[x][(head_cell_idy-1+divisor_y)%divisor_y]);
-		cell[x][head_cell_idy].Interact(&cell[(x+1)%divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]);
-		cell[x][head_cell_idy].Interact(&cell[(x-1+divisor_x)%divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]);
-
-// Top cells of thisnode interacting
-		cell[x][tail_cell_idy-1].Interact(&cell[x][tail_cell_idy%divisor_y]);
-		cell[x][tail_cell_idy-1].Interact(&cell[(x+1)%divisor_x][tail_cell_idy%divisor_y]);
-		cell[x][tail_cell_idy-1].Interact(&cell[(x-1+divisor_x)%divisor_x][tail_cell_idy%divisor_y]);
-	}
-
-// The first and last rows are excluded to avoid multiple interaction for the same pair of cells
-	for (int y = (head_cell_idy+1); y < (tail_cell_idy-1); y++)
-	{
-// Left cells of this node
-		cell[head_cell_idx][y].Interact(&cell[(head_cell_idx-1+divisor_x) % divisor_x][y]);
-		cell[head_cell_idx][y].Interact(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(y+1)%divisor_y]);
-		cell[head_cell_idx][y].Interact(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(y-1+divisor_y)%divisor_y]);
-
-// Right cells of this node
-		cell[tail_cell_idx-1][y].Interact(&cell[tail_cell_idx % divisor_x][y]);
-		cell[tail_cell_idx-1][y].Interact(&cell[tail_cell_idx % divisor_x][(y+1)%divisor_y]);
-		cell[tail_cell_idx-1][y].Interact(&cell[tail_cell_idx % divisor_x][(y-1+divisor_y)%divisor_y]);
-	}
-
-// Interaction of corners:
-// Left Buttom:
-	cell[head_cell_idx][head_cell_idy].Interact(&cell[(head_cell_idx+1)%divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]); // 7
-	cell[head_cell_idx][head_cell_idy].Interact(&cell[head_cell_idx][(head_cell_idy-1+divisor_y)%divisor_y]); // 6
-	cell[head_cell_idx][head_cell_idy].Interact(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]); // 5
-	cell[head_cell_idx][head_cell_idy].Interact(&cell[(head_cell_idx-1+divisor_x) % divisor_x][head_cell_idy]); // 4
-	cell[head_cell_idx][head_cell_idy].Interact(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(head_cell_idy+1)%divisor_y]); // 3
-// Left Top:
-	cell[head_cell_idx][(tail_cell_idy-1+divisor_y)%divisor_y].Interact(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(tail_cell_idy-2+divisor_y)%divisor_y]); // 5
-	cell[head_cell_idx][(tail_cell_idy-1+divisor_y)%divisor_y].Interact(&cell[(head_cell_idx-1+divisor_x) % divisor_x][(tail_cell_idy-1+divisor_y)%divisor_y]); // 4
-	cell[head_cell_idx][(tail_cell_idy-1+divisor_y)%divisor_y].Interact(&cell[(head_cell_idx-1+divisor_x) % divisor_x][tail_cell_idy%divisor_y]); // 3
-	cell[head_cell_idx][(tail_cell_idy-1+divisor_y)%divisor_y].Interact(&cell[head_cell_idx][tail_cell_idy%divisor_y]); // 2
-	cell[head_cell_idx][(tail_cell_idy-1+divisor_y)%divisor_y].Interact(&cell[(head_cell_idx+1)%divisor_x][tail_cell_idy%divisor_y]); // 1
-// Right Top:
-	cell[tail_cell_idx-1][tail_cell_idy-1].Interact(&cell[(tail_cell_idx-2+divisor_x)%divisor_x][tail_cell_idy%divisor_y]); // 3
-	cell[tail_cell_idx-1][tail_cell_idy-1].Interact(&cell[tail_cell_idx-1][tail_cell_idy%divisor_y]); // 2
-	cell[tail_cell_idx-1][tail_cell_idy-1].Interact(&cell[tail_cell_idx % divisor_x][tail_cell_idy%divisor_y]); // 1
-	cell[tail_cell_idx-1][tail_cell_idy-1].Interact(&cell[tail_cell_idx % divisor_x][tail_cell_idy-1]); // 0
-	cell[tail_cell_idx-1][tail_cell_idy-1].Interact(&cell[tail_cell_idx % divisor_x][(tail_cell_idy-2+divisor_y)%divisor_y]); // 7
-// Right Buttom:
-	cell[tail_cell_idx-1][head_cell_idy].Interact(&cell[tail_cell_idx % divisor_x][(head_cell_idy+1)%divisor_y]); // 1
-	cell[tail_cell_idx-1][head_cell_idy].Interact(&cell[tail_cell_idx % divisor_x][head_cell_idy]); // 0
-	cell[tail_cell_idx-1][head_cell_idy].Interact(&cell[tail_cell_idx % divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]); // 7
-	cell[tail_cell_idx-1][head_cell_idy].Interact(&cell[tail_cell_idx-1][(head_cell_idy-1+divisor_y)%divisor_y]); // 6
-	cell[tail_cell_idx-1][head_cell_idy].Interact(&cell[(tail_cell_idx-2+divisor_x)%divisor_x][(head_cell_idy-1+divisor_y)%divisor_y]); // 5
-	#else
-// In future I'm going to remove the if conditions for a better performance
-
-
-// Right cells of thisnode interacting
-	if (tail_cell_idx != divisor_x)
-		for (int y = (head_cell_idy+1); y < (tail_cell_idy-1); y++) // The first and last rows are excluded to avoid multiple interaction for the same pair of cells
-		{
-			cell[tail_cell_idx-1][y].Interact(&cell[tail_cell_idx][y]);
-			cell[tail_cell_idx-1][y].Interact(&cell[tail_cell_idx][y+1]);
-			cell[tail_cell_idx-1][y].Interact(&cell[tail_cell_idx][y-1]);
-		}
-
-// Top cells of thisnode interacting
-	if (tail_cell_idy != divisor_y) // If tail_cell y cordinate is not at the top
-		for (int x = (head_cell_idx+1); x < (tail_cell_idx-1); x++) // The first and last columns are excluded to avoid multiple interaction for the same pair of cells
-		{
-			cell[x][tail_cell_idy-1].Interact(&cell[x][tail_cell_idy]);
-			cell[x][tail_cell_idy-1].Interact(&cell[x+1][tail_cell_idy]);
-			cell[x][tail_cell_idy-1].Interact(&cell[x-1][tail_cell_idy]);
-		}
-
-// Left cells of thisnode interacting
-	if (head_cell_idx != 0)
-		for (int y = (head_cell_idy+1); y < (tail_cell_idy-1); y++) // The first and last rows are excluded to avoid multiple interaction for the same pair of cells
-		{
-			cell[head_cell_idx][y].Interact(&cell[head_cell_idx-1][y]);
-			cell[head_cell_idx][y].Interact(&cell[head_cell_idx-1][y+1]);
-			cell[head_cell_idx][y].Interact(&cell[head_cell_idx-1][y-1]);
-		}
-
-// Buttom cells of thisnode interacting
-	if (head_cell_idy != 0) // If head_cell y cordinate is not at the bottom
-		for (int x = (head_cell_idx+1); x < (tail_cell_idx-1); x++) // The first and last columns are excluded to avoid multiple interaction for the same pair of cells
-		{
-			cell[x][head_cell_idy].Interact(&cell[x][head_cell_idy-1]);
-			cell[x][head_cell_idy].Interact(&cell[x+1][head_cell_idy-1]);
-			cell[x][head_cell_idy].Interact(&cell[x-1][head_cell_idy-1]);
-		}
-
-// Interaction of corners:
-// Left Buttom:
-	if (head_cell_idx != 0)
-	{
-		cell[head_cell_idx][head_cell_idy].Interact(&cell[head_cell_idx-1][head_cell_idy]); // left: Number 4
-		cell[head_cell_idx][head_cell_idy].Interact(&cell[head_cell_idx-1][head_cell_idy+1]); // up left: Number 3
-		if (head_cell_idy != 0)
-			cell[head_cell_idx][head_cell_idy].Interact(&cell[head_cell_idx-1][head_cell_idy-1]); // down left: Number 5
-	}
-	if (head_cell_idy != 0)
-	{
-		cell[head_cell_idx][head_cell_idy].Interact(&cell[head_cell_idx][head_cell_idy-1]); // down: Number 6
-		cell[head_cell_idx][head_cell_idy].Interact(&cell[head_cell_idx+1][head_cell_idy-1]); // down right: Number 7
-	}
-	
-// Left Top:
-	if (head_cell_idx != 0)
-	{
-		cell[head_cell_idx][tail_cell_idy-1].Interact(&cell[head_cell_idx-1][tail_cell_idy-1]); // left: Number 4
-		cell[head_cell_idx][tail_cell_idy-1].Interact(&cell[head_cell_idx-1][tail_cell_idy-2]); // down left: Number 5
-		if (tail_cell_idy != divisor_y)
-			cell[head_cell_idx][tail_cell_idy-1].Interact(&cell[head_cell_idx-1][tail_cell_idy]); // up left: Number 3
-	}
-	if (tail_cell_idy != divisor_y)
-	{
-		cell[head_cell_idx][tail_cell_idy-1].Interact(&cell[head_cell_idx][tail_cell_idy]); // up: Number 2
-		cell[head_cell_idx][tail_cell_idy-1].Interact(&cell[head_cell_idx+1][tail_cell_idy]); // up right: Number 1
-	}
-
-// Right Top:
-	if (tail_cell_idx != divisor_x)
-	{
-		cell[tail_cell_idx-1][tail_cell_idy-1].Interact(&cell[tail_cell_idx][tail_cell_idy-1]); // right: Number 0
-		cell[tail_cell_idx-1][tail_cell_idy-1].Interact(&cell[tail_cell_idx][tail_cell_idy-2]); // down right: Number 7
-		if (tail_cell_idy != divisor_y)
-			cell[tail_cell_idx-1][tail_cell_idy-1].Interact(&cell[tail_cell_idx][tail_cell_idy]); // up right: Number 1
-	}
-	if (tail_cell_idy != divisor_y)
-	{
-		cell[tail_cell_idx-1][tail_cell_idy-1].Interact(&cell[tail_cell_idx-1][tail_cell_idy]); // up: Number 2
-		cell[tail_cell_idx-1][tail_cell_idy-1].Interact(&cell[tail_cell_idx-2][tail_cell_idy]); // up left: Number 3
-	}
-
-// Right Buttom:
-	if (tail_cell_idx != divisor_x)
-	{
-		cell[tail_cell_idx-1][head_cell_idy].Interact(&cell[tail_cell_idx][head_cell_idy]); // right: Number 0
-		cell[tail_cell_idx-1][head_cell_idy].Interact(&cell[tail_cell_idx][head_cell_idy+1]); // up right: Number 1
-		if (head_cell_idy != 0)
-			cell[tail_cell_idx-1][head_cell_idy].Interact(&cell[tail_cell_idx][head_cell_idy-1]); // down right: Number 7
-	}
-	if (head_cell_idy != 0)
-	{
-		cell[tail_cell_idx-1][head_cell_idy].Interact(&cell[tail_cell_idx-1][head_cell_idy-1]); // down: Number 6
-		cell[tail_cell_idx-1][head_cell_idy].Interact(&cell[tail_cell_idx-2][head_cell_idy-1]); // down: Number 5
-	}
-	#endif
+	int nx, ny;
+	for (int x = head_cell_idx; x < tail_cell_idx; x++)
+		for (int y = head_cell_idy; y < tail_cell_idy; y++)
+			for (int d = 0; d < 8; d++)
+				if (Neighbor_Cell(x, y, d, nx, ny) && !Is_Own_Cell(nx, ny))
+					cell[x][y].Interact(&cell[nx][ny]);
 }
 
-// Moving particles within thisnode
+// Moving particles within thisnode. The random generator is shared, so the noise of particles is drawn first by one thread in the order of cells (the same random numbers as a Move of each cell). Then the particles are moved by threads.
 void Node::Move()
 {
+	noise.resize(N);
+	if (counter_noise)
+	{
+		for (int x = head_cell_idx; x < tail_cell_idx; x++)
+			for (int y = head_cell_idy; y < tail_cell_idy; y++)
+				for (int i = 0; i < cell[x][y].pid.size(); i++)
+					noise[cell[x][y].pid[i]] = Particle::noise_amplitude*Counter_Gaussian(noise_seed, noise_step*N + cell[x][y].pid[i]);
+		noise_step++;
+	}
+	else
+		for (int x = head_cell_idx; x < tail_cell_idx; x++)
+			for (int y = head_cell_idy; y < tail_cell_idy; y++)
+				for (int i = 0; i < cell[x][y].pid.size(); i++)
+					noise[cell[x][y].pid[i]] = gsl_ran_gaussian(C2DVector::gsl_r,Particle::noise_amplitude);
+
+	#pragma omp parallel for collapse(2) schedule(dynamic)
 	for (int x = head_cell_idx; x < tail_cell_idx; x++)
 		for (int y = head_cell_idy; y < tail_cell_idy; y++)
-				cell[x][y].Move();
+			for (int i = 0; i < cell[x][y].pid.size(); i++)
+			{
+				int id = cell[x][y].pid[i];
+				particle[id].Move(noise[id]);
+				if (Tangent::num)
+					particle[id].Tangent_Move(Tangent::Of(id), Tangent::Sum_Of(id));
+			}
 }
 
 bool Node::Chek_Seeds()
@@ -1025,12 +858,12 @@ bool Node::Chek_Seeds()
 	{
 		s[0] = seed;
 		for (int i = 1; i < total_nodes; i++)
-			MPI_Recv(&s[i],1,MPI_LONG_INT,i,1,MPI_COMM_WORLD, &status);
+			MPI_Recv(&s[i],1,MPI_LONG_INT,i,1,world, &status);
 	}
 	else
-		MPI_Send(&seed,1,MPI_LONG_INT,0,1,MPI_COMM_WORLD);
+		MPI_Send(&seed,1,MPI_LONG_INT,0,1,world);
 
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(world);
 
 	if (node_id == 0)
 	{
@@ -1040,18 +873,18 @@ bool Node::Chek_Seeds()
 				b = b && (s[i] != s[j]);
 		int_b = b;
 		for (int i = 1; i < total_nodes; i++)
-			MPI_Send(&int_b,1,MPI_INT,i,1,MPI_COMM_WORLD);
+			MPI_Send(&int_b,1,MPI_INT,i,1,world);
 	}
 	else
 	{
-		MPI_Recv(&int_b,1,MPI_INT,0,1,MPI_COMM_WORLD, &status);
+		MPI_Recv(&int_b,1,MPI_INT,0,1,world, &status);
 		if (int_b == 1)
 			b = true;
 		else
 			b = false;
 	}
 
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(world);
 
 	return (b);
 }
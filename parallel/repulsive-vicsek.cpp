@@ -13,11 +13,12 @@ inline void timing_information(Node* node, clock_t start_time, int i_step, int t
 		int remaining_time = (lapsed_time*(total_step - i_step)) / (i_step + 1);
 		cout << "\r" << round(100.0*i_step / total_step) << "% lapsed time: " << lapsed_time << " s		remaining time: " << remaining_time << " s" << flush;
 	}
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(node->world);
 }
 
 
-inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period, ofstream& out_file)
+// The equilibrium starts from the step of the box, that is not zero if the box is loaded from a checkpoint. The checkpoint is written each checkpoint_period cell updates and at the end.
+inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period, Trajectory& out_file, Checkpoint& checkpoint)
 {
 	clock_t start_time, end_time;
 	start_time = clock();
@@ -25,11 +26,14 @@ inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period,
 	if (box->thisnode->node_id == 0)
 		cout << "equilibrium:" << endl;
 
-	for (long int i = 0; i < equilibrium_step; i+=cell_update_period)
+	for (long int i = box->step; i < equilibrium_step; i+=cell_update_period)
 	{
 		box->Multi_Step(cell_update_period);
 		timing_information(box->thisnode,start_time,i,equilibrium_step);
+		if ((box->step / cell_update_period) % checkpoint_period == 0 || box->step >= equilibrium_step)
+			checkpoint << box;
 	}
+	checkpoint.Finish();
 
 	if (box->thisnode->node_id == 0)
 		cout << "Finished" << endl;
@@ -41,7 +45,8 @@ inline Real equilibrium(Box* box, long int equilibrium_step, int saving_period,
 }
 
 
-inline Real data_gathering(Box* box, long int total_step, int saving_period, ofstream& out_file)
+// The checkpoint of the end of the data gathering shows that the noise is finished (its step is at least equilibrium_step + total_step), the next noise of the cooling starts from it.
+inline Real data_gathering(Box* box, long int total_step, int saving_period, Trajectory& out_file, Checkpoint& checkpoint)
 {
 	clock_t start_time, end_time;
 	start_time = clock();
@@ -62,6 +67,8 @@ inline Real data_gathering(Box* box, long int total_step, int saving_period, ofs
 		if ((i / cell_update_period) % saving_period == 0)
 			out_file << box;
 	}
+	checkpoint << box;
+	checkpoint.Finish();
 
 	if (box->thisnode->node_id == 0)
 		cout << "Finished" << endl;
@@ -86,45 +93,54 @@ void Change_Noise(int argc, char *argv[], Node* thisnode)
 	Particle::noise_amplitude = 0;
 	Particle::g = input_g;
 
-	Box box;
+	static Box box; // Box is about the size of the default stack (8 MB), so it must not be a local variable.
 	box.Init(thisnode, input_rho);
 
-	ofstream out_file;
+	Trajectory out_file;
+	Checkpoint checkpoint;
 
 	for (int i = 0; i < noise_list.size(); i++)
 	{
 		Particle::noise_amplitude = noise_list[i] / sqrt(dt); // noise amplitude depends on the step (dt) because of ito calculation. If we have epsilon in our differential equation and we descritise it with time steps dt, the noise in each step that we add is epsilon times sqrt(dt) if we factorise it with a dt we have dt*(epsilon/sqrt(dt)).
 		box.info.str("");
 		box.info << "rho=" << box.density <<  "-g=" << Particle::g << "-noise=" << noise_list[i] << "-cooling";
-
-		if (thisnode->node_id == 0)
+		box.step = 0;
+
+// If a checkpoint of this noise exists the simulation continues from it.
+		checkpoint.Open(box.info.str() + "-checkpoint.bin", thisnode->world);
+		if (box.Load(checkpoint.name) && thisnode->node_id == 0)
+			cout << " Continuing from the checkpoint at step " << box.step << endl;
+// A finished noise is not run again, its trajectory is kept and the box has its last state.
+		if (box.step >= equilibrium_step + total_step)
 		{
-			stringstream address;
-			address.str("");
-			address << box.info.str() << "-r-v.bin";
-			out_file.open(address.str().c_str());
+			if (thisnode->node_id == 0)
+				cout << " " << box.info.str() << " is finished" << endl;
+			continue;
 		}
 
+		stringstream address;
+		address.str("");
+		address << box.info.str() << "-r-v.bin";
+		out_file.Open(address.str(), thisnode->world); // Every node writes its own particles to the trajectory file.
+
 		if (thisnode->node_id == 0)
 			cout << " Box information is: " << box.info.str() << endl;
 
-		MPI_Barrier(MPI_COMM_WORLD);
-		t_eq = equilibrium(&box, equilibrium_step, saving_period, out_file);
-		MPI_Barrier(MPI_COMM_WORLD);
+		MPI_Barrier(thisnode->world);
+		t_eq = equilibrium(&box, equilibrium_step, saving_period, out_file, checkpoint);
+		MPI_Barrier(thisnode->world);
 
 		if (thisnode->node_id == 0)
 			cout << " Done in " << (t_eq / 60.0) << " minutes" << endl;
 
-		t_sim = data_gathering(&box, total_step, saving_period, out_file);
-		MPI_Barrier(MPI_COMM_WORLD);
+		t_sim = data_gathering(&box, total_step, saving_period, out_file, checkpoint);
+		MPI_Barrier(thisnode->world);
 
 		if (thisnode->node_id == 0)
-		{
 			cout << " Done in " << (t_sim / 60.0) << " minutes" << endl;
-			out_file.close();
-		}
+		out_file.Close();
 	}
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(thisnode->world);
 }
 
 void Init_Nodes(Node& thisnode)
@@ -136,18 +152,19 @@ void Init_Nodes(Node& thisnode)
 		while (!thisnode.Chek_Seeds())
 		{
 			thisnode.seed = time(NULL) + thisnode.node_id*112488;
-			MPI_Barrier(MPI_COMM_WORLD);
+			MPI_Barrier(thisnode.world);
 		}
 	#endif
 	C2DVector::Init_Rand(thisnode.seed);
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(thisnode.world);
 }
 
 int main(int argc, char *argv[])
 {
 	int this_node_id, total_nodes;
 	MPI_Status status;
-	MPI_Init(&argc, &argv);
+	int thread_support;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support); // Nodes may use threads (OpenMP), but only the master thread calls MPI.
 
 	Node thisnode;
 	Init_Nodes(thisnode);
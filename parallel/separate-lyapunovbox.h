@@ -46,6 +46,7 @@ LyapunovBox::LyapunovBox() : Box()
 }
 
 
+// State hyper vectors do not have a random generator (Rand_Snapshot), only the particles are sent.
 void LyapunovBox::Send_State_Hyper_Vector(const State_Hyper_Vector& shv, int dest, int tag)
 {
 // Allocation
@@ -62,7 +63,6 @@ void LyapunovBox::Send_State_Hyper_Vector(const State_Hyper_Vector& shv, int des
 	}
 
 	MPI_Send(data_buffer, 3*N, MPI_DOUBLE, dest, 0,MPI_COMM_WORLD);
-	MPI_Send(shv.gsl_r->state, shv.gsl_r->type->size, MPI_BYTE, dest, 0,MPI_COMM_WORLD);
 
 	delete [] data_buffer;
 }
@@ -85,8 +85,6 @@ void LyapunovBox::Recv_State_Hyper_Vector(const State_Hyper_Vector& shv, int sou
 		counter++;
 	}
 
-	MPI_Recv(shv.gsl_r->state, shv.gsl_r->type->size, MPI_BYTE, source, 0,MPI_COMM_WORLD, &status);
-
 	delete [] data_buffer;
 }
 
@@ -107,7 +105,6 @@ void LyapunovBox::Root_Bcast_State_Hyper_Vector(const State_Hyper_Vector& shv)
 	MPI_Barrier(MPI_COMM_WORLD);
 
 	MPI_Bcast(data_buffer, 3*N, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-	MPI_Bcast(shv.gsl_r->state, shv.gsl_r->type->size, MPI_BYTE, 0,MPI_COMM_WORLD);
 
 	if (thisnode != 0)
 	{
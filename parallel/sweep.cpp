@@ -0,0 +1,123 @@
+#include "../shared/parameters.h"
+#include "../shared/c2dvector.h"
+#include "../shared/particle.h"
+#include "../shared/cell.h"
+#include "box.h"
+
+// Parameter sweep: the processes are split to groups of ranks_per_box processes and each group is a parallel box that simulates some of the noises. The noises are given to the groups in turn, group c simulates noise c, c + groups, c + 2*groups and so on. Each noise starts from a new random initial condition.
+// To run:
+// mpirun -np num_process a.out ranks_per_box rho g noise_1 noise_2 ...
+// num_process must be a multiple of ranks_per_box.
+
+inline Real equilibrium(Box* box, long int equilibrium_step, Checkpoint& checkpoint)
+{
+	Real start_time = MPI_Wtime();
+
+	for (long int i = box->step; i < equilibrium_step; i+=cell_update_period)
+	{
+		box->Multi_Step(cell_update_period);
+		if ((box->step / cell_update_period) % checkpoint_period == 0 || box->step >= equilibrium_step)
+			checkpoint << box;
+	}
+	checkpoint.Finish();
+
+	return(MPI_Wtime() - start_time);
+}
+
+// The checkpoint of the end shows that the noise is finished (its step is at least equilibrium_step + total_step).
+inline Real data_gathering(Box* box, long int total_step, int saving_period, Trajectory& out_file, Checkpoint& checkpoint)
+{
+	Real start_time = MPI_Wtime();
+
+	for (long int i = 0; i < total_step; i+=cell_update_period)
+	{
+		box->Multi_Step(cell_update_period);
+		if ((i / cell_update_period) % saving_period == 0)
+			out_file << box;
+	}
+	checkpoint << box;
+	checkpoint.Finish();
+
+	return(MPI_Wtime() - start_time);
+}
+
+void Sweep_Noise(int argc, char *argv[], Node* thisnode, int group, int groups)
+{
+	Real input_rho = atof(argv[2]);
+	Real input_g = atof(argv[3]);
+
+	vector<Real> noise_list;
+	for (int i = 4; i < argc; i++)
+		noise_list.push_back(atof(argv[i]));
+
+	Particle::g = input_g;
+
+	static Box box; // Box is about the size of the default stack (8 MB), so it must not be a local variable.
+	Trajectory out_file;
+	Checkpoint checkpoint;
+
+	for (int i = group; i < noise_list.size(); i += groups)
+	{
+		Particle::noise_amplitude = 0;
+		box.Init(thisnode, input_rho);
+		Particle::noise_amplitude = noise_list[i] / sqrt(dt); // noise amplitude depends on the step (dt) because of ito calculation.
+		box.info.str("");
+		box.info << "rho=" << box.density <<  "-g=" << Particle::g << "-noise=" << noise_list[i];
+		box.step = 0;
+
+// If a checkpoint of this noise exists the simulation continues from it.
+		checkpoint.Open(box.info.str() + "-checkpoint.bin", thisnode->world);
+		box.Load(checkpoint.name);
+		if (box.step >= equilibrium_step + total_step) // A finished noise keeps its trajectory.
+			continue;
+
+		stringstream address;
+		address << box.info.str() << "-r-v.bin";
+		out_file.Open(address.str(), thisnode->world); // Every node of the group writes its own particles to the trajectory file.
+
+		Real t_eq = equilibrium(&box, equilibrium_step, checkpoint);
+		Real t_sim = data_gathering(&box, total_step, saving_period, out_file, checkpoint);
+		out_file.Close();
+
+		if (thisnode->node_id == 0)
+			cout << "Group " << group << ": " << box.info.str() << " done in " << ((t_eq + t_sim) / 60.0) << " minutes" << endl;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int thread_support;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support); // Nodes may use threads (OpenMP), but only the master thread calls MPI.
+
+	int world_id, world_size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &world_id);
+	MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+	int ranks_per_box = (argc > 4) ? atoi(argv[1]) : 0;
+	if (ranks_per_box < 1 || world_size % ranks_per_box != 0)
+	{
+		if (world_id == 0)
+			cout << "Usage: mpirun -np num_process a.out ranks_per_box rho g noise_1 noise_2 ... (num_process must be a multiple of ranks_per_box)" << endl;
+		MPI_Finalize();
+		exit(0);
+	}
+
+// Each group of ranks_per_box processes is a box.
+	int groups = world_size / ranks_per_box;
+	int group = world_id / ranks_per_box;
+	MPI_Comm box_comm;
+	MPI_Comm_split(MPI_COMM_WORLD, group, world_id, &box_comm);
+
+	Node thisnode(box_comm);
+	#ifdef COMPARE
+		thisnode.seed = seed;
+	#else
+		thisnode.seed = time(NULL) + world_id*112488; // All processes of the world have different seeds.
+	#endif
+	C2DVector::Init_Rand(thisnode.seed);
+
+	Sweep_Noise(argc, argv, &thisnode, group, groups);
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+}
@@ -0,0 +1,162 @@
+#ifndef _TRAJECTORY_
+#define _TRAJECTORY_
+
+#include "mpi.h"
+#include "../shared/trajectory-format.h"
+#include <string>
+#include <vector>
+
+// Frame of the ring of a Trajectory: the floats of the particles of thisnode and their places in the frame. Each slot has its own handle of the file, the view of a handle can only change when its writes are finished.
+struct Trajectory_Slot{
+	MPI_File file;
+	std::vector<float> data; // x, y, vx and vy of each particle like the serial output.
+	std::vector<int> displacement; // Place of each particle in the frame (in number of particles)
+	MPI_Datatype particle_type, frame_type;
+	MPI_Request request[2]; // The particles, and N of the frame (master node)
+	int N;
+	bool is_busy; // Its types are made and its writes might not be finished.
+};
+
+// Trajectory is the output file of the parallel program that is shared between nodes. Each node writes the particles of its own cells directly to the file (MPI-IO), so saving does not need any gather by the master node. The format is the same as the serial program (shared/trajectory-format.h): the master node writes the header with the first frame and the index of the frames when the file is closed.
+// The writes are non-blocking (MPI_File_iwrite_at_all) from a ring of slots, so the simulation goes on while the frames are written and it only waits when the slot of the next frame is still being written (stall). Only the master thread calls MPI, so the nodes do not use a writer thread like the serial program.
+struct Trajectory{
+	MPI_File file; // Plain byte view, for the header, N of each frame and the index.
+	MPI_Comm comm;
+	std::string name;
+	MPI_Offset offset; // Position of the next frame in the file (in bytes).
+	bool is_open;
+	int node_id;
+	Trajectory_Header header;
+	std::vector<long int> frame_offset; // Offsets of the written frames, all nodes have them.
+	std::vector<Trajectory_Slot> slot;
+
+	long int stalls; // Number of frames that waited for their slot
+	double stall_time; // Seconds
+
+	Trajectory();
+	~Trajectory();
+
+	bool Open(const std::string name, MPI_Comm comm = MPI_COMM_WORLD); // All nodes of comm (the nodes of the box) must call it. An old file with the same name is truncated like an ofstream.
+	void Start(int N); // Make the slots for frames of N particles (called with the first frame). All nodes must call it.
+	Trajectory_Slot& Get_Slot(); // Slot of the next frame, it waits for the writes of the slot. All nodes must call it.
+	void Write(Trajectory_Slot& s, int N); // Start writing the packed particles of the slot as the next frame. All nodes must call it.
+	void Finish(Trajectory_Slot& s); // Wait for the writes of a slot and free its types.
+	void Close(); // All nodes must call it.
+};
+
+Trajectory::Trajectory()
+{
+	offset = 0;
+	is_open = false;
+	stalls = 0;
+	stall_time = 0;
+}
+
+Trajectory::~Trajectory()
+{
+	Close();
+}
+
+bool Trajectory::Open(const std::string input_name, MPI_Comm input_comm)
+{
+	Close();
+	name = input_name;
+	comm = input_comm;
+	if (MPI_File_open(comm, (char*) name.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+		return false;
+	MPI_File_set_size(file, 0);
+	MPI_Comm_rank(comm, &node_id);
+	offset = 0;
+	frame_offset.clear();
+	stalls = 0;
+	stall_time = 0;
+	is_open = true;
+	return true;
+}
+
+void Trajectory::Start(int N)
+{
+	long int slot_bytes = 4*sizeof(float)*(long int) max(N, 1);
+	int slots = max(2, (int) min((long int) trajectory_ring_slots, trajectory_ring_memory / slot_bytes));
+	slot.resize(slots);
+	for (int i = 0; i < slots; i++)
+	{
+		MPI_File_open(comm, (char*) name.c_str(), MPI_MODE_WRONLY, MPI_INFO_NULL, &slot[i].file);
+		slot[i].is_busy = false;
+	}
+}
+
+void Trajectory::Finish(Trajectory_Slot& s)
+{
+	if (!s.is_busy)
+		return;
+	MPI_Waitall(2, s.request, MPI_STATUSES_IGNORE);
+	MPI_Type_free(&s.frame_type);
+	MPI_Type_free(&s.particle_type);
+	s.is_busy = false;
+}
+
+Trajectory_Slot& Trajectory::Get_Slot()
+{
+	Trajectory_Slot& s = slot[frame_offset.size() % slot.size()];
+	if (s.is_busy)
+	{
+		int done;
+		MPI_Testall(2, s.request, &done, MPI_STATUSES_IGNORE);
+		if (!done)
+		{
+			double start = MPI_Wtime();
+			stalls++;
+			MPI_Waitall(2, s.request, MPI_STATUSES_IGNORE);
+			stall_time += MPI_Wtime() - start;
+		}
+		Finish(s);
+	}
+	return s;
+}
+
+void Trajectory::Write(Trajectory_Slot& s, int N)
+{
+	frame_offset.push_back(offset);
+	s.N = N;
+	s.request[1] = MPI_REQUEST_NULL;
+	if (node_id == 0)
+		MPI_File_iwrite_at(file, offset, &s.N, 1, MPI_INT, &s.request[1]);
+
+	int count = s.displacement.size();
+	MPI_Type_contiguous(4, MPI_FLOAT, &s.particle_type);
+	MPI_Type_commit(&s.particle_type);
+	MPI_Type_create_indexed_block(count, 1, s.displacement.data(), s.particle_type, &s.frame_type);
+	MPI_Type_commit(&s.frame_type);
+	MPI_File_set_view(s.file, offset + sizeof(int), s.particle_type, s.frame_type, (char*) "native", MPI_INFO_NULL);
+	MPI_File_iwrite_at_all(s.file, 0, s.data.data(), count, s.particle_type, &s.request[0]);
+	s.is_busy = true;
+	offset += Frame_Size(N);
+}
+
+void Trajectory::Close()
+{
+	if (!is_open)
+		return;
+	for (int i = 0; i < slot.size(); i++)
+	{
+		Finish(slot[i]);
+		MPI_File_close(&slot[i].file);
+	}
+	slot.clear();
+	if (node_id == 0 && frame_offset.size() > 0)
+	{
+		Trajectory_Footer footer;
+		memset(&footer, 0, sizeof(footer));
+		footer.index_offset = offset;
+		footer.frames = frame_offset.size();
+		strcpy(footer.magic, "PSTRIDX");
+		MPI_File_write_at(file, offset, frame_offset.data(), sizeof(long int)*frame_offset.size(), MPI_BYTE, MPI_STATUS_IGNORE);
+		MPI_File_write_at(file, offset + sizeof(long int)*frame_offset.size(), &footer, sizeof(footer), MPI_BYTE, MPI_STATUS_IGNORE);
+		cout << "Trajectory: " << frame_offset.size() << " frames, " << stalls << " stalls (" << stall_time << " s)" << endl;
+	}
+	MPI_File_close(&file);
+	is_open = false;
+}
+
+#endif
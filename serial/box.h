@@ -8,7 +8,9 @@
 #include "../shared/wall.h"
 #include "../shared/set-up.h"
 #include "../shared/state-hyper-vector.h"
+#include "../shared/snapshot.h"
 #include "../shared/geometry.h"
+#include "trajectory.h"
 
 #include <boost/algorithm/string.hpp>
 
@@ -24,8 +26,12 @@ public:
 
 	Box();
 
-	void Load(const State_Hyper_Vector&); // Load new position and angles of particles and a gsl random generator from a state hyper vector
-	void Save(State_Hyper_Vector&) const; // Save current position and angles of particles and a gsl random generator to a state hyper vector
+	void Load(const State_Hyper_Vector&); // Load new position and angles of particles from a state hyper vector
+	void Save(State_Hyper_Vector&) const; // Save current position and angles of particles to a state hyper vector
+	void Load(const Box_State&); // Load a state and its gsl random generator
+	void Save(Box_State&) const; // Save the state and the gsl random generator
+	void Load(const Box_Snapshot&); // Restore the cells, neighbor lists and random generator from a snapshot of this box, without updating the cells.
+	void Save(Box_Snapshot&) const; // Save the engine state to a snapshot
 
 	void Update_Neighbor_List(); // This will update verlet neighore list of each particle
 	void Update_Cells();
@@ -39,7 +45,8 @@ public:
 
 	void Make_Traj(Real scale, std::ofstream& data_file);
 
-	friend std::ostream& operator<<(std::ostream& os, Box* box); // Save
+	friend std::ostream& operator<<(std::ostream& os, Box* box); // Save a frame
+	friend Trajectory& operator<<(Trajectory& traj, Box* box); // Give a frame to the writer of the trajectory file, with the header before the first one.
 	friend std::istream& operator>>(std::istream& is, Box* box); // Input
 };
 
@@ -147,7 +154,6 @@ void Box::Load(const State_Hyper_Vector& sv)
 		particle[i].v.x = cos(particle[i].theta);
 		particle[i].v.y = sin(particle[i].theta);
 	}
-	sv.Set_C2DVector_Rand_Generator();
 
 	Update_Cells();
 }
@@ -166,10 +172,33 @@ void Box::Save(State_Hyper_Vector& sv) const
 		sv.particle[i].r = particle[i].r;
 		sv.particle[i].theta = particle[i].theta;
 	}
-	sv.Get_C2DVector_Rand_Generator();
 // We need to make sure that indexing of particles are the same to exactly recompute the same values. Therefor at a saving we update cells and neighore list therefore if we load the same sv and update cells and neighore list we will come to the same indexing
 }
 
+void Box::Load(const Box_State& bs)
+{
+	bs.rand.Set_C2DVector_Rand_Generator();
+	Load((const State_Hyper_Vector&) bs);
+}
+
+void Box::Save(Box_State& bs) const
+{
+	Save((State_Hyper_Vector&) bs);
+	bs.rand.Get_C2DVector_Rand_Generator();
+}
+
+void Box::Load(const Box_Snapshot& snapshot)
+{
+	snapshot.Load_Cells(&cell[0][0], divisor_x*divisor_y, particle);
+	snapshot.rand.Set_C2DVector_Rand_Generator();
+}
+
+void Box::Save(Box_Snapshot& snapshot) const
+{
+	snapshot.Save_Cells(&cell[0][0], divisor_x*divisor_y, particle);
+	snapshot.rand.Get_C2DVector_Rand_Generator();
+}
+
 // Here the intractio of particles are computed that is the applied tourque to each particle.
 void Box::Interact()
 {
@@ -229,7 +258,11 @@ void Box::Interact()
 void Box::Move()
 {
 	for (int i = 0; i < N; i++)
+	{
 		particle[i].Move();
+		if (Tangent::num)
+			particle[i].Tangent_Move(Tangent::Of(i), Tangent::Sum_Of(i));
+	}
 }
 
 // One full step, composed of interaction computation and move.
@@ -312,6 +345,33 @@ std::ostream& operator<<(std::ostream& os, Box* box)
 //		v.y = sin(box->particle[i].theta);
 //		v.write(os);
 //	}
+	return os;
+}
+
+Trajectory& operator<<(Trajectory& traj, Box* box)
+{
+	if (traj.frames == 0)
+	{
+		Trajectory_Header& header = traj.header;
+		Init_Trajectory_Header(header);
+		header.N = box->N;
+		header.seed = C2DVector::rand_seed;
+		header.density = box->density;
+		header.noise = Particle::noise_amplitude*sqrt(dt);
+		header.rv = Particle::rv;
+		header.speed = Particle::speed;
+		strncpy(header.info, box->info.str().c_str(), sizeof(header.info) - 1);
+		traj.Start(box->N);
+	}
+	double* data = traj.Get_Slot(box->N);
+	for (int i = 0; i < box->N; i++)
+	{
+		data[3*i] = box->particle[i].r.x;
+		data[3*i+1] = box->particle[i].r.y;
+		data[3*i+2] = box->particle[i].theta;
+	}
+	traj.Push();
+	return traj;
 }
 
 // Reading the particle information (position and velocities) from a standard input stream (probably a file).
@@ -332,6 +392,7 @@ std::istream& operator>>(std::istream& is, Box* box)
 //		is >> box->particle[i].r;
 //		is >> box->particle[i].v;
 //	}
+	return is;
 }
 
 #endif
@@ -0,0 +1,86 @@
+#include "../shared/parameters.h"
+#include "../shared/c2dvector.h"
+#include "../shared/particle.h"
+#include "../shared/set-up.h"
+#include "ensemble.h"
+
+// Several replicas of a small box in one process. Each replica is saved to its own file.
+// To run:
+// ./a.out replicas rho g noise
+
+inline Real equilibrium(Ensemble* ensemble, int equilibrium_step)
+{
+	clock_t start_time = clock();
+	cout << "equilibrium:" << endl;
+	for (int i = 0; i < equilibrium_step; i+=cell_update_period)
+		ensemble->Multi_Step(cell_update_period);
+	cout << "Finished" << endl;
+	return ((Real) (clock() - start_time) / CLOCKS_PER_SEC);
+}
+
+inline Real data_gathering(Ensemble* ensemble, int total_step, int saving_period, vector<ofstream*>& out_file)
+{
+	clock_t start_time = clock();
+	cout << "gathering data:" << endl;
+	for (int i = 0; i < total_step; i+=cell_update_period)
+	{
+		ensemble->Multi_Step(cell_update_period);
+
+		if ((i / cell_update_period) % saving_period == 0)
+			for (int r = 0; r < ensemble->R; r++)
+				ensemble->Save(r, *out_file[r]);
+	}
+	cout << "Finished" << endl;
+	return ((Real) (clock() - start_time) / CLOCKS_PER_SEC);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 5)
+	{
+		cout << "Usage: ./a.out replicas rho g noise" << endl;
+		exit(0);
+	}
+
+	int replicas = atoi(argv[1]);
+	Real input_rho = atof(argv[2]);
+	Particle::g = atof(argv[3]);
+	Real input_noise = atof(argv[4]);
+	Particle::noise_amplitude = input_noise / sqrt(dt); // noise amplitude depends on the step (dt) because of ito calculation.
+
+	C2DVector::Init_Rand(seed);
+
+// The seeds are the same as the tasks of mpi-main.cpp
+	vector<long int> replica_seed(replicas);
+	for (int r = 0; r < replicas; r++)
+	#ifdef COMPARE
+		replica_seed[r] = seed + r*112488;
+	#else
+		replica_seed[r] = time(NULL) + r*112488;
+	#endif
+
+	static Ensemble ensemble;
+	ensemble.Init(input_rho, replica_seed);
+	ensemble.info.str("");
+	ensemble.info << "rho=" << ensemble.density <<  "-g=" << Particle::g << "-noise=" << input_noise;
+	cout << ensemble.info.str() << " replicas = " << replicas << " number_of_particles = " << ensemble.N << endl;
+
+	vector<ofstream*> out_file(replicas);
+	for (int r = 0; r < replicas; r++)
+	{
+		stringstream address;
+		address << ensemble.info.str() << "-replica=" << r << "-r-v.bin";
+		out_file[r] = new ofstream(address.str().c_str());
+	}
+
+	Real t_eq = equilibrium(&ensemble, equilibrium_step);
+	cout << "elapsed time of equilibrium is \t" << t_eq << endl;
+	Real t_sim = data_gathering(&ensemble, total_step, saving_period, out_file);
+	cout << "elapsed time of simulation is \t" << t_sim << endl;
+
+	for (int r = 0; r < replicas; r++)
+	{
+		out_file[r]->close();
+		delete out_file[r];
+	}
+}
@@ -0,0 +1,312 @@
+#ifndef _ENSEMBLE_
+#define _ENSEMBLE_
+
+#include "../shared/parameters.h"
+#include "../shared/c2dvector.h"
+#include "../shared/particle.h"
+#include "../shared/set-up.h"
+
+#include <vector>
+
+// Ensemble is a set of replicas (independent boxes with the same size, density and parameters but different seeds) that are simulated together in one process. The dynamics is the same as the serial Box of RepulsiveParticle with a verlet list and a periodic box.
+// The data of the particles are interleaved, the value of particle i of replica r is at i*R + r (Index). The pairs of each replica are put in pair slots, slot k of replica r is at k*R + r, so one pass over the slots interacts the k'th pair of all replicas and the loop over the replicas has no dependency (SIMD lanes are replicas). A replica with fewer pairs is padded with pairs of its dummy particle (particle N) with itself, they are masked in Interact and change nothing.
+// Each replica has its own random generator, the initial condition and the noises of a replica are the same as a Box that its generator is set to the same seed, so a replica is exactly the same as the serial program.
+class Ensemble{
+public:
+	int R; // Number of replicas
+	int N; // Number of particles of each replica
+	Real density;
+	std::vector<Real> x, y, theta; // (N+1)*R, the last particle of each replica is the dummy particle.
+	std::vector<Real> fx, fy, torque;
+	std::vector<Real> noise; // Noise of the current step, drawn by each replica in the order of its particles like Box::Move.
+	std::vector<int> pair_i, pair_j; // Particle ids of the pair slots.
+	int slots; // Number of pair slots, the number of pairs of the replica with most pairs.
+	std::vector<gsl_rng*> rng; // Random generator of each replica
+	std::vector<long int> seed;
+	stringstream info; // information stream that contains the simulation information, like noise, density and etc. this will be used for the saving name of the system.
+
+	Ensemble();
+	~Ensemble();
+
+	int Index(int i, int r) const {return (i*R + r);}
+	void Init(Real input_density, const std::vector<long int>& input_seed); // One replica for each seed. Positions are random (Random_Formation).
+	void Update_Cells(); // Update cells and the pair slots of all replicas.
+	void Interact();
+	void Move(); // Move all particles of all replicas.
+	void One_Step(); // One full step, composed of interaction computation and move.
+	void Multi_Step(int steps); // Several steps befor a cell upgrade.
+	void Save(int r, std::ostream& os) const; // Saving replica r in the format of the serial box (operator<< in box.h).
+
+private:
+	void Reset(); // Null forces and torques
+	void Replica_Pairs(int r, std::vector<int>& p_i, std::vector<int>& p_j) const; // Pairs of replica r in the order of Box::Interact
+};
+
+Ensemble::Ensemble()
+{
+	R = N = 0;
+	density = 0;
+	slots = 0;
+	#ifndef PERIODIC_BOUNDARY_CONDITION
+		cout << "Error: Ensemble is only for a periodic box" << endl;
+		exit(0);
+	#endif
+}
+
+Ensemble::~Ensemble()
+{
+	for (int r = 0; r < rng.size(); r++)
+		gsl_rng_free(rng[r]);
+}
+
+void Ensemble::Init(Real input_density, const std::vector<long int>& input_seed)
+{
+	for (int r = 0; r < rng.size(); r++)
+		gsl_rng_free(rng[r]);
+
+	seed = input_seed;
+	R = seed.size();
+	density = input_density;
+	N = (int) round(Lx2*Ly2*density);
+
+	x.assign((N+1)*R, 0);
+	y.assign((N+1)*R, 0);
+	theta.assign((N+1)*R, 0);
+	fx.assign((N+1)*R, 0);
+	fy.assign((N+1)*R, 0);
+	torque.assign((N+1)*R, 0);
+	noise.assign(N*R, 0);
+	rng.resize(R);
+
+// The formations use the generator of C2DVector, it is replaced by the generator of each replica during the formation. The temporary particles are made before, because the constructor of the particles uses the generator.
+	std::vector<Particle> temp(N);
+	gsl_rng* c2dvector_rng = C2DVector::gsl_r;
+	for (int r = 0; r < R; r++)
+	{
+		rng[r] = gsl_rng_alloc(gsl_rng_default);
+		gsl_rng_set(rng[r], seed[r]);
+		C2DVector::gsl_r = rng[r];
+		Random_Formation(temp.data(), N, 0);
+		for (int i = 0; i < N; i++)
+		{
+			x[Index(i,r)] = temp[i].r.x;
+			y[Index(i,r)] = temp[i].r.y;
+			theta[Index(i,r)] = temp[i].theta;
+		}
+	}
+	C2DVector::gsl_r = c2dvector_rng;
+
+	Reset();
+	Update_Cells();
+}
+
+void Ensemble::Reset()
+{
+	for (int n = 0; n < (N+1)*R; n++)
+	{
+		fx[n] = fy[n] = 0;
+		torque[n] = 0;
+	}
+}
+
+// The same cells and verlet list as Box::Update_Cells and Box::Update_Neighbor_List, the pairs are in the order that Box::Interact uses them, so the sums of forces are in the same order.
+void Ensemble::Replica_Pairs(int r, std::vector<int>& p_i, std::vector<int>& p_j) const
+{
+	static std::vector<int> cell[divisor_x][divisor_y];
+	for (int cx = 0; cx < divisor_x; cx++)
+		for (int cy = 0; cy < divisor_y; cy++)
+			cell[cx][cy].clear();
+
+	for (int i = 0; i < N; i++)
+	{
+		int cx,cy;
+		cx = (int) (x[Index(i,r)] + Lx)*divisor_x / Lx2;
+		cy = (int) (y[Index(i,r)] + Ly)*divisor_y / Ly2;
+		cell[cx][cy].push_back(i);
+	}
+
+	p_i.clear();
+	p_j.clear();
+	int neighbor[4][2] = {{1,0},{0,1},{1,1},{1,-1}}; // right, up, up right and down right cells
+	for (int cx = 0; cx < divisor_x; cx++)
+		for (int cy = 0; cy < divisor_y; cy++)
+		{
+			std::vector<int>& c = cell[cx][cy];
+			for (int a = 0; a < c.size(); a++)
+			{
+				int i = c[a];
+				for (int b = a+1; b < c.size(); b++)
+				{
+					int j = c[b];
+					C2DVector dr;
+					dr.x = x[Index(i,r)] - x[Index(j,r)];
+					dr.y = y[Index(i,r)] - y[Index(j,r)];
+					Real d = sqrt(dr.Square());
+					if (d < Particle::rv)
+					{
+						p_i.push_back(i);
+						p_j.push_back(j);
+					}
+				}
+				for (int n = 0; n < 4; n++)
+				{
+					std::vector<int>& nc = cell[(cx+neighbor[n][0]+divisor_x)%divisor_x][(cy+neighbor[n][1]+divisor_y)%divisor_y];
+					for (int b = 0; b < nc.size(); b++)
+					{
+						int j = nc[b];
+						C2DVector dr;
+						dr.x = x[Index(i,r)] - x[Index(j,r)];
+						dr.y = y[Index(i,r)] - y[Index(j,r)];
+						dr.Periodic_Transform();
+						Real d = sqrt(dr.Square());
+						if (d < Particle::rv)
+						{
+							p_i.push_back(i);
+							p_j.push_back(j);
+						}
+					}
+				}
+			}
+		}
+}
+
+void Ensemble::Update_Cells()
+{
+	std::vector<std::vector<int> > p_i(R), p_j(R);
+	slots = 0;
+	for (int r = 0; r < R; r++)
+	{
+		Replica_Pairs(r, p_i[r], p_j[r]);
+		slots = max(slots, (int) p_i[r].size());
+	}
+
+	pair_i.assign(slots*R, N); // Padding is the pair of the dummy particle with itself.
+	pair_j.assign(slots*R, N);
+	for (int r = 0; r < R; r++)
+		for (int k = 0; k < p_i[r].size(); k++)
+		{
+			pair_i[k*R + r] = p_i[r][k];
+			pair_j[k*R + r] = p_j[r][k];
+		}
+}
+
+// The interaction is the same as RepulsiveParticle::Interact. The padding pairs are masked by their distance, it is taken beyond the cutoffs instead of zero, so no force or torque (and no division by zero) is computed for them.
+void Ensemble::Interact()
+{
+	const Real padding_d2 = 4*max(r_c_p, r_f_p)*max(r_c_p, r_f_p);
+	Real* px = x.data();
+	Real* py = y.data();
+	Real* ptheta = theta.data();
+	Real* pfx = fx.data();
+	Real* pfy = fy.data();
+	Real* ptorque = torque.data();
+	for (int k = 0; k < slots; k++)
+	{
+		const int* slot_i = &pair_i[k*R];
+		const int* slot_j = &pair_j[k*R];
+		#pragma omp simd
+		for (int r = 0; r < R; r++)
+		{
+			int a = slot_i[r]*R + r;
+			int b = slot_j[r]*R + r;
+			Real dx = px[a] - px[b];
+			Real dy = py[a] - py[b];
+			dx -= Lx2*((int) (dx / Lx));
+			dy -= Ly2*((int) (dy / Ly));
+			Real d2 = (slot_i[r] == N) ? padding_d2 : dx*dx + dy*dy;
+			Real d = sqrt(d2);
+
+			if (d < r_c_p)
+			{
+				dx /= d;
+				dy /= d;
+				Real r_c_p2 = r_c_p*r_c_p;
+				Real magnitude = ( exp(- d / sigma_p ) * ( 1. / d2 + 1. / (sigma_p * d)) - exp(- r_c_p / sigma_p ) * ( 1. / r_c_p2 + 1. / (sigma_p * r_c_p)) );
+				Real interaction_x = dx * A_p * magnitude;
+				Real interaction_y = dy * A_p * magnitude;
+				pfx[a] += interaction_x;
+				pfy[a] += interaction_y;
+				pfx[b] -= interaction_x;
+				pfy[b] -= interaction_y;
+			}
+
+			if (d < r_f_p)
+			{
+				Real torque_interaction = Particle::g*sin(ptheta[b] - ptheta[a])/(PI);
+				ptorque[a] += torque_interaction;
+				ptorque[b] -= torque_interaction;
+			}
+		}
+	}
+}
+
+// The same as RepulsiveParticle::Move. The noises are drawn first, then all particles of all replicas are moved in one loop.
+void Ensemble::Move()
+{
+	for (int r = 0; r < R; r++)
+		for (int i = 0; i < N; i++)
+			noise[Index(i,r)] = gsl_ran_gaussian(rng[r], Particle::noise_amplitude);
+
+	#pragma omp simd
+	for (int n = 0; n < N*R; n++)
+	{
+		#ifdef COMPARE
+			torque[n] = round(digits*torque[n])/digits;
+		#endif
+		torque[n] = torque[n] + noise[n];
+		theta[n] += torque[n]*dt;
+		#ifdef COMPARE
+			theta[n] = round(digits*theta[n])/digits;
+		#endif
+		Real vx = cos(theta[n]);
+		Real vy = sin(theta[n]);
+		#ifdef COMPARE
+			vx = round(digits*vx)/digits;
+			vy = round(digits*vy)/digits;
+			fx[n] = round(digits*fx[n])/digits;
+			fy[n] = round(digits*fy[n])/digits;
+		#endif
+		vx *= Particle::speed;
+		vy *= Particle::speed;
+		vx += fx[n];
+		vy += fy[n];
+		x[n] += vx*dt;
+		y[n] += vy*dt;
+		x[n] -= Lx2*((int) (x[n] / Lx));
+		y[n] -= Ly2*((int) (y[n] / Ly));
+	}
+	Reset();
+}
+
+void Ensemble::One_Step()
+{
+	Interact();
+	Move();
+}
+
+void Ensemble::Multi_Step(int steps)
+{
+	for (int i = 0; i < steps; i++)
+	{
+		Interact();
+		Move();
+	}
+	Update_Cells();
+}
+
+void Ensemble::Save(int r, std::ostream& os) const
+{
+	os.write((char*) &N, sizeof(N) / sizeof(char));
+	for (int i = 0; i < N; i++)
+	{
+		C2DVector p, v;
+		p.x = x[Index(i,r)];
+		p.y = y[Index(i,r)];
+		v.x = cos(theta[Index(i,r)]);
+		v.y = sin(theta[Index(i,r)]);
+		p.write(os);
+		v.write(os);
+	}
+}
+
+#endif
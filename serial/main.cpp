@@ -14,7 +14,7 @@ inline void timing_information(clock_t start_time, int i_step, int total_step)
 }
 
 
-inline void equilibrium(Box* box, int equilibrium_step, int saving_period, ofstream& out_file)
+inline void equilibrium(Box* box, int equilibrium_step, int saving_period, Trajectory& out_file)
 {
 	clock_t start_time = clock();
 	cout << "equilibrium:" << endl;
@@ -28,7 +28,7 @@ inline void equilibrium(Box* box, int equilibrium_step, int saving_period, ofstr
 }
 
 
-inline void data_gathering(Box* box, int total_step, int saving_period, ofstream& out_file)
+inline void data_gathering(Box* box, int total_step, int saving_period, Trajectory& out_file)
 {
 	clock_t start_time = clock();
 
@@ -101,10 +101,11 @@ int main(int argc, char *argv[])
 	stringstream address;
 	address.str("");
 	address << box.info.str() << "-r-v.bin";
-	ofstream out_file(address.str().c_str());
+	Trajectory out_file;
+	out_file.Open(address.str());
 
 	equilibrium(&box, equilibrium_step, saving_period, out_file);
 	data_gathering(&box, total_step, saving_period, out_file);
-	out_file.close();
+	out_file.Close();
 }
 
@@ -2,9 +2,12 @@
 #include "../shared/c2dvector.h"
 #include "../shared/particle.h"
 #include "../shared/cell.h"
+#include "../shared/set-up.h"
 #include "box.h"
 
 #include "mpi.h"
+#include <vector>
+#include <cstdio>
 
 inline void timing_information(clock_t start_time, int i_step, int total_step)
 {
@@ -15,7 +18,7 @@ inline void timing_information(clock_t start_time, int i_step, int total_step)
 }
 
 
-inline Real equilibrium(Box* box, int equilibrium_step, int saving_period, ofstream& out_file)
+inline Real equilibrium(Box* box, int equilibrium_step, int saving_period, Trajectory& out_file)
 {
 	clock_t start_time, end_time;
 	start_time = clock();
@@ -36,7 +39,7 @@ inline Real equilibrium(Box* box, int equilibrium_step, int saving_period, ofstr
 }
 
 
-inline Real data_gathering(Box* box, int total_step, int saving_period, ofstream& out_file)
+inline Real data_gathering(Box* box, int total_step, int saving_period, Trajectory& out_file)
 {
 	clock_t start_time, end_time;
 	start_time = clock();
@@ -80,103 +83,278 @@ inline Real data_gathering(Box* box, int total_step, int saving_period, ofstream
 	return(t);
 }
 
-bool Chek_Seeds(long int seed, int thisnode, int totalnodes)
+// Each realization is a task. The master node (node 0) hands out the tasks to the other nodes on demand, so a node that finishes early takes the next task instead of waiting for the others. The tasks are given longest first (Task::Cost) to have less waiting at the end.
+// The list of tasks is saved in a manifest file, the state of each task is written when it is finished. If the program is stopped, it continues from the tasks that are not finished when it is run again with the same arguments or the manifest.
+struct Task{
+	Real rho, g, alpha, noise;
+	long int seed; // Each task has its own seed, so the realization does not depend on the node that simulates it.
+	int done;
+
+	Real Cost() const; // Expected time of the task (arbitrary unit)
+};
+
+Real Task::Cost() const
 {
-	long int s[totalnodes];
-	bool b;
-	int int_b;
-	MPI_Status status;
-	if (thisnode == 0)
-	{
-		s[0] = seed;
-		for (int i = 1; i < totalnodes; i++)
-			MPI_Recv(&s[i],1,MPI_LONG_INT,i,1,MPI_COMM_WORLD, &status);
-	}
-	else
-		MPI_Send(&seed,1,MPI_LONG_INT,0,1,MPI_COMM_WORLD);
+	Real N = Lx2*Ly2*rho;
+	return (N*(equilibrium_step + total_step)*rho); // The number of interactions of each particle is proportional to the density.
+}
 
-	MPI_Barrier(MPI_COMM_WORLD);
+// Tasks with higher cost come first, with equal cost, lower noise comes first because ordered systems with lower noise have denser clusters.
+bool Longer_Task(const Task& a, const Task& b)
+{
+	if (a.Cost() != b.Cost())
+		return (a.Cost() > b.Cost());
+	return (a.noise < b.noise);
+}
 
-	if (thisnode == 0)
+bool Read_Manifest(const string name, vector<Task>& task)
+{
+	ifstream file(name.c_str());
+	if (!file.is_open())
+		return false;
+	task.clear();
+	string line;
+	while (getline(file, line))
 	{
-		b = true;
-		for (int i = 0; i < totalnodes; i++)
-			for (int j = i+1; j < totalnodes; j++)
-				b = b && (s[i] != s[j]);
-		int_b = b;
-		for (int i = 1; i < totalnodes; i++)
-			MPI_Send(&int_b,1,MPI_INT,i,1,MPI_COMM_WORLD);
-	}
-	else
-	{
-		MPI_Recv(&int_b,1,MPI_INT,0,1,MPI_COMM_WORLD, &status);
-		if (int_b == 1)
-			b = true;
-		else
-			b = false;
+		if (line.empty() || line[0] == '#')
+			continue;
+		Task t;
+		stringstream ss(line);
+		if (ss >> t.rho >> t.g >> t.alpha >> t.noise >> t.seed >> t.done)
+			task.push_back(t);
 	}
+	return true;
+}
 
-	MPI_Barrier(MPI_COMM_WORLD);
+// A manifest is continued only if its tasks are the tasks of the arguments, the same parameters in the same order. The seeds and the states are not compared.
+bool Same_Tasks(const vector<Task>& a, const vector<Task>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (int i = 0; i < a.size(); i++)
+		if (a[i].rho != b[i].rho || a[i].g != b[i].g || a[i].alpha != b[i].alpha || a[i].noise != b[i].noise)
+			return false;
+	return true;
+}
 
-	return (b);
+// The manifest is written to a temporary file and renamed, so a stop during the writing does not destroy the manifest.
+void Write_Manifest(const string name, const vector<Task>& task)
+{
+	string temp_name = name + ".tmp";
+	ofstream file(temp_name.c_str());
+	file << "# rho g alpha noise seed done" << endl;
+	file << setprecision(17);
+	for (int i = 0; i < task.size(); i++)
+		file << task[i].rho << "\t" << task[i].g << "\t" << task[i].alpha << "\t" << task[i].noise << "\t" << task[i].seed << "\t" << task[i].done << endl;
+	file.close();
+	rename(temp_name.c_str(), name.c_str());
 }
 
-int main(int argc, char *argv[])
+void Init(Box* box, const Task& task)
 {
-	int thisnode, totalnodes;
-	MPI_Status status;
-	MPI_Init(&argc, &argv);
+	box->density = task.rho;
+	box->N = (int) round(Lx2*Ly2*box->density);
+
+	Particle::noise_amplitude = task.noise / sqrt(dt);
+	ContinuousParticle::g = task.g;
+	ContinuousParticle::alpha = task.alpha;
+	RepulsiveParticle::g = task.g; // The same g as ensemble-main.cpp sets for the repulsive particles
+
+	gsl_rng_set(C2DVector::gsl_r, task.seed);
+	C2DVector::rand_seed = task.seed; // The seed of the task is in the header of its trajectory (like Init_Rand, the generator is not allocated again).
+	Random_Formation(box->particle, box->N, 0); // Positioning partilces Randomly, but distant from walls (the last argument is the distance from walls)
+
+	#ifndef PERIODIC_BOUNDARY_CONDITION
+		box->geometry.Reset(); // The box is reused by the next tasks of the worker.
+		box->geometry.Add_Wall(Lx, Ly, Lx, -Ly);
+		box->geometry.Add_Wall(Lx, -Ly, -Lx, -Ly);
+		box->geometry.Add_Wall(-Lx, -Ly, -Lx, Ly);
+		box->geometry.Add_Wall(-Lx, Ly, Lx, Ly);
+	#endif
+
+	box->Update_Cells();
+
+	box->info.str("");
+	box->info << "rho=" << box->density <<  "-g=" << ContinuousParticle::g << "-alpha=" << ContinuousParticle::alpha << "-noise=" << task.noise;
+}
 
-	int number_of_realizations = argc - 4;
-	Real input_rho = atof(argv[1]);
-	Real input_g = atof(argv[2]);
-	Real input_alpha = atof(argv[3]);
+void Run_Task(Box* box, const Task& task, int index, int thisnode)
+{
+	Init(box, task);
+	cout << "From processor " << thisnode << " Box information is: " << box->info.str() << endl;
+	stringstream address;
+	address.str("");
+	address << box->info.str() << "-r-v.bin";
+	Trajectory out_file;
+	out_file.Open(address.str());
 
-	Real noise_list[number_of_realizations];
-	for (int i = 0; i < number_of_realizations; i++)
-		noise_list[i] = atof(argv[i + 4]);
+	Real t_eq = equilibrium(box, equilibrium_step, saving_period, out_file);
+	cout << index << "	From node: " << thisnode << "\t" << "elapsed time of equilibrium is \t" << t_eq << endl;
 
-	MPI_Comm_size(MPI_COMM_WORLD, &totalnodes);
-	MPI_Comm_rank(MPI_COMM_WORLD, &thisnode);
+	Real t_sim = data_gathering(box, total_step, saving_period, out_file);
+	cout << index << "	From node: " << thisnode << "\t" << "elapsed time of simulation is \t" << t_sim << endl;
 
-	long int seed = 0 + thisnode*112488;
+	out_file.Close();
+}
+
+const int request_tag = 1; // worker -> master: index of the finished task or -1
+const int task_tag = 2; // master -> worker: index of the next task or -1 to stop
 
-	while (!Chek_Seeds(seed, thisnode, totalnodes))
+void Master(const string manifest_name, vector<Task>& task, int totalnodes, Box* box)
+{
+	vector<int> order; // Unfinished tasks, longest first
+	for (int i = 0; i < task.size(); i++)
+		if (!task[i].done)
+			order.push_back(i);
+	stable_sort(order.begin(), order.end(), [&task](int a, int b){return Longer_Task(task[a], task[b]);});
+	cout << order.size() << " of " << task.size() << " tasks are not finished" << endl;
+
+	int next = 0;
+// A single process does all tasks itself.
+	if (totalnodes == 1)
 	{
-		seed = time(NULL) + thisnode*112488;
-		MPI_Barrier(MPI_COMM_WORLD);		
+		for (; next < order.size(); next++)
+		{
+			Run_Task(box, task[order[next]], order[next], 0);
+			task[order[next]].done = 1;
+			Write_Manifest(manifest_name, task);
+		}
+		return;
 	}
 
+	int workers = totalnodes - 1;
+	while (workers > 0)
+	{
+		int finished;
+		MPI_Status status;
+		MPI_Recv(&finished, 1, MPI_INT, MPI_ANY_SOURCE, request_tag, MPI_COMM_WORLD, &status);
+		if (finished >= 0)
+		{
+			task[finished].done = 1;
+			Write_Manifest(manifest_name, task);
+		}
 
-	C2DVector::Init_Rand(seed);
-
-	Real t_eq,t_sim;
+		int index = -1;
+		if (next < order.size())
+			index = order[next++];
+		else
+			workers--;
+		MPI_Send(&index, 1, MPI_INT, status.MPI_SOURCE, task_tag, MPI_COMM_WORLD);
+		if (index >= 0)
+			MPI_Send(&task[index], sizeof(Task), MPI_BYTE, status.MPI_SOURCE, task_tag, MPI_COMM_WORLD);
+	}
+}
 
-	Box box;
+void Worker(int thisnode, Box* box)
+{
+	int finished = -1;
+	while (true)
+	{
+		int index;
+		MPI_Send(&finished, 1, MPI_INT, 0, request_tag, MPI_COMM_WORLD);
+		MPI_Recv(&index, 1, MPI_INT, 0, task_tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		if (index < 0)
+			return;
+		Task task;
+		MPI_Recv(&task, sizeof(Task), MPI_BYTE, 0, task_tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		Run_Task(box, task, index, thisnode);
+		finished = index;
+	}
+}
 
-	for (int i = 0; i < number_of_realizations; i++)
+// The tasks of the arguments (or of the manifest that is given), node 0 calls it. It returns false if the arguments or the manifest are not valid.
+bool Make_Tasks(int argc, char *argv[], string& manifest_name, vector<Task>& task)
+{
+	if (argc == 2)
 	{
-		if ((i % totalnodes) == thisnode)
+		manifest_name = argv[1];
+		if (!Read_Manifest(manifest_name, task))
 		{
-			box.Init(input_rho, input_g, input_alpha, noise_list[i]);
-			cout << "From processor " << thisnode << " Box information is: " << box.info.str() << endl;
-			stringstream address;
-			address.str("");
-			address << box.info.str() << "-r-v.bin";
-			ofstream out_file(address.str().c_str());
-
-			t_eq = equilibrium(&box, equilibrium_step, saving_period, out_file);
-			cout << i << "	From node: " << thisnode << "\t" << "elapsed time of equilibrium is \t" << t_eq << endl;
+			cout << "Can not open the manifest " << manifest_name << endl;
+			return false;
+		}
+	}
+	else
+	{
+		if (argc < 5)
+		{
+			cout << "Usage: mpirun -np num_process a.out rho g alpha noise_1 noise_2 ... or mpirun -np num_process a.out manifest" << endl;
+			return false;
+		}
+		stringstream address;
+		address << "rho=" << atof(argv[1]) << "-g=" << atof(argv[2]) << "-alpha=" << atof(argv[3]) << "-tasks.txt";
+		manifest_name = address.str();
 
-			t_sim = data_gathering(&box, total_step, saving_period, out_file);
-			cout << i << "	From node: " << thisnode << "\t" << "elapsed time of simulation is \t" << t_sim << endl;
+		vector<Task> arguments;
+		for (int i = 4; i < argc; i++)
+		{
+			Task t;
+			t.rho = atof(argv[1]);
+			t.g = atof(argv[2]);
+			t.alpha = atof(argv[3]);
+			t.noise = atof(argv[i]);
+			#ifdef COMPARE
+				t.seed = seed + (i-4)*112488;
+			#else
+				t.seed = time(NULL) + (i-4)*112488;
+			#endif
+			t.done = 0;
+			arguments.push_back(t);
+		}
 
-			out_file.close();
+// The manifest of an earlier run with the same arguments is continued. A manifest of other noises (or other parameters) is written again.
+		if (Read_Manifest(manifest_name, task) && Same_Tasks(task, arguments))
+			cout << "Continuing " << manifest_name << endl;
+		else
+		{
+			if (task.size() > 0)
+				cout << "The tasks of " << manifest_name << " are not the tasks of the arguments, a new manifest is started" << endl;
+			task = arguments;
+			Write_Manifest(manifest_name, task);
 		}
+	}
+	return true;
+}
+
+// To run:
+// mpirun -np num_process a.out rho g alpha noise_1 noise_2 ...
+// or, with a manifest that is written before (each line is "rho g alpha noise seed done"):
+// mpirun -np num_process a.out manifest
+// Node 0 only hands out the tasks when there is more than one process.
+int main(int argc, char *argv[])
+{
+	int thisnode, totalnodes;
+	MPI_Init(&argc, &argv);
+
+	MPI_Comm_size(MPI_COMM_WORLD, &totalnodes);
+	MPI_Comm_rank(MPI_COMM_WORLD, &thisnode);
+
+	C2DVector::Init_Rand(seed); // The generator is seeded again for each task (Init).
+	static Box box; // Box is about the size of the default stack, so it must not be a local variable.
 
+	string manifest_name;
+	vector<Task> task;
+	int ok = 1;
+	if (thisnode == 0)
+		ok = Make_Tasks(argc, argv, manifest_name, task);
+// The workers wait for the result of node 0 before they ask for tasks, so all nodes stop if the arguments are not valid.
+	MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if (!ok)
+	{
+		MPI_Finalize();
+		exit(0);
 	}
 
+	if (thisnode != 0)
+	{
+		Worker(thisnode, &box);
+		MPI_Barrier(MPI_COMM_WORLD);
+		MPI_Finalize();
+		return 0;
+	}
+
+	Master(manifest_name, task, totalnodes, &box);
+
 	MPI_Barrier(MPI_COMM_WORLD);
 	MPI_Finalize();
 }
-
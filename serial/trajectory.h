@@ -0,0 +1,165 @@
+#ifndef _TRAJECTORY_
+#define _TRAJECTORY_
+
+#include "../shared/trajectory-format.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+// Trajectory is the output file of the serial program (shared/trajectory-format.h). The header is written with the first frame (operator<< in box.h) and the index of the frames when the file is closed.
+// The frames are written by a writer thread. The simulation copies x, y and theta of the particles to a free slot of a ring of buffers and goes on, the writer makes the floats of the frame (cos and sin of theta) and writes the frame in one piece, or a compressed block of frames with COMPRESSED_TRAJECTORY (shared/parameters.h). The ring is lock free for one simulation and one writer thread: head is the number of frames given by the simulation and tail the number of frames written, the slot of frame f is f % slots. The simulation only waits (stall) when all slots are full.
+struct Trajectory{
+	std::ofstream file;
+	Trajectory_Header header;
+	Frame_Writer frame_writer; // It is only used by the writer thread.
+	long int frames; // Number of frames that are given
+
+	std::vector<std::vector<double> > slot; // x, y, theta of each particle
+	std::vector<int> slot_N;
+	std::atomic<long int> head, tail;
+	std::atomic<bool> stop;
+	std::thread writer;
+
+	long int stalls; // Number of frames that waited for a free slot
+	double stall_time; // Seconds
+	int max_queued; // Most frames waiting to be written
+
+	Trajectory();
+	~Trajectory();
+
+	bool Open(const std::string name); // An old file with the same name is truncated like an ofstream.
+	void Close(); // Wait for the writer and write the index.
+	void Start(int N); // Write the header and make the slots for frames of N particles (called with the first frame).
+	double* Get_Slot(int N); // Free slot for the next frame, it waits if the ring is full.
+	void Push(); // Give the frame of the last Get_Slot to the writer.
+	void Write_Frames(); // The writer thread
+	void Print_Statistics();
+};
+
+Trajectory::Trajectory()
+{
+	frames = 0;
+	head = tail = 0;
+	stop = false;
+	stalls = 0;
+	stall_time = 0;
+	max_queued = 0;
+}
+
+Trajectory::~Trajectory()
+{
+	Close();
+}
+
+bool Trajectory::Open(const std::string name)
+{
+	Close();
+	slot.clear();
+	slot_N.clear();
+	frames = 0;
+	head = tail = 0;
+	stop = false;
+	stalls = 0;
+	stall_time = 0;
+	max_queued = 0;
+	file.open(name.c_str(), std::ios::binary);
+	return file.is_open();
+}
+
+void Trajectory::Start(int N)
+{
+	#ifdef COMPRESSED_TRAJECTORY
+		header.codec = 1;
+	#endif
+	file.write((char*) &header, sizeof(header));
+	frame_writer.Init(header);
+
+	long int slot_bytes = 3*sizeof(double)*(long int) max(N, 1);
+	int slots = max(2, (int) min((long int) trajectory_ring_slots, trajectory_ring_memory / slot_bytes));
+	slot.resize(slots);
+	slot_N.resize(slots);
+	for (int i = 0; i < slots; i++)
+		slot[i].resize(3*N);
+	writer = std::thread(&Trajectory::Write_Frames, this);
+}
+
+double* Trajectory::Get_Slot(int N)
+{
+	long int f = head.load(std::memory_order_relaxed);
+	if (f - tail.load(std::memory_order_acquire) >= (long int) slot.size())
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		stalls++;
+		while (f - tail.load(std::memory_order_acquire) >= (long int) slot.size())
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		stall_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	int s = f % slot.size();
+	slot_N[s] = N;
+	slot[s].resize(3*N); // It only allocates if N is more than the N of the first frame.
+	frames++;
+	return slot[s].data();
+}
+
+void Trajectory::Push()
+{
+	long int f = head.load(std::memory_order_relaxed) + 1;
+	head.store(f, std::memory_order_release);
+	max_queued = max(max_queued, (int) (f - tail.load(std::memory_order_relaxed)));
+}
+
+// The writer sleeps when there is no frame. After stop it writes the frames that are left and ends.
+void Trajectory::Write_Frames()
+{
+	std::vector<float> buffer;
+	while (true)
+	{
+		long int f = tail.load(std::memory_order_relaxed);
+		if (f == head.load(std::memory_order_acquire))
+		{
+			if (stop.load(std::memory_order_acquire) && f == head.load(std::memory_order_acquire))
+				break;
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			continue;
+		}
+		int s = f % slot.size();
+		int N = slot_N[s];
+		const double* data = slot[s].data();
+		buffer.resize(4*N);
+		for (int i = 0; i < N; i++)
+		{
+			buffer[4*i] = (float) data[3*i];
+			buffer[4*i+1] = (float) data[3*i+1];
+			buffer[4*i+2] = (float) cos(data[3*i+2]);
+			buffer[4*i+3] = (float) sin(data[3*i+2]);
+		}
+		frame_writer.Write(file, buffer.data(), N);
+		tail.store(f + 1, std::memory_order_release);
+	}
+}
+
+void Trajectory::Close()
+{
+	if (!file.is_open())
+		return;
+	if (writer.joinable())
+	{
+		stop.store(true, std::memory_order_release);
+		writer.join();
+	}
+	if (frames > 0)
+		frame_writer.Close(file);
+	file.close();
+	if (frames > 0)
+		Print_Statistics();
+}
+
+void Trajectory::Print_Statistics()
+{
+	cout << "Trajectory: " << frames << " frames, " << slot.size() << " slots, at most " << max_queued << " frames waiting, " << stalls << " stalls (" << stall_time << " s)" << endl;
+}
+
+#endif
@@ -13,10 +13,12 @@ class C2DVector
 	public :
 		static const gsl_rng_type * T;
 		static gsl_rng * gsl_r;
+		static long int rand_seed; // The last seed of Init_Rand, it is saved in the header of the trajectory.
 		Real x,y;
 
 		static void Init_Rand (long int seed)
 		{
+			rand_seed = seed;
 			gsl_rng_env_setup();
 			T = gsl_rng_default;
 			gsl_r = gsl_rng_alloc (T);
@@ -214,6 +216,7 @@ class C2DVector
 
 const gsl_rng_type * C2DVector::T;
 gsl_rng * C2DVector::gsl_r;
+long int C2DVector::rand_seed = 0;
 
 class Index{
 public:
@@ -19,11 +19,12 @@ public:
 	void Delete();
 	void Add(int p); // Add a particle id to the list of pid of this cell.
 	void Clear_Neighbor_List(); // This will clean the neighbor list of particles inside this cell
-	void Neighbor_List(); // Adding neighboring particles to their list in a cell but each pair of close particles are presented only one time as a member of neighbor list of one of the pair particles.
-	void Neighbor_List(Cell* c); // Adding neighboring particles of different cells to the neighbor list of particles.
+	void Neighbor_List(Real radius = Particle::rv); // Adding neighboring particles to their list in a cell but each pair of close particles are presented only one time as a member of neighbor list of one of the pair particles.
+	void Neighbor_List(Cell* c, Real radius = Particle::rv); // Adding neighboring particles of different cells to the neighbor list of particles.
 	void Interact(); // Interacting using nieghbor list. Particles outside of this cell are also considered.
 	void Interact(Cell* c); // Interact all particles wihtin this cell with the cell c
 	void Self_Interact(); // Interact all particles within this cell with themselve
+	void Pair_Interact(int a, int b); // Interaction of particle a with particle b, the tangent vectors (tangent.h) of the pair are linearized in the same pass.
 	void Move();
 };
 
@@ -58,7 +59,7 @@ void Cell::Clear_Neighbor_List()
 		particle[pid[i]].neighbor_id.clear();
 }
 
-void Cell::Neighbor_List(Cell* c)
+void Cell::Neighbor_List(Cell* c, Real radius)
 {
 	for (int i = 0; i < pid.size(); i++)
 	{
@@ -69,13 +70,13 @@ void Cell::Neighbor_List(Cell* c)
 				dr.Periodic_Transform();
 			#endif
 			Real d = sqrt(dr.Square());
-			if (d < Particle::rv)
+			if (d < radius)
 				particle[pid[i]].neighbor_id.push_back(c->pid[j]);
 		}
 	}
 }
 
-void Cell::Neighbor_List()
+void Cell::Neighbor_List(Real radius)
 {
 	for (int i = 0; i < pid.size(); i++)
 	{
@@ -83,7 +84,7 @@ void Cell::Neighbor_List()
 		{
 			C2DVector dr = particle[pid[i]].r - particle[pid[j]].r;
 			Real d = sqrt(dr.Square());
-			if (d < Particle::rv)
+			if (d < radius)
 				particle[pid[i]].neighbor_id.push_back(pid[j]);
 		}
 	}
@@ -93,7 +94,7 @@ void Cell::Interact()
 {
 	for (int i = 0; i < pid.size(); i++)
 		for (int j = 0; j < particle[pid[i]].neighbor_id.size(); j++)
-			particle[pid[i]].Interact(particle[particle[pid[i]].neighbor_id[j]]);
+			Pair_Interact(pid[i], particle[pid[i]].neighbor_id[j]);
 }
 
 void Cell::Interact(Cell* c)
@@ -101,7 +102,7 @@ void Cell::Interact(Cell* c)
 	for (int i = 0; i < pid.size(); i++)
 	{
 		for (int j = 0; j < c->pid.size(); j++)
-			particle[pid[i]].Interact(particle[c->pid[j]]);
+			Pair_Interact(pid[i], c->pid[j]);
 	}
 }
 
@@ -110,14 +111,25 @@ void Cell::Self_Interact()
 	for (int i = 0; i < pid.size(); i++)
 	{
 		for (int j = i+1; j < pid.size(); j++)
-			particle[pid[i]].Interact(particle[pid[j]]);
+			Pair_Interact(pid[i], pid[j]);
 	}
 }
 
+inline void Cell::Pair_Interact(int a, int b)
+{
+	particle[a].Interact(particle[b]);
+	if (Tangent::num)
+		particle[a].Tangent_Interact(particle[b], Tangent::Of(a), Tangent::Of(b), Tangent::Sum_Of(a), Tangent::Sum_Of(b));
+}
+
 void Cell::Move()
 {
 	for (int i = 0; i < pid.size(); i++)
+	{
 		particle[pid[i]].Move();
+		if (Tangent::num)
+			particle[pid[i]].Tangent_Move(Tangent::Of(pid[i]), Tangent::Sum_Of(pid[i]));
+	}
 }
 
 C2DVector Cell::dim;
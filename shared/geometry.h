@@ -29,6 +29,7 @@ Geometry::Geometry()
 void Geometry::Reset()
 {
 	wall_num = 0;
+	total_length = 0;
 }
 
 void Geometry::Add_Wall(C2DVector point_1, C2DVector point_2)
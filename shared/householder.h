@@ -0,0 +1,137 @@
+#ifndef _HOUSEHOLDER_
+#define _HOUSEHOLDER_
+
+#include "parameters.h"
+#include <vector>
+#include <gsl/gsl_cblas.h>
+
+// Blocked Householder QR of a tall matrix (rows >= cols) in column major order, like LAPACK dgeqrf and dorgqr. Each panel of qr_block columns is factorized column by column, then the rest of the matrix is updated by the compact WY form of the panel, I - V T V^t, with matrix products (cblas), that is most of the work for many columns.
+const int qr_block = 32;
+
+// Householder reflection of column j (row j and below), H = I - tau v v^t with v[0] = 1. v is written below the diagonal and beta (the diagonal of R) on it.
+inline Real Householder_Reflector(int rows, Real* column, int j)
+{
+	Real alpha = column[j];
+	Real norm2 = 0;
+	for (int i = j+1; i < rows; i++)
+		norm2 += column[i]*column[i];
+	if (norm2 == 0)
+		return 0;
+	Real beta = -copysign(sqrt(alpha*alpha + norm2), alpha);
+	Real scale = 1 / (alpha - beta);
+	for (int i = j+1; i < rows; i++)
+		column[i] *= scale;
+	column[j] = beta;
+	return ((beta - alpha) / beta);
+}
+
+// Make V (unit lower trapezoid) and T (upper triangular, like dlarft) of the panel of columns k to k+b of the factorized matrix a.
+inline void Householder_Panel_WY(int rows, int b, int k, const Real* a, const Real* tau, std::vector<Real>& v, std::vector<Real>& t)
+{
+	int m = rows - k;
+	v.assign(m*b, 0);
+	t.assign(b*b, 0);
+	for (int c = 0; c < b; c++)
+	{
+		v[c*m + c] = 1;
+		for (int i = c+1; i < m; i++)
+			v[c*m + i] = a[(k+c)*rows + k + i];
+	}
+	std::vector<Real> w(b);
+	for (int c = 0; c < b; c++)
+	{
+// T(0:c, c) = -tau_c T(0:c, 0:c) V(:, 0:c)^t v_c
+		for (int p = 0; p < c; p++)
+		{
+			w[p] = 0;
+			for (int i = c; i < m; i++)
+				w[p] += v[p*m + i]*v[c*m + i];
+		}
+		for (int p = 0; p < c; p++)
+		{
+			Real sum = 0;
+			for (int q = p; q < c; q++)
+				sum += t[q*b + p]*w[q];
+			t[c*b + p] = -tau[k+c]*sum;
+		}
+		t[c*b + c] = tau[k+c];
+	}
+}
+
+// Replace a (rows by cols) with the orthonormal Q of its QR factorization and put the diagonal of R in diagonal. The signs are chosen to have a positive diagonal, then Q and R are the same as the modified Gram-Schmidt of the columns.
+void Householder_QR(int rows, int cols, Real* a, Real* diagonal)
+{
+	if (cols > rows)
+	{
+		cout << "Error: QR factorization needs at least as many rows as columns" << endl;
+		exit(0);
+	}
+	std::vector<Real> tau(cols, 0);
+	int blocks = (cols + qr_block - 1) / qr_block;
+	std::vector<std::vector<Real> > v(blocks), t(blocks);
+	std::vector<Real> w;
+
+	for (int n = 0; n < blocks; n++)
+	{
+		int k = n*qr_block;
+		int b = min(qr_block, cols - k);
+		int m = rows - k;
+// Panel factorization, each reflector is applied to the next columns of the panel.
+		for (int j = k; j < k + b; j++)
+		{
+			tau[j] = Householder_Reflector(rows, &a[j*rows], j);
+			for (int c = j+1; c < k + b; c++)
+			{
+				Real dot = a[c*rows + j];
+				for (int i = j+1; i < rows; i++)
+					dot += a[j*rows + i]*a[c*rows + i];
+				dot *= tau[j];
+				a[c*rows + j] -= dot;
+				for (int i = j+1; i < rows; i++)
+					a[c*rows + i] -= dot*a[j*rows + i];
+			}
+		}
+		Householder_Panel_WY(rows, b, k, a, tau.data(), v[n], t[n]);
+
+// Trailing update A2 = (I - V T^t V^t) A2
+		int rest = cols - k - b;
+		if (rest > 0)
+		{
+			Real* a2 = &a[(k+b)*rows + k];
+			w.resize(b*rest);
+			cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, b, rest, m, 1.0, v[n].data(), m, a2, rows, 0.0, w.data(), b);
+			cblas_dtrmm(CblasColMajor, CblasLeft, CblasUpper, CblasTrans, CblasNonUnit, b, rest, 1.0, t[n].data(), b, w.data(), b);
+			cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, m, rest, b, -1.0, v[n].data(), m, w.data(), b, 1.0, a2, rows);
+		}
+	}
+
+	for (int j = 0; j < cols; j++)
+		diagonal[j] = a[j*rows + j];
+
+// Q = H_1 H_2 ... H_cols applied to the first columns of the identity, from the last block to the first. Columns of Q before block k are zero in rows k and below, so only Q(k:, k:) changes.
+	for (int j = 0; j < cols; j++)
+		for (int i = 0; i < rows; i++)
+			a[j*rows + i] = (i == j) ? 1 : 0;
+	for (int n = blocks - 1; n >= 0; n--)
+	{
+		int k = n*qr_block;
+		int b = min(qr_block, cols - k);
+		int m = rows - k;
+		int rest = cols - k;
+		Real* q = &a[k*rows + k];
+		w.resize(b*rest);
+		cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, b, rest, m, 1.0, v[n].data(), m, q, rows, 0.0, w.data(), b);
+		cblas_dtrmm(CblasColMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit, b, rest, 1.0, t[n].data(), b, w.data(), b);
+		cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, m, rest, b, -1.0, v[n].data(), m, w.data(), b, 1.0, q, rows);
+	}
+
+	for (int j = 0; j < cols; j++)
+		if (diagonal[j] < 0)
+		{
+			diagonal[j] = -diagonal[j];
+			for (int i = 0; i < rows; i++)
+				a[j*rows + i] = -a[j*rows + i];
+		}
+}
+
+#endif
@@ -10,6 +10,14 @@
 //#define TRACK_PARTICLE
 // This will round torques to avoid any difference of this program and other versions caused by truncation of numbers (if we change order of a sum, the result will change because of the truncation error)
 //#define COMPARE
+// Nodes of the parallel program that are on the same computer read the particles of their boundaries from shared memory (MPI-3 shared window) instead of sending messages.
+#define SHARED_MEMORY_HALO
+// The parallel program sends the boundary data of each step compact (x and y as float offsets, theta as a 16 bit number, see parallel/boundary.h). It is not exact, the trajectory differs from the exact one after a while.
+//#define COMPACT_HALO
+// The serial program writes the trajectory compressed (shared/trajectory-codec.h) with positions of trajectory_position_bits bits of the box and angles of trajectory_angle_bits bits (see below).
+//#define COMPRESSED_TRAJECTORY
+// The Lyapunov exponents of a single box are found by the linearized dynamics (tangent vectors, tangent.h) in the same steps as the box, instead of evolving a perturbed copy of the box for each direction.
+#define LINEARIZED_LYAPUNOV
 
 #include <iostream>
 #include <iomanip>
@@ -56,6 +64,12 @@ Real dt = 0.005;
 Real half_dt = dt/2;
 const int cell_update_period = 20;
 const int saving_period = 10;
+const int checkpoint_period = 50; // Number of cell updates between two checkpoints of the parallel program
+// The frames of the trajectory are written in the background from a ring of at most trajectory_ring_slots buffers, and the buffers use at most trajectory_ring_memory bytes (at least two buffers are made). The simulation only waits when all buffers are still being written.
+const int trajectory_ring_slots = 8;
+const long int trajectory_ring_memory = 200000000;
+const int trajectory_position_bits = 16; // At most 24
+const int trajectory_angle_bits = 12; // At most 24
 const long int equilibrium_step = 30000;
 const long int total_step = 30000;
 
@@ -66,10 +80,15 @@ const int divisor_x = max_divisor_x;
 const int divisor_y = max_divisor_y;
 
 // Parallel Use only
-const int npx = 2; // For parallel use only. This number must be even to avoid dead locks
-const int npy = 2; // For parallel use only. This number must be even to avoid dead locks
 const int tag_max = 32767; // For parallel use only
 
+// Lyapunov with perturbed copies of the box (parallel): the unperturbed box makes the verlet lists of the pairs inside each node with a radius larger by lyapunov_skin and the perturbed boxes use them while they are closer than lyapunov_skin/2 to it. Zero switches it off. The narrowest cell must be at least rv + lyapunov_skin wide, otherwise the lists are not reused.
+const Real lyapunov_skin = 0.01;
+// Lyapunov: the exponents are averaged in batches of lyapunov_batch intervals and the computation stops when the error of every exponent is less than lyapunov_tolerance of the largest one, after at least lyapunov_min_batches batches. Zero tolerance runs the whole duration.
+const int lyapunov_batch = 100;
+const int lyapunov_min_batches = 10;
+const Real lyapunov_tolerance = 0.01;
+
 // Interactions
 const Real A_p = 1.;		// interaction strength
 const Real A_w = 50.;
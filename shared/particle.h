@@ -3,6 +3,7 @@
 
 #include "c2dvector.h"
 #include "parameters.h"
+#include "tangent.h"
 #include <vector>
 
 class BasicParticle0{
@@ -31,6 +32,8 @@ public:
 	virtual void Reset();
 	void Move();
 	void Interact();
+	void Tangent_Interact(BasicDynamicParticle& p, const Real* tangent_this, const Real* tangent_that, Real* sum_this, Real* sum_that);
+	void Tangent_Move(Real* tangent, Real* sum);
 };
 
 void BasicDynamicParticle::Init()
@@ -73,13 +76,30 @@ void BasicDynamicParticle::Init(C2DVector position, C2DVector velocity)
 
 void BasicDynamicParticle::Reset() {}
 
+// The particles that have linearized dynamics hide these functions.
+void BasicDynamicParticle::Tangent_Interact(BasicDynamicParticle& p, const Real* tangent_this, const Real* tangent_that, Real* sum_this, Real* sum_that)
+{
+	cout << "Error: the linearized dynamics (tangent vectors) is not implemented for this particle" << endl;
+	exit(0);
+}
+
+void BasicDynamicParticle::Tangent_Move(Real* tangent, Real* sum)
+{
+	cout << "Error: the linearized dynamics (tangent vectors) is not implemented for this particle" << endl;
+	exit(0);
+}
+
 class VicsekParticle: public BasicDynamicParticle {
 public:
 	Real average_theta;
 	void Move()
+	{
+		Move(gsl_ran_gaussian(C2DVector::gsl_r,noise_amplitude));
+	}
+	void Move(Real noise) // Move with a given noise. Used when the noise is drawn before (like the threaded parallel program).
 	{
 		average_theta /= neighbor_size;
-		theta = theta + average_theta + gsl_ran_gaussian(C2DVector::gsl_r,noise_amplitude);
+		theta = theta + average_theta + noise;
 		C2DVector old_v = v;
 		v.x = cos(theta);
 		v.y = sin(theta);
@@ -125,11 +145,15 @@ public:
 
 	ContinuousParticle();
 	void Move()
+	{
+		Move(gsl_ran_gaussian(C2DVector::gsl_r,noise_amplitude));
+	}
+	void Move(Real noise) // Move with a given noise. Used when the noise is drawn before (like the threaded parallel program).
 	{
 		#ifdef COMPARE
 			torque = round(digits*torque)/digits;
 		#endif
-		torque = g*torque + gsl_ran_gaussian(C2DVector::gsl_r,noise_amplitude);
+		torque = g*torque + noise;
 		theta += torque*dt;
 //		theta -= 2*PI * ((int) (theta / (PI)));
 		C2DVector old_v = v;
@@ -221,11 +245,15 @@ public:
 
 	MarkusParticle();
 	void Move()
+	{
+		Move(gsl_ran_gaussian(C2DVector::gsl_r,noise_amplitude));
+	}
+	void Move(Real noise) // Move with a given noise. Used when the noise is drawn before (like the threaded parallel program).
 	{
 		#ifdef COMPARE
 			torque = round(digits*torque)/digits;
 		#endif
-		torque = torque + gsl_ran_gaussian(C2DVector::gsl_r,noise_amplitude);
+		torque = torque + noise;
 		theta += torque*dt;
 //		theta -= 2*PI * ((int) (theta / (PI)));
 		C2DVector old_v = v;
@@ -302,6 +330,85 @@ public:
 			#endif
 		}
 	}
+
+// Linearization of Interact. The sums of the linearized torques of all tangent vectors (Tangent::num) of the pair are added to sum_this and sum_that, the tangent vectors and the sums are in the layout of Tangent.
+	void Tangent_Interact(MarkusParticle& p, const Real* tangent_this, const Real* tangent_that, Real* sum_this, Real* sum_that)
+	{
+		C2DVector dr = r - p.r;
+		#ifdef PERIODIC_BOUNDARY_CONDITION
+			dr.Periodic_Transform();
+		#endif
+		Real d2 = dr.Square();
+		Real d = sqrt(d2);
+		if (d >= kisi)
+			return;
+
+// Derivatives of the alignment torque with respect to dr and the angles
+		C2DVector grad_dr;
+		Real grad_theta;
+		if (d < kisi_a)
+		{
+			Real s = sin(p.theta - theta);
+			grad_dr = dr*(-2*mu_plus*s/(kisi_a*kisi_a));
+			grad_theta = -mu_plus*(1-(d2/(kisi_a*kisi_a)))*cos(p.theta - theta); // with respect to theta, it is negative of the one of p.theta
+		}
+		else
+		{
+			Real c = mu_minus*4 / ((1-kisi_a)*(1-kisi_a));
+			grad_dr = dr*(c*(1 + kisi_a - 2*d)*sin(theta - p.theta)/d);
+			grad_theta = c*(d - kisi_a)*(1-d)*cos(theta - p.theta);
+		}
+
+// Derivatives of the repulsion torques
+		bool repulsion = (d < kisi_r);
+		Real alpha = 0, factor = 0, cos_this = 0, cos_that = 0, sin_this = 0, sin_that = 0;
+		if (repulsion)
+		{
+			alpha = atan2(-dr.y,-dr.x);
+			factor = (1.0 - d / kisi_r);
+			sin_this = sin(theta - alpha);
+			sin_that = sin(p.theta - alpha);
+			cos_this = cos(theta - alpha);
+			cos_that = cos(p.theta - alpha);
+		}
+
+		for (int i = 0; i < Tangent::num; i++)
+		{
+			const Real* a = tangent_this + 3*i;
+			const Real* b = tangent_that + 3*i;
+			Real ddx = a[0] - b[0];
+			Real ddy = a[1] - b[1];
+			Real dtheta = a[2] - b[2];
+
+			Real torque_interaction = grad_dr.x*ddx + grad_dr.y*ddy + grad_theta*dtheta;
+			sum_this[3*i+2] += torque_interaction;
+			sum_that[3*i+2] -= torque_interaction;
+
+			if (repulsion)
+			{
+				Real dfactor = -(dr.x*ddx + dr.y*ddy) / (d*kisi_r);
+				Real dalpha = (dr.x*ddy - dr.y*ddx) / d2;
+				sum_this[3*i+2] += kapa*(dfactor*sin_this + factor*cos_this*(a[2] - dalpha));
+				sum_that[3*i+2] -= kapa*(dfactor*sin_that + factor*cos_that*(b[2] - dalpha));
+			}
+		}
+	}
+
+// Linearization of Move, it is called after Move (theta is the new angle). The noise is additive so it does not change the tangent vectors. The sums are nulled for the next step.
+	void Tangent_Move(Real* tangent, Real* sum)
+	{
+		Real vx = -sin(theta)*dt*speed;
+		Real vy = cos(theta)*dt*speed;
+		for (int i = 0; i < Tangent::num; i++)
+		{
+			Real* a = tangent + 3*i;
+			Real* s = sum + 3*i;
+			a[2] += s[2]*dt;
+			a[0] += vx*a[2];
+			a[1] += vy*a[2];
+			s[0] = s[1] = s[2] = 0;
+		}
+	}
 };
 
 MarkusParticle::MarkusParticle()
@@ -332,11 +439,15 @@ public:
 
 	RepulsiveParticle();
 	void Move()
+	{
+		Move(gsl_ran_gaussian(C2DVector::gsl_r,noise_amplitude));
+	}
+	void Move(Real noise) // Move with a given noise. Used when the noise is drawn before (like the threaded parallel program).
 	{
 		#ifdef COMPARE
 			torque = round(digits*torque)/digits;
 		#endif
-		torque = torque + gsl_ran_gaussian(C2DVector::gsl_r,noise_amplitude);
+		torque = torque + noise;
 		theta += torque*dt;
 		C2DVector old_v = v;
 		#ifdef COMPARE
@@ -417,6 +528,74 @@ public:
 			#endif
 		}
 	}
+
+// Linearization of Interact. The sums of the linearized forces and torques of all tangent vectors (Tangent::num) of the pair are added to sum_this and sum_that, the tangent vectors and the sums are in the layout of Tangent.
+	void Tangent_Interact(RepulsiveParticle& p, const Real* tangent_this, const Real* tangent_that, Real* sum_this, Real* sum_that)
+	{
+		C2DVector dr = r - p.r;
+		#ifdef PERIODIC_BOUNDARY_CONDITION
+			dr.Periodic_Transform();
+		#endif
+		Real d2 = dr.Square();
+		Real d = sqrt(d2);
+
+		bool repulsion = (d < r_c_p);
+		bool alignment = (d < r_f_p);
+		if (!repulsion && !alignment)
+			return;
+
+		dr /= d;
+		Real magnitude = 0, dmagnitude = 0;
+		if (repulsion)
+		{
+			Real r_c_p2 = r_c_p*r_c_p;
+			Real e = exp(- d / sigma_p);
+			magnitude = A_p * ( e * ( 1. / d2 + 1. / (sigma_p * d)) - exp(- r_c_p / sigma_p ) * ( 1. / r_c_p2 + 1. / (sigma_p * r_c_p)) );
+			dmagnitude = -A_p * e * ( ( 1. / d2 + 1. / (sigma_p * d)) / sigma_p + 2. / (d2 * d) + 1. / (sigma_p * d2) ); // derivative of magnitude with respect to d
+		}
+		Real grad_theta = alignment ? g*cos(p.theta - theta)/(PI) : 0; // derivative of the torque with respect to p.theta
+
+		for (int i = 0; i < Tangent::num; i++)
+		{
+			const Real* a = tangent_this + 3*i;
+			const Real* b = tangent_that + 3*i;
+			if (repulsion)
+			{
+// The force is dr*magnitude(d) (dr is the unit vector), its change has a part perpendicular to dr and a part parallel to it.
+				Real ddx = a[0] - b[0];
+				Real ddy = a[1] - b[1];
+				Real dd = dr.x*ddx + dr.y*ddy;
+				Real interaction_x = magnitude*(ddx - dr.x*dd)/d + dr.x*dmagnitude*dd;
+				Real interaction_y = magnitude*(ddy - dr.y*dd)/d + dr.y*dmagnitude*dd;
+				sum_this[3*i] += interaction_x;
+				sum_this[3*i+1] += interaction_y;
+				sum_that[3*i] -= interaction_x;
+				sum_that[3*i+1] -= interaction_y;
+			}
+			if (alignment)
+			{
+				Real torque_interaction = grad_theta*(b[2] - a[2]);
+				sum_this[3*i+2] += torque_interaction;
+				sum_that[3*i+2] -= torque_interaction;
+			}
+		}
+	}
+
+// Linearization of Move, it is called after Move (theta is the new angle). The noise is additive so it does not change the tangent vectors. The sums are nulled for the next step.
+	void Tangent_Move(Real* tangent, Real* sum)
+	{
+		Real vx = -sin(theta)*dt*speed;
+		Real vy = cos(theta)*dt*speed;
+		for (int i = 0; i < Tangent::num; i++)
+		{
+			Real* a = tangent + 3*i;
+			Real* s = sum + 3*i;
+			a[2] += s[2]*dt;
+			a[0] += vx*a[2] + s[0]*dt;
+			a[1] += vy*a[2] + s[1]*dt;
+			s[0] = s[1] = s[2] = 0;
+		}
+	}
 };
 
 RepulsiveParticle::RepulsiveParticle()
@@ -21,6 +21,16 @@ void Clump_Formation(Particle* particle, int N, int size); // Positioning partic
 void Square_Ring_Formation(Particle* particle, int N); // Positioning particles in a square shape ring(the center is empty)
 void Star_Trap_Initialization(Geometry* geometry, int N_hands, Real half_delta); // Defining geometry of a star shaped trap
 
+// Formations of a single particle (the i'th particle of N). The random numbers are counter based (Counter_Random) and the particle only depends on its id and the seed, therefore each node of the parallel program can make the particles of its own cells without the other nodes and the result does not depend on the number of nodes.
+Real Counter_Random(long int seed, long int counter, int stream); // A random number in [0, 1) for the counter (particle id) and stream (which number of the particle).
+C2DVector Counter_Direction(long int seed, long int counter); // Random unit vector
+Real Counter_Gaussian(long int seed, long int counter); // Gaussian random number with unit variance (Box-Muller of streams 0 and 1)
+void Random_Formation(Particle& p, int i, double sigma, long int seed);
+void Triangle_Lattice_Formation(Particle& p, int i, int N, double sigma, long int seed);
+void Single_Vortex_Formation(Particle& p, int i, int N);
+void Four_Vortex_Formation(Particle& p, int i, int N);
+void Clump_Formation(Particle& p, int i, int size, long int seed); // The first size particles are the clump, the others are random.
+
 
 void Single_Vortex_Formation(Particle* particle, int N)
 {
@@ -244,6 +254,132 @@ void Square_Ring_Formation(Particle* particle, int N)
 	}
 }
 
+// The random number is the hash of (seed, counter, stream), there is no state of the generator. The hash is the mixing function of SplitMix64.
+unsigned long long Counter_Hash(unsigned long long x)
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+Real Counter_Random(long int seed, long int counter, int stream)
+{
+	unsigned long long h = Counter_Hash(Counter_Hash(Counter_Hash(seed) ^ counter) ^ stream);
+	return (h >> 11) * (1.0 / 9007199254740992.0); // 53 bits
+}
+
+C2DVector Counter_Direction(long int seed, long int counter)
+{
+	Real theta = 2*PI*Counter_Random(seed, counter, 2);
+	C2DVector v;
+	v.x = cos(theta);
+	v.y = sin(theta);
+	return v;
+}
+
+Real Counter_Gaussian(long int seed, long int counter)
+{
+	Real u1 = Counter_Random(seed, counter, 0);
+	Real u2 = Counter_Random(seed, counter, 1);
+	return (sqrt(-2*log(1 - u1))*cos(2*PI*u2));
+}
+
+void Random_Formation(Particle& p, int i, double sigma, long int seed)
+{
+	C2DVector r;
+	r.x = (2*Counter_Random(seed, i, 0) - 1)*(Lx-sigma);
+	r.y = (2*Counter_Random(seed, i, 1) - 1)*(Ly-sigma);
+	r.Periodic_Transform();
+	p.Init(r, Counter_Direction(seed, i));
+}
+
+void Triangle_Lattice_Formation(Particle& p, int i, int N, double sigma, long int seed)
+{
+	C2DVector r,basis_1, basis_2;
+	basis_1.x = 1;
+	basis_1.y = 0;
+	basis_2.x = 0.5;
+	basis_2.y = sqrt(3)/2;
+
+	int Nx = (int) sqrt((Lx*N*sqrt(3))/(2*Ly)) + 1;
+
+	basis_1 = basis_1*((Lx2 - 2*sigma) / Nx);
+	basis_2 = basis_2*((Lx2 - 2*sigma) / Nx);
+
+	r = basis_1*(i % Nx) + basis_2*(i / Nx) - basis_1*(i / (2*Nx));
+	r.x -= (Lx - sigma);
+	r.y -= (Ly - sigma);
+	p.Init(r, Counter_Direction(seed, i));
+}
+
+void Single_Vortex_Formation(Particle& p, int i, int N)
+{
+	Triangle_Lattice_Formation(p, i, N, 1, 0);
+	C2DVector v;
+	v.x = -(p.r.y);
+	v.y = (p.r.x);
+	v = v / sqrt(v.Square());
+	p.Init(p.r,v);
+}
+
+// The same as Four_Vortex_Formation, particle i is at column i % Nx and row i / Nx of the lattice.
+void Four_Vortex_Formation(Particle& p, int i, int N)
+{
+	C2DVector r,v;
+	int Nx = (int) sqrt(Lx*N/Ly) + 1;
+	int Ny = (int) sqrt(Ly*N/Lx) + 1;
+	int x = i % Nx;
+	int y = i / Nx;
+	r.x = -Lx + 2*x*(Lx/Nx) + Lx/Nx;
+	r.y = -Ly + 2*y*(Ly/Ny) + Ly/Ny;
+	if (x < Nx/2 && y < Ny/2)
+	{
+		v.x = -(2*(r.y/Lx) + 1);
+		v.y = (2*(r.x/Ly) + 1);
+	}
+	if (x >= Nx/2 && y < Ny/2)
+	{
+		v.x = (2*(r.y/Lx) + 1);
+		v.y = -(2*(r.x/Ly) - 1);
+	}
+	if (x < Nx/2 && y >= Ny/2)
+	{
+		v.x = (2*(r.y/Ly) - 1);
+		v.y = -(2*(r.x/Lx) + 1);
+	}
+	if (x >= Nx/2 && y >= Ny/2)
+	{
+		v.x = -(2*(r.y/Ly) - 1);
+		v.y = (2*(r.x/Lx) - 1);
+	}
+	p.Init(r,v);
+}
+
+void Clump_Formation(Particle& p, int i, int size, long int seed)
+{
+	if (i >= size)
+	{
+		Random_Formation(p, i, 0, seed);
+		return;
+	}
+
+	C2DVector r, basis_1, basis_2;
+	basis_1.x = 1;
+	basis_1.y = 0;
+	basis_2.x = 0.5;
+	basis_2.y = sqrt(3)/2;
+
+	int Nx = (int) sqrt(size*sqrt(3)/2) + 1;
+
+	basis_1 *= 0.9;
+	basis_2 *= 0.9;
+
+	r = basis_1*(i % Nx) + basis_2*(i / Nx) - basis_1*(i / (2*Nx));
+	r.Periodic_Transform();
+	p.Init(r, Counter_Direction(seed, -1)); // All particles of the clump have the same direction.
+}
+
 
 void Star_Trap_Initialization(Geometry* geometry, int N_hands, Real half_delta)
 {
@@ -0,0 +1,97 @@
+#ifndef _SNAPSHOT_
+#define _SNAPSHOT_
+
+#include "parameters.h"
+#include "particle.h"
+#include "cell.h"
+#include "tangent.h"
+#include "state-hyper-vector.h"
+#include <vector>
+#include <algorithm>
+
+// Image of the engine state of a box in memory: the particles of the cells, the cell lists, the verlet lists and the random generator. Box::Load of a snapshot continues exactly like the box that saved it without updating the cells or the neighbor lists, unlike Load of a state vector. The buffers are kept, so saving again to the same snapshot does not allocate memory.
+struct Box_Snapshot{
+	vector<int> cell_size; // Number of particles in each cell
+	vector<int> pid; // Particles of all cells in the order of the cells
+	vector<Real> data; // x, y, theta, v.x and v.y of each particle of pid
+	vector<int> neighbor_offset, neighbor_id; // Verlet list of particle pid[i] is neighbor_id[neighbor_offset[i]] to neighbor_id[neighbor_offset[i+1]]
+	vector<Real> tangent; // Tangent vectors of the particles of pid, if there are any.
+	vector<vector<int> > send_size, send_index; // Particles that each boundary sends (parallel box)
+	long int step, noise_step;
+	Rand_Snapshot rand;
+
+	Box_Snapshot();
+
+	void Save_Cells(const Cell* cell, int cell_num, const Particle* particle); // cell is the first of cell_num cells in memory (cell[divisor_x][divisor_y])
+	void Load_Cells(Cell* cell, int cell_num, Particle* particle) const;
+};
+
+Box_Snapshot::Box_Snapshot()
+{
+	step = noise_step = 0;
+}
+
+void Box_Snapshot::Save_Cells(const Cell* cell, int cell_num, const Particle* particle)
+{
+	cell_size.resize(cell_num);
+	pid.clear();
+	for (int c = 0; c < cell_num; c++)
+	{
+		cell_size[c] = cell[c].pid.size();
+		pid.insert(pid.end(), cell[c].pid.begin(), cell[c].pid.end());
+	}
+
+	data.resize(5*pid.size());
+	neighbor_offset.resize(pid.size() + 1);
+	neighbor_id.clear();
+	tangent.resize(3*Tangent::num*pid.size());
+	for (int i = 0; i < pid.size(); i++)
+	{
+		const Particle& p = particle[pid[i]];
+		data[5*i] = p.r.x;
+		data[5*i+1] = p.r.y;
+		data[5*i+2] = p.theta;
+		data[5*i+3] = p.v.x;
+		data[5*i+4] = p.v.y;
+		neighbor_offset[i] = neighbor_id.size();
+		neighbor_id.insert(neighbor_id.end(), p.neighbor_id.begin(), p.neighbor_id.end());
+		if (Tangent::num)
+			copy(Tangent::Of(pid[i]), Tangent::Of(pid[i]) + 3*Tangent::num, tangent.begin() + 3*Tangent::num*i);
+	}
+	neighbor_offset[pid.size()] = neighbor_id.size();
+}
+
+// The forces and torques are reset, a box is saved after a move when they are null.
+void Box_Snapshot::Load_Cells(Cell* cell, int cell_num, Particle* particle) const
+{
+	if (cell_num != cell_size.size())
+	{
+		cout << "Error: The snapshot is not saved from a box with the same cells" << endl;
+		exit(0);
+	}
+	int shift = 0;
+	for (int c = 0; c < cell_num; c++)
+	{
+		cell[c].pid.assign(pid.begin() + shift, pid.begin() + shift + cell_size[c]);
+		shift += cell_size[c];
+	}
+
+	for (int i = 0; i < pid.size(); i++)
+	{
+		Particle& p = particle[pid[i]];
+		p.r.x = data[5*i];
+		p.r.y = data[5*i+1];
+		p.theta = data[5*i+2];
+		p.v.x = data[5*i+3];
+		p.v.y = data[5*i+4];
+		p.Reset();
+		p.neighbor_id.assign(neighbor_id.begin() + neighbor_offset[i], neighbor_id.begin() + neighbor_offset[i+1]);
+		if (Tangent::num)
+		{
+			copy(tangent.begin() + 3*Tangent::num*i, tangent.begin() + 3*Tangent::num*(i+1), Tangent::Of(pid[i]));
+			Tangent::Reset(pid[i]);
+		}
+	}
+}
+
+#endif
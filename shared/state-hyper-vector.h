@@ -3,16 +3,14 @@
 
 #include "c2dvector.h"
 
+// State_Hyper_Vector is the position and angle of all particles, a state of the box or a deviation of a state. The arithmetic is in place (Difference, Add_Scaled, Scale, Set_Scaled) and does not allocate, the operators that return a new vector are kept for convenience. Each result is periodic transformed like the operators.
 class State_Hyper_Vector{
-	void Init_Random_Generator(int);
 public:
 	int N;
 	Real growth;
 	BasicParticle0* particle;
-	gsl_rng* gsl_r;
 
-	
-	State_Hyper_Vector(int, int);
+	State_Hyper_Vector(int);
 	State_Hyper_Vector(const State_Hyper_Vector&);
 	~State_Hyper_Vector();
 
@@ -25,12 +23,13 @@ public:
 	const State_Hyper_Vector operator/ (const Real factor);
 	const Real operator* (const State_Hyper_Vector& s1) const;
 
-
-	void Set_C2DVector_Rand_Generator() const;
-	void Get_C2DVector_Rand_Generator();
+	void Difference(const State_Hyper_Vector& a, const State_Hyper_Vector& b); // this = a - b
+	void Add_Scaled(const Real factor, const State_Hyper_Vector& s1); // this += factor*s1
+	void Set_Scaled(const Real factor, const State_Hyper_Vector& s1); // this = factor*s1
+	void Scale(const Real factor); // this *= factor
 
 	void Null();
-	void Rand(const Real position_amplitude, const Real angle_amplitude);
+	void Rand(const Real position_amplitude, const Real angle_amplitude, gsl_rng* gsl_r);
 	Real Square() const;
 	Real Magnitude() const;
 	void Periodic_Transform();
@@ -40,26 +39,35 @@ public:
 	friend std::ostream& operator<<(std::ostream& os, const State_Hyper_Vector& shv); // Save
 };
 
-void State_Hyper_Vector::Init_Random_Generator(int seed)
-{
-	const gsl_rng_type * T;
-	gsl_rng_env_setup();
-	gsl_rng_default_seed = seed;
-	T = gsl_rng_default;
-	gsl_r = gsl_rng_alloc (T);
-	gsl_rng_memcpy (gsl_r, C2DVector::gsl_r);
-}
+// Copy of the state of the random generator of C2DVector. It is kept with a saved state of the box (Box_State), the box continues with the same noises when the state is loaded.
+class Rand_Snapshot{
+public:
+	gsl_rng* gsl_r;
+
+	Rand_Snapshot();
+	Rand_Snapshot(const Rand_Snapshot&);
+	~Rand_Snapshot();
+
+	Rand_Snapshot& operator= (const Rand_Snapshot& rs);
+	void Set_C2DVector_Rand_Generator() const;
+	void Get_C2DVector_Rand_Generator();
+};
+
+// A saved state of the box (Box::Save and Box::Load), the state and the random generator.
+class Box_State: public State_Hyper_Vector{
+public:
+	Rand_Snapshot rand;
 
-State_Hyper_Vector::State_Hyper_Vector(int particle_number, int seed = 0) : N(particle_number)
+	Box_State(int particle_number) : State_Hyper_Vector(particle_number) {}
+};
+
+State_Hyper_Vector::State_Hyper_Vector(int particle_number) : N(particle_number)
 {
-	Init_Random_Generator(seed);
 	particle = new BasicParticle0[N];
 }
 
 State_Hyper_Vector::State_Hyper_Vector(const State_Hyper_Vector& sv) : N(sv.N)
 {
-	Init_Random_Generator(0);
-	gsl_rng_memcpy (gsl_r, sv.gsl_r);
 	particle = new BasicParticle0[N];
 	for (int i = 0; i < N; i++)
 		particle[i] = sv.particle[i];
@@ -67,19 +75,49 @@ State_Hyper_Vector::State_Hyper_Vector(const State_Hyper_Vector& sv) : N(sv.N)
 
 State_Hyper_Vector::~State_Hyper_Vector()
 {
-	gsl_rng_free(gsl_r);
 	delete [] particle;
 }
 
 State_Hyper_Vector& State_Hyper_Vector::operator= ( const State_Hyper_Vector& sv)
 {
-	gsl_rng_memcpy (gsl_r, sv.gsl_r);
 	for (int i = 0; i < N; i++)
 		particle[i] = sv.particle[i];
 	return *this;
 }
 
-// Alwayse retun random generator of the lhs
+Rand_Snapshot::Rand_Snapshot()
+{
+	gsl_r = gsl_rng_alloc(gsl_rng_default);
+	gsl_rng_memcpy(gsl_r, C2DVector::gsl_r);
+}
+
+Rand_Snapshot::Rand_Snapshot(const Rand_Snapshot& rs)
+{
+	gsl_r = gsl_rng_alloc(gsl_rng_default);
+	gsl_rng_memcpy(gsl_r, rs.gsl_r);
+}
+
+Rand_Snapshot::~Rand_Snapshot()
+{
+	gsl_rng_free(gsl_r);
+}
+
+Rand_Snapshot& Rand_Snapshot::operator= (const Rand_Snapshot& rs)
+{
+	gsl_rng_memcpy(gsl_r, rs.gsl_r);
+	return *this;
+}
+
+void Rand_Snapshot::Set_C2DVector_Rand_Generator() const
+{
+	gsl_rng_memcpy (C2DVector::gsl_r, gsl_r);
+}
+
+void Rand_Snapshot::Get_C2DVector_Rand_Generator()
+{
+	gsl_rng_memcpy (gsl_r, C2DVector::gsl_r);
+}
+
 const State_Hyper_Vector State_Hyper_Vector::operator+ (const State_Hyper_Vector& s1)
 {
 	State_Hyper_Vector result(*this);
@@ -92,7 +130,6 @@ const State_Hyper_Vector State_Hyper_Vector::operator+ (const State_Hyper_Vector
 	return result;
 }
 
-// Alwayse retun random generator of the lhs
 const State_Hyper_Vector State_Hyper_Vector::operator- (const State_Hyper_Vector& s1)
 {
 	State_Hyper_Vector result(*this);
@@ -105,7 +142,6 @@ const State_Hyper_Vector State_Hyper_Vector::operator- (const State_Hyper_Vector
 	return result;
 }
 
-// Alwayse retun random generator of the lhs
 State_Hyper_Vector& State_Hyper_Vector::operator+= (const State_Hyper_Vector& s1)
 {
 	for (int i = 0; i < N; i++)
@@ -117,7 +153,6 @@ State_Hyper_Vector& State_Hyper_Vector::operator+= (const State_Hyper_Vector& s1
 	return *this;
 }
 
-// Alwayse retun random generator of the lhs
 State_Hyper_Vector& State_Hyper_Vector::operator-= (const State_Hyper_Vector& s1)
 {
 	for (int i = 0; i < N; i++)
@@ -129,7 +164,6 @@ State_Hyper_Vector& State_Hyper_Vector::operator-= (const State_Hyper_Vector& s1
 	return *this;
 }
 
-// Alwayse retun random generator of the vector
 const State_Hyper_Vector State_Hyper_Vector::operator* (const Real factor)
 {
 	State_Hyper_Vector result(*this);
@@ -166,14 +200,42 @@ const Real State_Hyper_Vector::operator* (const State_Hyper_Vector& s1) const
 	return result;
 }
 
-void State_Hyper_Vector::Set_C2DVector_Rand_Generator() const
+void State_Hyper_Vector::Difference(const State_Hyper_Vector& a, const State_Hyper_Vector& b)
 {
-	gsl_rng_memcpy (C2DVector::gsl_r, gsl_r);
+	for (int i = 0; i < N; i++)
+	{
+		particle[i].r = a.particle[i].r - b.particle[i].r;
+		particle[i].r.Periodic_Transform();
+		Real theta = a.particle[i].theta - b.particle[i].theta;
+		particle[i].theta = theta - 2*M_PI*ceil((theta - M_PI) / (2*M_PI));
+	}
 }
 
-void State_Hyper_Vector::Get_C2DVector_Rand_Generator()
+void State_Hyper_Vector::Add_Scaled(const Real factor, const State_Hyper_Vector& s1)
 {
-	gsl_rng_memcpy (gsl_r, C2DVector::gsl_r);
+	for (int i = 0; i < N; i++)
+	{
+		particle[i].r += s1.particle[i].r*factor;
+		particle[i].r.Periodic_Transform();
+		Real theta = particle[i].theta + s1.particle[i].theta*factor;
+		particle[i].theta = theta - 2*M_PI*ceil((theta - M_PI) / (2*M_PI));
+	}
+}
+
+void State_Hyper_Vector::Set_Scaled(const Real factor, const State_Hyper_Vector& s1)
+{
+	for (int i = 0; i < N; i++)
+	{
+		particle[i].r = s1.particle[i].r*factor;
+		particle[i].r.Periodic_Transform();
+		Real theta = s1.particle[i].theta*factor;
+		particle[i].theta = theta - 2*M_PI*ceil((theta - M_PI) / (2*M_PI));
+	}
+}
+
+void State_Hyper_Vector::Scale(const Real factor)
+{
+	Set_Scaled(factor, *this);
 }
 
 void State_Hyper_Vector::Null()
@@ -186,7 +248,7 @@ void State_Hyper_Vector::Null()
 	}
 }
 
-void State_Hyper_Vector::Rand(const Real position_amplitude, const Real angle_amplitude)
+void State_Hyper_Vector::Rand(const Real position_amplitude, const Real angle_amplitude, gsl_rng* gsl_r)
 {
 	for (int i = 0; i < N; i++)
 	{
@@ -226,7 +288,7 @@ void State_Hyper_Vector::Periodic_Transform()
 
 void State_Hyper_Vector::Unit()
 {
-	*this = *this / Magnitude();
+	Scale(1 / Magnitude());
 }
 
 int State_Hyper_Vector::Max_Index() const
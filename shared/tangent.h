@@ -0,0 +1,45 @@
+#ifndef _TANGENT_
+#define _TANGENT_
+
+#include "parameters.h"
+#include <vector>
+
+// Tangent vectors of the linearized dynamics. They are used to find the Lyapunov exponents without simulating perturbed copies of the box. Each particle has num tangent vectors with (x, y, theta) components and the sums of the linearized force and torque of the current step. The particles update the sums in the same pass as their interaction (Cell::Interact) and the tangent vectors after their move (Tangent_Move in particle.h).
+struct Tangent{
+	static int num; // Number of tangent vectors, it is zero if there is no linearized dynamics.
+	static std::vector<Real> d; // d[3*(num*id + i) + c] is the component c (x, y or theta) of the i'th tangent vector of particle id.
+	static std::vector<Real> sum; // Linearized force (x, y) and torque of each tangent vector of each particle, with the same layout as d.
+
+	static void Init(int N, int tangent_num); // All components are null.
+	static void Delete();
+	static Real* Of(int id) {return &d[3*num*id];}
+	static Real* Sum_Of(int id) {return &sum[3*num*id];}
+	static void Reset(int id); // Null the sums of particle id
+};
+
+void Tangent::Init(int N, int tangent_num)
+{
+	num = tangent_num;
+	d.assign(3*num*N, 0);
+	sum.assign(3*num*N, 0);
+}
+
+void Tangent::Delete()
+{
+	num = 0;
+	d.clear();
+	sum.clear();
+}
+
+void Tangent::Reset(int id)
+{
+	Real* s = Sum_Of(id);
+	for (int i = 0; i < 3*num; i++)
+		s[i] = 0;
+}
+
+int Tangent::num = 0;
+std::vector<Real> Tangent::d;
+std::vector<Real> Tangent::sum;
+
+#endif
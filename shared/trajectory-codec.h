@@ -0,0 +1,273 @@
+#ifndef _TRAJECTORY_CODEC_
+#define _TRAJECTORY_CODEC_
+
+#include "parameters.h"
+#include <vector>
+#include <cstring>
+#include <cmath>
+
+// Compressed frames of the trajectory (codec 1 of Trajectory_Header). The frames are saved in blocks of at most codec_block_frames frames with the same N, each block can be decoded without the others. The positions are quantized to position_bits bits of the box (2 Lx and 2 Ly) and the velocity (a unit vector) to angle_bits bits of its angle. The first frame of a block keeps the quantized numbers and the other frames their change from the frame before in the order of particle ids, that is small because a particle moves at most speed*dt*frame_period between two frames. The change is periodic (a particle that crosses the box is a small change).
+// Each number u (zigzag of the change) is coded by its number of bits s (symbol) and the s-1 bits after its highest bit (raw bits). The symbols of x, y and the angle are coded with their own table of frequencies by rANS (range asymmetric numeral system), the raw bits are kept as they are.
+// A block is [Codec_Block_Header][rans_size bytes of rANS][raw_size bytes of raw bits]. The index of a compressed file gives the offset of the block of each frame.
+const int codec_block_frames = 64;
+const int codec_symbols = 33;
+const int codec_prob_bits = 12; // Frequencies of each table sum to 2^codec_prob_bits
+const unsigned int codec_rans_low = 1u << 23; // Lower bound of the rANS state
+
+struct Codec_Block_Header{
+	int frames;
+	int N;
+	int rans_size;
+	int raw_size;
+	unsigned short freq[3][codec_symbols]; // Frequencies of the symbols of x, y and the angle
+};
+
+inline unsigned int Quantize_Position(float x, double L, int bits)
+{
+	double q = floor((x + L)*(1u << bits) / (2*L) + 0.5);
+	return (((long int) q) & ((1u << bits) - 1));
+}
+
+inline float Dequantize_Position(unsigned int q, double L, int bits)
+{
+	return ((float) (q*2*L / (1u << bits) - L));
+}
+
+inline unsigned int Quantize_Angle(float vx, float vy, int bits)
+{
+	double theta = atan2((double) vy, (double) vx);
+	double q = floor(theta*(1u << bits) / (2*PI) + 0.5);
+	return (((long int) q) & ((1u << bits) - 1));
+}
+
+inline unsigned int Zigzag(unsigned int q, unsigned int previous, int bits)
+{
+	int d = (int) ((q - previous) & ((1u << bits) - 1));
+	if (d >= (1 << (bits-1)))
+		d -= (1 << bits);
+	return ((d >= 0) ? (2u*d) : (-2u*d - 1));
+}
+
+inline unsigned int Unzigzag(unsigned int u, unsigned int previous, int bits)
+{
+	int d = (u & 1) ? -((int) (u >> 1)) - 1 : (int) (u >> 1);
+	return ((previous + d) & ((1u << bits) - 1));
+}
+
+inline int Bit_Length(unsigned int u)
+{
+	int s = 0;
+	while (u)
+	{
+		s++;
+		u >>= 1;
+	}
+	return s;
+}
+
+// Frequencies of the counts of the symbols that sum to 2^codec_prob_bits, each symbol that is used gets at least one.
+void Normalize_Frequencies(const long int* count, unsigned short* freq)
+{
+	long int total = 0;
+	for (int s = 0; s < codec_symbols; s++)
+		total += count[s];
+	memset(freq, 0, sizeof(unsigned short)*codec_symbols);
+	if (total == 0)
+		return;
+	int sum = 0;
+	int largest = 0;
+	for (int s = 0; s < codec_symbols; s++)
+	{
+		if (count[s] > 0)
+			freq[s] = max(1L, (count[s] << codec_prob_bits) / total);
+		sum += freq[s];
+		if (freq[s] > freq[largest])
+			largest = s;
+	}
+	freq[largest] += (1 << codec_prob_bits) - sum;
+}
+
+// Encode frames of the file format (x, y, vx, vy floats of each particle) to a block, frames*N*4 floats are read from data.
+void Encode_Block(const float* data, int frames, int N, double Lx, double Ly, int position_bits, int angle_bits, std::vector<char>& block)
+{
+	int bits[3] = {position_bits, position_bits, angle_bits};
+	long int values = 3L*frames*N;
+	std::vector<unsigned int> u(values);
+	std::vector<unsigned char> symbol(values);
+	std::vector<unsigned int> q(3*N), previous(3*N, 0);
+	long int count[3][codec_symbols];
+	memset(count, 0, sizeof(count));
+
+	for (int f = 0; f < frames; f++)
+	{
+		const float* frame = data + 4L*N*f;
+		for (int i = 0; i < N; i++)
+		{
+			q[3*i] = Quantize_Position(frame[4*i], Lx, position_bits);
+			q[3*i+1] = Quantize_Position(frame[4*i+1], Ly, position_bits);
+			q[3*i+2] = Quantize_Angle(frame[4*i+2], frame[4*i+3], angle_bits);
+		}
+		for (int k = 0; k < 3*N; k++)
+		{
+			long int n = 3L*N*f + k;
+			u[n] = (f == 0) ? q[k] : Zigzag(q[k], previous[k], bits[k%3]);
+			symbol[n] = Bit_Length(u[n]);
+			count[k%3][symbol[n]]++;
+			previous[k] = q[k];
+		}
+	}
+
+	Codec_Block_Header header;
+	memset(&header, 0, sizeof(header));
+	header.frames = frames;
+	header.N = N;
+	unsigned int start[3][codec_symbols];
+	for (int c = 0; c < 3; c++)
+	{
+		Normalize_Frequencies(count[c], header.freq[c]);
+		start[c][0] = 0;
+		for (int s = 1; s < codec_symbols; s++)
+			start[c][s] = start[c][s-1] + header.freq[c][s-1];
+	}
+
+// Raw bits in the order of the numbers, the lowest bit first.
+	std::vector<unsigned char> raw;
+	raw.reserve(2*values);
+	unsigned long int buffer = 0;
+	int buffer_bits = 0;
+	for (long int n = 0; n < values; n++)
+	{
+		int extra = symbol[n] - 1;
+		if (extra <= 0)
+			continue;
+		buffer |= ((unsigned long int) (u[n] & ((1u << extra) - 1))) << buffer_bits;
+		buffer_bits += extra;
+		while (buffer_bits >= 8)
+		{
+			raw.push_back(buffer & 0xff);
+			buffer >>= 8;
+			buffer_bits -= 8;
+		}
+	}
+	if (buffer_bits > 0)
+		raw.push_back(buffer & 0xff);
+
+// rANS codes the symbols from the last one and the bytes are written from the end of the buffer, so the decoder reads them forward.
+	std::vector<unsigned char> rans(values + 16);
+	unsigned char* ptr = rans.data() + rans.size();
+	unsigned int x = codec_rans_low;
+	for (long int n = values - 1; n >= 0; n--)
+	{
+		int c = n % 3;
+		unsigned int freq = header.freq[c][symbol[n]];
+		unsigned int x_max = ((codec_rans_low >> codec_prob_bits) << 8)*freq;
+		while (x >= x_max)
+		{
+			*--ptr = x & 0xff;
+			x >>= 8;
+		}
+		x = ((x / freq) << codec_prob_bits) + (x % freq) + start[c][symbol[n]];
+		if (ptr < rans.data() + 4)
+		{
+			long int used = rans.data() + rans.size() - ptr;
+			std::vector<unsigned char> larger(2*rans.size());
+			memcpy(larger.data() + larger.size() - used, ptr, used);
+			rans.swap(larger);
+			ptr = rans.data() + rans.size() - used;
+		}
+	}
+	for (int b = 0; b < 4; b++)
+	{
+		*--ptr = x & 0xff;
+		x >>= 8;
+	}
+
+	header.rans_size = rans.data() + rans.size() - ptr;
+	header.raw_size = raw.size();
+	block.resize(sizeof(header) + header.rans_size + header.raw_size);
+	memcpy(block.data(), &header, sizeof(header));
+	memcpy(block.data() + sizeof(header), ptr, header.rans_size);
+	memcpy(block.data() + sizeof(header) + header.rans_size, raw.data(), header.raw_size);
+}
+
+inline long int Block_Size(const char* block)
+{
+	const Codec_Block_Header* header = (const Codec_Block_Header*) block;
+	return (sizeof(Codec_Block_Header) + header->rans_size + header->raw_size);
+}
+
+// Decode a block to frames of the file format, it writes frames*N*4 floats to data. It only reads the block, so blocks can be decoded by threads at the same time.
+void Decode_Block(const char* block, double Lx, double Ly, int position_bits, int angle_bits, float* data)
+{
+	Codec_Block_Header header;
+	memcpy(&header, block, sizeof(header));
+	int N = header.N;
+	int bits[3] = {position_bits, position_bits, angle_bits};
+	unsigned char lookup[3][1 << codec_prob_bits];
+	unsigned int start[3][codec_symbols];
+	for (int c = 0; c < 3; c++)
+	{
+		unsigned int cumulative = 0;
+		for (int s = 0; s < codec_symbols; s++)
+		{
+			start[c][s] = cumulative;
+			for (int k = 0; k < header.freq[c][s]; k++)
+				lookup[c][cumulative + k] = s;
+			cumulative += header.freq[c][s];
+		}
+	}
+
+	const unsigned char* ptr = (const unsigned char*) block + sizeof(header);
+	const unsigned char* raw = ptr + header.rans_size;
+	unsigned int x = 0;
+	for (int b = 0; b < 4; b++)
+		x = (x << 8) | *ptr++;
+	unsigned long int buffer = 0;
+	int buffer_bits = 0;
+
+	std::vector<unsigned int> q(3*N, 0);
+	std::vector<float> angle_cos(1 << angle_bits), angle_sin(1 << angle_bits);
+	for (int a = 0; a < (1 << angle_bits); a++)
+	{
+		double theta = a*2*PI / (1 << angle_bits);
+		angle_cos[a] = cos(theta);
+		angle_sin[a] = sin(theta);
+	}
+
+	for (int f = 0; f < header.frames; f++)
+	{
+		for (int k = 0; k < 3*N; k++)
+		{
+			int c = k % 3;
+			unsigned int slot = x & ((1u << codec_prob_bits) - 1);
+			int s = lookup[c][slot];
+			x = header.freq[c][s]*(x >> codec_prob_bits) + slot - start[c][s];
+			while (x < codec_rans_low)
+				x = (x << 8) | *ptr++;
+
+			unsigned int u = (s == 0) ? 0 : 1;
+			if (s > 1)
+			{
+				while (buffer_bits < s - 1)
+				{
+					buffer |= ((unsigned long int) *raw++) << buffer_bits;
+					buffer_bits += 8;
+				}
+				u = (1u << (s-1)) | (buffer & ((1u << (s-1)) - 1));
+				buffer >>= (s-1);
+				buffer_bits -= (s-1);
+			}
+			q[k] = (f == 0) ? u : Unzigzag(u, q[k], bits[c]);
+		}
+		float* frame = data + 4L*N*f;
+		for (int i = 0; i < N; i++)
+		{
+			frame[4*i] = Dequantize_Position(q[3*i], Lx, position_bits);
+			frame[4*i+1] = Dequantize_Position(q[3*i+1], Ly, position_bits);
+			frame[4*i+2] = angle_cos[q[3*i+2]];
+			frame[4*i+3] = angle_sin[q[3*i+2]];
+		}
+	}
+}
+
+#endif
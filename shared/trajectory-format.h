@@ -0,0 +1,218 @@
+#ifndef _TRAJECTORY_FORMAT_
+#define _TRAJECTORY_FORMAT_
+
+#include "parameters.h"
+#include "trajectory-codec.h"
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+
+// Trajectory file (-r-v.bin). Version 2 is a Trajectory_Header, then the frames and then the index of the frames and a Trajectory_Footer at the end of the file. Each frame is [int N][float x, y, vx, vy]*N like version 1, that is only the frames without header and index, or with codec 1 the frames are in compressed blocks (trajectory-codec.h). The offset of each frame (of its block) is in the index, so a reader goes to any frame without reading the frames before it.
+struct Trajectory_Header{
+	char magic[8]; // "PSTRAJ2"
+	int version;
+	int N;
+	int frame_period; // Number of steps between two frames
+	long int seed; // Seed of the random generator (of the master node in the parallel program)
+	double Lx, Ly, dt;
+	double density, noise, rv, speed; // noise is the amplitude in the name of the file, that is Particle::noise_amplitude*sqrt(dt).
+	char model[32]; // Particle type
+	char info[256]; // Box::info, the other parameters of the model are in it.
+	int codec; // 0 for frames of floats, 1 for compressed blocks (trajectory-codec.h)
+	int position_bits, angle_bits; // Quantization of codec 1
+};
+
+// The index is frames offsets (long int) from the start of the file, index_offset is the place of the first one.
+struct Trajectory_Footer{
+	long int index_offset;
+	long int frames;
+	char magic[8]; // "PSTRIDX"
+};
+
+const int trajectory_version = 2;
+
+template<class T> inline const char* Model_Name() {return "unknown";}
+template<> inline const char* Model_Name<VicsekParticle>() {return "VicsekParticle";}
+template<> inline const char* Model_Name<ContinuousParticle>() {return "ContinuousParticle";}
+template<> inline const char* Model_Name<MarkusParticle>() {return "MarkusParticle";}
+template<> inline const char* Model_Name<RepulsiveParticle>() {return "RepulsiveParticle";}
+
+// Fill the parts of the header that are compile time constants, the writer of the box fills the rest. The codec is 0, a compressed writer changes it. A header of a converted version 1 file has zero for what is not known (dt, frame_period, seed, rv and speed).
+void Init_Trajectory_Header(Trajectory_Header& header)
+{
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, "PSTRAJ2");
+	header.version = trajectory_version;
+	header.frame_period = cell_update_period*saving_period;
+	header.Lx = Lx;
+	header.Ly = Ly;
+	header.dt = dt;
+	strncpy(header.model, Model_Name<Particle>(), sizeof(header.model) - 1);
+	header.position_bits = trajectory_position_bits;
+	header.angle_bits = trajectory_angle_bits;
+}
+
+// Header of a version 1 file that is written again in version 2, L is found from the particles and the rest from the name of the file.
+void Convert_Trajectory_Header(Trajectory_Header& header, Real L, Real density, Real noise, const std::string& info)
+{
+	int N = header.N;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, "PSTRAJ2");
+	header.version = trajectory_version;
+	header.N = N;
+	header.Lx = header.Ly = L;
+	header.density = density;
+	header.noise = noise;
+	strcpy(header.model, "unknown");
+	strncpy(header.info, info.c_str(), sizeof(header.info) - 1);
+}
+
+inline long int Frame_Size(int N)
+{
+	return (sizeof(int) + 4*sizeof(float)*(long int) N);
+}
+
+// Write the index of the frames and the footer at the current end of a version 2 file.
+void Write_Trajectory_Index(std::ostream& os, const std::vector<long int>& frame_offset)
+{
+	Trajectory_Footer footer;
+	memset(&footer, 0, sizeof(footer));
+	footer.index_offset = os.tellp();
+	footer.frames = frame_offset.size();
+	strcpy(footer.magic, "PSTRIDX");
+	os.write((char*) frame_offset.data(), sizeof(long int)*frame_offset.size());
+	os.write((char*) &footer, sizeof(footer));
+}
+
+// Writes frames (x, y, vx, vy floats of each particle) to a trajectory file with the codec of its header and keeps the offsets of the frames for the index. With codec 1 the frames are kept until a block is full (or N changes) and then the block is written, all frames of a block have the offset of the block.
+struct Frame_Writer{
+	Trajectory_Header header;
+	std::vector<long int> frame_offset;
+	std::vector<float> frames; // Frames of the block that is not written
+	int frames_num, N;
+	std::vector<char> block;
+
+	void Init(const Trajectory_Header& input_header);
+	void Write(std::ostream& os, const float* frame, int input_N);
+	void Flush(std::ostream& os); // Write the last block
+	void Close(std::ostream& os); // Flush and write the index
+};
+
+void Frame_Writer::Init(const Trajectory_Header& input_header)
+{
+	header = input_header;
+	frame_offset.clear();
+	frames.clear();
+	frames_num = N = 0;
+}
+
+void Frame_Writer::Write(std::ostream& os, const float* frame, int input_N)
+{
+	if (header.codec == 0)
+	{
+		frame_offset.push_back(os.tellp());
+		os.write((char*) &input_N, sizeof(int));
+		os.write((char*) frame, 4*sizeof(float)*input_N);
+		return;
+	}
+	if (frames_num > 0 && input_N != N)
+		Flush(os);
+	N = input_N;
+	frames.insert(frames.end(), frame, frame + 4*N);
+	frames_num++;
+	if (frames_num == codec_block_frames)
+		Flush(os);
+}
+
+void Frame_Writer::Flush(std::ostream& os)
+{
+	if (frames_num == 0)
+		return;
+	Encode_Block(frames.data(), frames_num, N, header.Lx, header.Ly, header.position_bits, header.angle_bits, block);
+	frame_offset.insert(frame_offset.end(), frames_num, (long int) os.tellp());
+	os.write(block.data(), block.size());
+	frames.clear();
+	frames_num = 0;
+}
+
+void Frame_Writer::Close(std::ostream& os)
+{
+	Flush(os);
+	if (frame_offset.size() > 0)
+		Write_Trajectory_Index(os, frame_offset);
+}
+
+// Read the header and the offsets of the frames of a trajectory file of any version. A version 1 file gets a header with version 1 and only N, the rest of it is zero. The frames of a version 1 file, or of a version 2 file without index (the program was stopped before closing it), are found by reading N of each frame and jumping over its particles. An incomplete last frame is dropped.
+bool Read_Trajectory_Index(std::istream& is, Trajectory_Header& header, std::vector<long int>& frame_offset)
+{
+	frame_offset.clear();
+	memset(&header, 0, sizeof(header));
+	is.clear();
+	is.seekg(0, std::ios::end);
+	long int file_size = is.tellg();
+	is.seekg(0);
+	if (!is.good())
+		return false;
+
+	long int data_end = file_size;
+	long int offset = 0;
+	if (file_size >= (long int) sizeof(Trajectory_Header))
+	{
+		is.read((char*) &header, sizeof(header));
+		if (strcmp(header.magic, "PSTRAJ2") == 0 && header.version == trajectory_version)
+		{
+			offset = sizeof(header);
+			if (file_size >= offset + (long int) sizeof(Trajectory_Footer))
+			{
+				Trajectory_Footer footer;
+				is.seekg(file_size - sizeof(footer));
+				is.read((char*) &footer, sizeof(footer));
+				if (strcmp(footer.magic, "PSTRIDX") == 0 && footer.index_offset + sizeof(long int)*footer.frames + sizeof(footer) == file_size)
+				{
+					frame_offset.resize(footer.frames);
+					is.seekg(footer.index_offset);
+					is.read((char*) frame_offset.data(), sizeof(long int)*footer.frames);
+					return is.good();
+				}
+			}
+		}
+		else
+			memset(&header, 0, sizeof(header));
+	}
+	if (offset == 0)
+		header.version = 1;
+
+	is.clear();
+	if (header.codec == 1)
+	{
+		while (offset + (long int) sizeof(Codec_Block_Header) <= data_end)
+		{
+			Codec_Block_Header block;
+			is.seekg(offset);
+			is.read((char*) &block, sizeof(block));
+			long int size = sizeof(block) + (long int) block.rans_size + block.raw_size;
+			if (!is.good() || block.frames <= 0 || block.N <= 0 || offset + size > data_end)
+				break;
+			frame_offset.insert(frame_offset.end(), block.frames, offset);
+			offset += size;
+		}
+		is.clear();
+		return true;
+	}
+	while (offset + (long int) sizeof(int) <= data_end)
+	{
+		int N;
+		is.seekg(offset);
+		is.read((char*) &N, sizeof(int));
+		if (!is.good() || N <= 0 || offset + Frame_Size(N) > data_end)
+			break;
+		frame_offset.push_back(offset);
+		header.N = N;
+		offset += Frame_Size(N);
+	}
+	is.clear();
+	return true;
+}
+
+#endif
@@ -3,13 +3,16 @@
 
 #include "c2dvector.h"
 #include "state-hyper-vector.h"
+#include "householder.h"
 
 
 class VectorSet{
 public:
 	static int direction_num, particle_num;
+	static int null_num; // The first null_num vectors are null (Rand) and they are not renormalized. It is 1 (vector 0 is null) unless it is changed.
 	static Real amplitude;
 	vector<State_Hyper_Vector> v;
+	vector<Real> matrix; // Vectors null_num to direction_num - 1 as the columns of a contiguous 3*particle_num by (direction_num - null_num) matrix (x, y and theta of each particle), for the QR of Renormalize.
 
 	VectorSet();
 	VectorSet(const int vector_number, const int particle_per_vector);
@@ -21,6 +24,9 @@ public:
 	void Rand();
 	void Renormalize();
 	void Renormalize(VectorSet& us);
+	void Renormalize(VectorSet& us, vector<Real>& growth); // growth[i] is the projection of v[i] on us.v[i], the diagonal of R. For the null vectors it is the projection of v[i] on the old us.v[i].
+	void Pack(); // Copy v to matrix
+	void Unpack(VectorSet& us) const; // Copy matrix to us.v
 	void Unit_Vector(VectorSet& us);
 	void Scale(); // Scale all vectors by amplitude
 	
@@ -74,7 +80,7 @@ VectorSet& VectorSet::operator= ( const VectorSet& vs)
 VectorSet& VectorSet::operator*= ( const Real& factor)
 {
 	for (int i = 0; i < direction_num; i++)
-		v[i] = v[i]*factor;
+		v[i].Scale(factor);
 	return *this;
 }
 
@@ -82,52 +88,86 @@ const VectorSet VectorSet::operator* ( const Real& factor)
 {
 	VectorSet result(*this);
 	for (int i = 0; i < direction_num; i++)
-		result.v[i] = v[i]*factor;
+		result.v[i].Set_Scaled(factor, v[i]);
 	return result;
 }
 
 void VectorSet::Scale()
 {
 	for (int i = 0; i < direction_num; i++)
-		v[i] = v[i]*amplitude;
+		v[i].Scale(amplitude);
 }
 
 void VectorSet::Rand()
 {
-	State_Hyper_Vector temp(particle_num, time(NULL));
-	v[0].Null();
-	for (int i = 1; i < v.size(); i++)
-	{
-		temp.Rand(0.001, 0.001);
-		v[i] = temp;
-	}
+	Rand_Snapshot temp_rand; // The random vectors do not change the random generator of the box.
+	for (int i = 0; i < v.size(); i++)
+		if (i < null_num)
+			v[i].Null();
+		else
+			v[i].Rand(0.001, 0.001, temp_rand.gsl_r);
 	Renormalize();
 }
 
-void VectorSet::Renormalize()
+void VectorSet::Pack()
 {
-	State_Hyper_Vector temp(particle_num);
-	for (int i = 1; i < v.size(); i++)
+	int rows = 3*particle_num;
+	matrix.resize(rows*(v.size() - null_num));
+	for (int i = null_num; i < v.size(); i++)
 	{
-		for (int j = 1; j < i; j++)
-			v[i] -= v[j]*(v[i]*v[j]);
-		v[i].Unit();
+		Real* column = &matrix[(i-null_num)*rows];
+		for (int k = 0; k < particle_num; k++)
+		{
+			column[3*k] = v[i].particle[k].r.x;
+			column[3*k+1] = v[i].particle[k].r.y;
+			column[3*k+2] = v[i].particle[k].theta;
+		}
 	}
 }
 
-void VectorSet::Renormalize(VectorSet& us)
+void VectorSet::Unpack(VectorSet& us) const
 {
-	for (int i = 1; i < v.size(); i++)
+	int rows = 3*particle_num;
+	for (int i = null_num; i < v.size(); i++)
 	{
-		us.v[i] = v[i];
-		for (int j = 1; j < i; j++)
- 			us.v[i] -= us.v[j]*(us.v[j]*us.v[i]);
-		us.v[i] = us.v[i] / us.v[i].Magnitude();
+		const Real* column = &matrix[(i-null_num)*rows];
+		for (int k = 0; k < particle_num; k++)
+		{
+			us.v[i].particle[k].r.x = column[3*k];
+			us.v[i].particle[k].r.y = column[3*k+1];
+			us.v[i].particle[k].theta = column[3*k+2];
+		}
 	}
 }
 
+// Gram-Schmidt of vectors null_num to direction_num - 1, it is done by a blocked Householder QR (householder.h) of the matrix of the vectors. The result is the same as the modified Gram-Schmidt.
+void VectorSet::Renormalize()
+{
+	vector<Real> growth;
+	Renormalize(*this, growth);
+}
+
+void VectorSet::Renormalize(VectorSet& us)
+{
+	vector<Real> growth;
+	Renormalize(us, growth);
+}
+
+void VectorSet::Renormalize(VectorSet& us, vector<Real>& growth)
+{
+	growth.assign(v.size(), 0);
+	for (int i = 0; i < null_num && i < v.size(); i++)
+		growth[i] = v[i]*us.v[i];
+	if (v.size() <= null_num)
+		return;
+	Pack();
+	Householder_QR(3*particle_num, v.size() - null_num, matrix.data(), &growth[null_num]);
+	Unpack(us);
+}
+
 int VectorSet::direction_num = 0;
 int VectorSet::particle_num = 0;
+int VectorSet::null_num = 1;
 Real VectorSet::amplitude = 1e-7;
 
 class GrowthRatio{
@@ -186,6 +226,99 @@ void GrowthRatio::Init()
 	}
 }
 
+// Running estimate of the Lyapunov exponents. The exponent of a direction is the average of log(ratio)/interval. The intervals are grouped to batches of batch_size intervals and the error is the standard error of the batch means, it is valid if a batch is longer than the correlation time of the ratios.
+class Lyapunov_Estimate{
+public:
+	int batch_size, min_batches;
+	Real tolerance; // Converged if the error of every exponent is less than tolerance times the largest exponent (in magnitude). The exponents near zero (neutral directions) can not have a small relative error. Zero tolerance never converges.
+	int intervals, batches;
+	Real batch_time; // Time of the intervals of the current batch
+	vector<Real> batch_sum; // Sum of log(ratio) of the current batch
+	vector<Real> sum, sum2; // Sum and sum of squares of the exponents of the finished batches
+	vector<bool> is_null; // Null directions (ratio zero) have no exponent.
+
+	Lyapunov_Estimate();
+
+	void Init(int direction_num, int input_batch_size, int input_min_batches, Real input_tolerance);
+	bool Add(const vector<Real>& ratio, Real interval); // Add the growth ratios of an interval. It returns true if a batch is finished.
+	Real Exponent(int i) const;
+	Real Error(int i) const;
+	bool Converged() const;
+};
+
+Lyapunov_Estimate::Lyapunov_Estimate()
+{
+	Init(0, 1, 1, 0);
+}
+
+void Lyapunov_Estimate::Init(int direction_num, int input_batch_size, int input_min_batches, Real input_tolerance)
+{
+	batch_size = input_batch_size;
+	min_batches = max(input_min_batches, 2);
+	tolerance = input_tolerance;
+	intervals = batches = 0;
+	batch_time = 0;
+	batch_sum.assign(direction_num, 0);
+	sum.assign(direction_num, 0);
+	sum2.assign(direction_num, 0);
+	is_null.assign(direction_num, false);
+}
+
+bool Lyapunov_Estimate::Add(const vector<Real>& ratio, Real interval)
+{
+	for (int i = 0; i < sum.size(); i++)
+	{
+		if (ratio[i] > 0)
+			batch_sum[i] += log(ratio[i]);
+		else
+			is_null[i] = true;
+	}
+	batch_time += interval;
+	intervals++;
+	if (intervals % batch_size != 0)
+		return false;
+	for (int i = 0; i < sum.size(); i++)
+	{
+		Real exponent = batch_sum[i] / batch_time;
+		sum[i] += exponent;
+		sum2[i] += exponent*exponent;
+		batch_sum[i] = 0;
+	}
+	batch_time = 0;
+	batches++;
+	return true;
+}
+
+Real Lyapunov_Estimate::Exponent(int i) const
+{
+	if (batches == 0)
+		return 0;
+	return (sum[i] / batches);
+}
+
+Real Lyapunov_Estimate::Error(int i) const
+{
+	if (batches < 2)
+		return 0;
+	Real mean = sum[i] / batches;
+	Real variance = (sum2[i] - batches*mean*mean) / (batches - 1);
+	return (sqrt(max(variance, (Real) 0) / batches));
+}
+
+bool Lyapunov_Estimate::Converged() const
+{
+	if (tolerance <= 0 || batches < min_batches)
+		return false;
+	Real largest = 0;
+	for (int i = 0; i < sum.size(); i++)
+		if (!is_null[i])
+			largest = max(largest, fabs(Exponent(i)));
+	for (int i = 0; i < sum.size(); i++)
+		if (!is_null[i] && Error(i) >= tolerance*largest)
+			return false;
+	return true;
+}
+
 std::ostream& operator<<(std::ostream& os, const VectorSet& vs) // Save
 {
 	os << "np";